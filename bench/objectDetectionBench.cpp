@@ -0,0 +1,443 @@
+//
+// Offline benchmark of the inference core : replays a directory of images or a video through
+// tensorflowObjectDetection::inferObject(), without YARP, and reports the throughput, the latency
+// percentiles, the startup time and the resident memory.
+//
+// Usage : objectDetectionBench --graph_path graph.pb --labels_path labels.pbtxt [--model_name coco]
+//                              [--graph_format frozen|memmapped] [--optimize_graph 0] (--images dir | --video file) [--max_frames 0] [--warmup 10] [--iterations 200]
+//                              [--concurrency 1] [--sessions 1] [--intra_op_threads 0] [--inter_op_threads 0]
+//                              [--input_width 0] [--input_height 0] [--letterbox 0] [--threshold 0.5]
+//                              [--tile_columns 1] [--tile_rows 1] [--tile_overlap 0.2]
+//                              [--json result.json | --json -]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "iCub/tensorflowObjectDetection.h"
+#include "iCub/LatencyWindow.h"
+#include "iCub/StageStatistics.h"
+
+
+struct BenchOptions {
+    std::string graphPath;
+    std::string labelsPath;
+    std::string modelName;
+    std::string graphFormat;    // frozen or memmapped
+    std::string imagesPath;
+    std::string videoPath;
+    std::string jsonPath;       // "-" for the standard output, empty to disable
+    int maxFrames;              // frames loaded from the source, 0 for all of them
+    int warmup;
+    int iterations;
+    int concurrency;            // threads calling inferObject at the same time
+    int sessions;
+    int intraOpThreads;
+    int interOpThreads;
+    int inputWidth;
+    int inputHeight;
+    bool letterbox;
+    double threshold;
+    bool optimizeGraph;         // load the graph optimised by transform_graph, built or read from its cache
+    int tileColumns;            // tiled mode, 1 x 1 infers the whole frame
+    int tileRows;
+    double tileOverlap;
+};
+
+struct BenchResult {
+    size_t frames;
+    int frameWidth;
+    int frameHeight;
+    double wallTimeS;
+    double framesPerSecond;
+    double meanLatencyMs;
+    LatencyPercentiles latency;
+    double detectionsPerFrame;
+    long peakRssKb;
+    GraphLoadStats graphLoad;
+    GraphOptimizationStats graphOptimization;
+    TileStats tiles;
+};
+
+/**
+ * Decode the frames replayed by the benchmark, so that the decoding is not measured
+ * @param t_options
+ * @param t_frames
+ * @return false if no frame can be read
+ */
+static bool loadFrames(const BenchOptions &t_options, std::vector<cv::Mat> &t_frames) {
+    const size_t maxFrames = t_options.maxFrames > 0 ? static_cast<size_t>(t_options.maxFrames) : SIZE_MAX;
+
+    if (!t_options.videoPath.empty()) {
+        cv::VideoCapture video;
+        if (!video.open(t_options.videoPath) || !video.isOpened()) {
+            fprintf(stderr, "Unable to open the video %s\n", t_options.videoPath.c_str());
+            return false;
+        }
+
+        cv::Mat frame;
+        while (t_frames.size() < maxFrames && video.read(frame)) {
+            // the capture reuses its buffer between the reads
+            t_frames.push_back(frame.clone());
+        }
+    }
+    else {
+        std::vector<std::string> files;
+        cv::glob(t_options.imagesPath + "/*", files, false);
+
+        for (size_t i = 0; i < files.size() && t_frames.size() < maxFrames; ++i) {
+            cv::Mat frame = cv::imread(files[i]);
+            if (frame.empty()) {
+                continue;
+            }
+            t_frames.push_back(frame);
+        }
+    }
+
+    return !t_frames.empty();
+}
+
+/**
+ * Replay the frames from concurrent callers, each one with its own buffer of detections
+ * @param t_detector
+ * @param t_frames
+ * @param t_iterations frames inferred in total, the source is looped over
+ * @param t_concurrency
+ * @param t_latencies latency of every frame (s), nullptr for the warm up
+ * @param t_latencySum sum of the latencies (ns)
+ * @param t_detections number of objects detected over all the frames
+ * @return wall time of the replay (s)
+ */
+static double replayFrames(tensorflowObjectDetection &t_detector, const std::vector<cv::Mat> &t_frames,
+                           int t_iterations, int t_concurrency, LatencyWindow *t_latencies,
+                           std::atomic<uint64_t> &t_latencySum, std::atomic<uint64_t> &t_detections) {
+    std::atomic<int> nextIteration(0);
+
+    auto caller = [&]() {
+        DetectionBuffer objectsDetected;
+        for (int i = nextIteration++; i < t_iterations; i = nextIteration++) {
+
+            const auto start = std::chrono::steady_clock::now();
+            t_detector.inferObject(t_frames[i % t_frames.size()], &objectsDetected);
+            const auto end = std::chrono::steady_clock::now();
+
+            if (t_latencies != nullptr) {
+                t_latencies->add(std::chrono::duration<double>(end - start).count());
+            }
+            t_latencySum += static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            t_detections += objectsDetected.size();
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> callers;
+    for (int c = 0; c < t_concurrency; ++c) {
+        callers.emplace_back(caller);
+    }
+    for (std::thread &thread : callers) {
+        thread.join();
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @return peak resident set size of the process (kB)
+ */
+static long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+    // kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+static std::string jsonString(const std::string &t_value) {
+    std::string escaped = "\"";
+    for (const char c : t_value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+/**
+ * Write the result in JSON, one object per run, to compare the models and keep a baseline
+ * @param t_file
+ * @param t_options
+ * @param t_result
+ * @param t_stages
+ * @param t_threading threading configuration of the sessions
+ */
+static void writeJson(FILE *t_file, const BenchOptions &t_options, const BenchResult &t_result,
+                      const std::vector<StageSummary> &t_stages, const ThreadingConfig &t_threading) {
+    fprintf(t_file, "{\n");
+    fprintf(t_file, "  \"graph\": %s,\n", jsonString(t_options.graphPath).c_str());
+    fprintf(t_file, "  \"model_name\": %s,\n", jsonString(t_options.modelName).c_str());
+    fprintf(t_file, "  \"graph_format\": %s,\n", jsonString(t_options.graphFormat).c_str());
+    fprintf(t_file, "  \"source\": %s,\n",
+            jsonString(t_options.videoPath.empty() ? t_options.imagesPath : t_options.videoPath).c_str());
+    fprintf(t_file, "  \"frames\": %zu,\n", t_result.frames);
+    fprintf(t_file, "  \"frame_width\": %d,\n", t_result.frameWidth);
+    fprintf(t_file, "  \"frame_height\": %d,\n", t_result.frameHeight);
+    fprintf(t_file, "  \"input_width\": %d,\n", t_options.inputWidth);
+    fprintf(t_file, "  \"input_height\": %d,\n", t_options.inputHeight);
+    fprintf(t_file, "  \"letterbox\": %s,\n", t_options.letterbox ? "true" : "false");
+    fprintf(t_file, "  \"warmup\": %d,\n", t_options.warmup);
+    fprintf(t_file, "  \"iterations\": %d,\n", t_options.iterations);
+    fprintf(t_file, "  \"concurrency\": %d,\n", t_options.concurrency);
+    fprintf(t_file, "  \"sessions\": %d,\n", t_options.sessions);
+    fprintf(t_file, "  \"intra_op_threads\": %d,\n", t_threading.intraOpThreads);
+    fprintf(t_file, "  \"inter_op_threads\": %d,\n", t_threading.interOpThreads);
+    fprintf(t_file, "  \"wall_time_s\": %.6f,\n", t_result.wallTimeS);
+    fprintf(t_file, "  \"throughput_fps\": %.3f,\n", t_result.framesPerSecond);
+    fprintf(t_file, "  \"latency_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+            t_result.meanLatencyMs, t_result.latency.p50 * 1000.0, t_result.latency.p95 * 1000.0,
+            t_result.latency.p99 * 1000.0, t_result.latency.max * 1000.0);
+    fprintf(t_file, "  \"detections_per_frame\": %.3f,\n", t_result.detectionsPerFrame);
+    fprintf(t_file, "  \"peak_rss_kb\": %ld,\n", t_result.peakRssKb);
+    fprintf(t_file, "  \"startup\": {\"graph_load_ms\": %.3f, \"session_create_ms\": %.3f, \"rss_anon_kb\": %ld, "
+                    "\"rss_file_kb\": %ld},\n", t_result.graphLoad.loadTimeMs, t_result.graphLoad.sessionTimeMs,
+            t_result.graphLoad.residentAnonymousKb, t_result.graphLoad.residentFileKb);
+    fprintf(t_file, "  \"graph_optimization\": {\"applied\": %s, \"from_cache\": %s, \"nodes_before\": %d, "
+                    "\"nodes_after\": %d, \"optimize_ms\": %.3f, \"p50_before_ms\": %.3f, \"p50_after_ms\": %.3f},\n",
+            t_result.graphOptimization.applied ? "true" : "false",
+            t_result.graphOptimization.fromCache ? "true" : "false", t_result.graphOptimization.nodesBefore,
+            t_result.graphOptimization.nodesAfter, t_result.graphOptimization.optimizeTimeMs,
+            t_result.graphOptimization.p50BeforeMs, t_result.graphOptimization.p50AfterMs);
+
+    fprintf(t_file, "  \"tiling\": {\"columns\": %d, \"rows\": %d, \"overlap\": %.3f, \"tiles_inferred\": %llu},\n",
+            t_options.tileColumns, t_options.tileRows, t_options.tileOverlap,
+            static_cast<unsigned long long>(t_result.tiles.tilesInferred));
+
+    fprintf(t_file, "  \"stages\": [");
+    bool first = true;
+    for (const StageSummary &stage : t_stages) {
+        if (stage.count == 0) {
+            continue;
+        }
+        fprintf(t_file, "%s\n    {\"stage\": %s, \"count\": %llu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, "
+                        "\"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}",
+                first ? "" : ",", jsonString(stage.stageName).c_str(), static_cast<unsigned long long>(stage.count),
+                stage.meanMs, stage.p50Ms, stage.p90Ms, stage.p99Ms, stage.maxMs);
+        first = false;
+    }
+    fprintf(t_file, "\n  ]\n}\n");
+}
+
+
+int main(int argc, char *argv[]) {
+    BenchOptions options = {"", "", "coco", "frozen", "", "", "", 0, 10, 200, 1, 1, 0, 0, 0, 0, false, 0.5, false, 1, 1,
+                           0.2};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--graph_path")) {
+            options.graphPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--labels_path")) {
+            options.labelsPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--model_name")) {
+            options.modelName = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--graph_format")) {
+            options.graphFormat = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--optimize_graph")) {
+            options.optimizeGraph = atoi(argv[i + 1]) != 0;
+        }
+        else if (!strcmp(argv[i], "--images")) {
+            options.imagesPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--video")) {
+            options.videoPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--json")) {
+            options.jsonPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--max_frames")) {
+            options.maxFrames = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--warmup")) {
+            options.warmup = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--iterations")) {
+            options.iterations = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--concurrency")) {
+            options.concurrency = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--sessions")) {
+            options.sessions = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--intra_op_threads")) {
+            options.intraOpThreads = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--inter_op_threads")) {
+            options.interOpThreads = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--input_width")) {
+            options.inputWidth = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--input_height")) {
+            options.inputHeight = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--letterbox")) {
+            options.letterbox = atoi(argv[i + 1]) != 0;
+        }
+        else if (!strcmp(argv[i], "--threshold")) {
+            options.threshold = atof(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--tile_columns")) {
+            options.tileColumns = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (!strcmp(argv[i], "--tile_rows")) {
+            options.tileRows = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (!strcmp(argv[i], "--tile_overlap")) {
+            options.tileOverlap = atof(argv[i + 1]);
+        }
+    }
+
+    if (options.graphPath.empty() || options.labelsPath.empty() ||
+        options.imagesPath.empty() == options.videoPath.empty()) {
+        fprintf(stderr, "Usage : %s --graph_path graph.pb --labels_path labels.pbtxt (--images dir | --video file) "
+                        "[--model_name coco] [--graph_format frozen] [--optimize_graph 0] [--max_frames 0] [--warmup 10] [--iterations 200] [--concurrency 1] "
+                        "[--sessions 1] [--intra_op_threads 0] [--inter_op_threads 0] [--input_width 0] "
+                        "[--input_height 0] [--letterbox 0] [--threshold 0.5] [--tile_columns 1] [--tile_rows 1] "
+                        "[--tile_overlap 0.2] [--json file|-]\n", argv[0]);
+        return 1;
+    }
+    options.concurrency = std::max(1, options.concurrency);
+    options.sessions = std::max(1, options.sessions);
+    options.iterations = std::max(1, options.iterations);
+
+    std::vector<cv::Mat> frames;
+    if (!loadFrames(options, frames)) {
+        fprintf(stderr, "No frame to replay\n");
+        return 1;
+    }
+
+    tensorflowObjectDetection detector(options.graphPath, options.labelsPath, options.modelName);
+    StageStatistics stageStatistics;
+    detector.setM_detectionThreshold(options.threshold);
+    // every frame is inferred as a batch of all its tiles, the tiles are not skipped
+    const TilingConfig tiling = {options.tileColumns, options.tileRows, options.tileOverlap, 0.5f, 0.0, 0};
+    const ImageTile tile = computeTiles(frames[0].cols, frames[0].rows, tiling.columns, tiling.rows,
+                                        tiling.overlap).front();
+    detector.setTiling(tiling);
+    detector.setExpectedInputSize(tile.width, tile.height, tiling.columns * tiling.rows,
+                                  static_cast<size_t>(options.concurrency));
+    detector.setInputResize(options.inputWidth, options.inputHeight, options.letterbox);
+    detector.setSessionCount(options.sessions);
+    detector.setThreadingConfig({options.intraOpThreads, options.interOpThreads, false});
+    detector.setGraphFormat(parseGraphFormat(options.graphFormat));
+    detector.setGraphOptimization(options.optimizeGraph, "");
+
+    const tensorflow::Status initStatus = detector.initGraph();
+    if (!initStatus.ok()) {
+        fprintf(stderr, "Unable to initialize the graph : %s\n", initStatus.error_message().c_str());
+        return 1;
+    }
+
+    // the summary leaves the standard output to the JSON when it is written there
+    FILE *report = options.jsonPath == "-" ? stderr : stdout;
+    fprintf(report, "Replaying %zu frames %dx%d, %d warm up and %d measured iterations from %d callers on %d "
+                    "sessions\n", frames.size(), frames[0].cols, frames[0].rows, options.warmup, options.iterations,
+            options.concurrency, options.sessions);
+
+    // the first runs allocate the kernels memory and fill the tensor pool, they are not measured
+    std::atomic<uint64_t> latencySum(0);
+    std::atomic<uint64_t> detections(0);
+    replayFrames(detector, frames, options.warmup, options.concurrency, nullptr, latencySum, detections);
+
+    latencySum = 0;
+    detections = 0;
+    detector.setStageStatistics(&stageStatistics);
+    LatencyWindow latencies(static_cast<size_t>(options.iterations));
+    const double wallTime = replayFrames(detector, frames, options.iterations, options.concurrency, &latencies,
+                                         latencySum, detections);
+    detector.setStageStatistics(nullptr);
+
+    const std::vector<StageSummary> stages = stageStatistics.summarize();
+
+    BenchResult result;
+    result.frames = frames.size();
+    result.frameWidth = frames[0].cols;
+    result.frameHeight = frames[0].rows;
+    result.wallTimeS = wallTime;
+    result.framesPerSecond = options.iterations / wallTime;
+    result.meanLatencyMs = latencySum / 1e6 / options.iterations;
+    result.latency = latencies.getPercentiles();
+    result.detectionsPerFrame = static_cast<double>(detections) / options.iterations;
+    result.peakRssKb = peakRssKb();
+    result.graphLoad = detector.getGraphLoadStats();
+    result.graphOptimization = detector.getGraphOptimizationStats();
+    result.tiles = detector.getTileStats();
+
+    fprintf(report, "%-24s %10.2f frames/s\n", "throughput", result.framesPerSecond);
+    fprintf(report, "%-24s %10.2f ms\n", "latency mean", result.meanLatencyMs);
+    fprintf(report, "%-24s %10.2f ms\n", "latency p50", result.latency.p50 * 1000.0);
+    fprintf(report, "%-24s %10.2f ms\n", "latency p95", result.latency.p95 * 1000.0);
+    fprintf(report, "%-24s %10.2f ms\n", "latency p99", result.latency.p99 * 1000.0);
+    fprintf(report, "%-24s %10.2f ms\n", "latency max", result.latency.max * 1000.0);
+    fprintf(report, "%-24s %10.2f\n", "detections per frame", result.detectionsPerFrame);
+    fprintf(report, "%-24s %10ld kB\n", "peak RSS", result.peakRssKb);
+    fprintf(report, "%-24s %10.2f ms\n", "graph load", result.graphLoad.loadTimeMs);
+    fprintf(report, "%-24s %10.2f ms\n", "session creation", result.graphLoad.sessionTimeMs);
+    fprintf(report, "%-24s %10ld kB anonymous %10ld kB file backed\n", "RSS after startup",
+            result.graphLoad.residentAnonymousKb, result.graphLoad.residentFileKb);
+    if (result.graphOptimization.applied) {
+        const GraphOptimizationStats &optimization = result.graphOptimization;
+        if (optimization.fromCache) {
+            fprintf(report, "%-24s %10d nodes, read from the cache\n", "optimised graph", optimization.nodesAfter);
+        }
+        else {
+            fprintf(report, "%-24s %10d nodes from %d, %.2f ms median run from %.2f ms\n", "optimised graph",
+                    optimization.nodesAfter, optimization.nodesBefore, optimization.p50AfterMs,
+                    optimization.p50BeforeMs);
+        }
+    }
+    if (tiling.enabled()) {
+        fprintf(report, "%-24s %10d x %d tiles of %dx%d in one batch per frame\n", "tiling", tiling.columns,
+                tiling.rows, tile.width, tile.height);
+    }
+    for (const StageSummary &stage : stages) {
+        if (stage.count > 0) {
+            fprintf(report, "  %-22s %10.2f ms mean %10.2f ms p99\n", stage.stageName.c_str(), stage.meanMs,
+                    stage.p99Ms);
+        }
+    }
+
+    if (!options.jsonPath.empty()) {
+        FILE *jsonFile = options.jsonPath == "-" ? stdout : fopen(options.jsonPath.c_str(), "w");
+        if (jsonFile == nullptr) {
+            fprintf(stderr, "Unable to write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        writeJson(jsonFile, options, result, stages, detector.getThreadingConfig());
+        if (jsonFile != stdout) {
+            fclose(jsonFile);
+        }
+    }
+
+    return 0;
+}
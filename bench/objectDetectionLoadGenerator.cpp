@@ -0,0 +1,305 @@
+//
+// Synthetic camera for end to end capacity tests of the module on a local yarpserver : publishes synthetic or
+// pre-recorded frames at a fixed resolution and rate, listens to the label and image outputs of the module and
+// matches them to the frames sent by the sequence number of their envelope.
+//
+// Usage : objectDetectionLoadGenerator [--name /objectDetectionLoad] [--width 640] [--height 480] [--rate 30]
+//                                      [--duration 30] [--images dir] [--synthetic_frames 16] [--drain 2]
+//                                      [--connect_timeout 10] [--json result.json | --json -]
+//
+// Ports : <name>/image:o      frames sent, to connect to /ObjectDetectionInfer/imageRGB:i
+//         <name>/label:i      from /ObjectDetectionInfer/label:o
+//         <name>/imageBoxes:i from /ObjectDetectionInfer/imageBoxes:o
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <yarp/os/all.h>
+#include <yarp/sig/all.h>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv/cv.hpp>
+
+#include "iCub/LatencyWindow.h"
+
+using namespace yarp::os;
+using namespace yarp::sig;
+
+
+struct DeliveryStats {
+    uint64_t delivered;         // frames of the sequence received at least once
+    uint64_t duplicates;
+    uint64_t reordered;         // received after a later frame
+    uint64_t unmatched;         // without a valid envelope or out of the sequence sent
+    double firstTime;           // reception of the first and last frames
+    double lastTime;
+    LatencyPercentiles latency;
+};
+
+/**
+ * Input port matching the outputs of the module to the frames sent, by the sequence number of their envelope.
+ * The time of the envelope is the sending time, the module runs on the same host
+ */
+template <class T>
+class DeliveryPort : public BufferedPort<T> {
+public:
+    /**
+     * @param t_frameCount frames that will be sent, numbered from 0
+     */
+    explicit DeliveryPort(size_t t_frameCount)
+            : m_received(t_frameCount, false), m_latencies(std::max<size_t>(t_frameCount, 1)),
+              m_stats({0, 0, 0, 0, 0.0, 0.0, {0, 0.0, 0.0, 0.0, 0.0}}), m_lastSequence(-1) {}
+
+    // only the envelope is matched, the content is not checked
+    void onRead(T &) override {
+        const double now = Time::now();
+        Stamp stamp;
+        this->getEnvelope(stamp);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int sequence = stamp.getCount();
+        if (!stamp.isValid() || sequence < 0 || static_cast<size_t>(sequence) >= m_received.size()) {
+            ++m_stats.unmatched;
+            return;
+        }
+        if (m_received[sequence]) {
+            ++m_stats.duplicates;
+            return;
+        }
+
+        m_received[sequence] = true;
+        m_latencies.add(now - stamp.getTime());
+        if (sequence < m_lastSequence) {
+            ++m_stats.reordered;
+        }
+        m_lastSequence = std::max(m_lastSequence, sequence);
+
+        if (m_stats.delivered++ == 0) {
+            m_stats.firstTime = now;
+        }
+        m_stats.lastTime = now;
+    }
+
+    DeliveryStats getStats() const {
+        DeliveryStats stats;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            stats = m_stats;
+        }
+        stats.latency = m_latencies.getPercentiles();
+
+        return stats;
+    }
+
+private:
+    std::vector<bool> m_received;
+    LatencyWindow m_latencies;
+    DeliveryStats m_stats;
+    int m_lastSequence;
+    mutable std::mutex m_mutex;
+};
+
+/**
+ * Frames published in a loop, already in the resolution and the RGB layout of the camera
+ * @param t_imagesPath directory of pre-recorded frames, empty for synthetic frames
+ * @param t_width
+ * @param t_height
+ * @param t_syntheticFrames number of synthetic frames
+ * @param t_frames
+ * @return false if no frame can be read
+ */
+static bool loadFrames(const std::string &t_imagesPath, int t_width, int t_height, int t_syntheticFrames,
+                       std::vector<cv::Mat> &t_frames) {
+    if (!t_imagesPath.empty()) {
+        std::vector<std::string> files;
+        cv::glob(t_imagesPath + "/*", files, false);
+
+        for (const std::string &file : files) {
+            cv::Mat image = cv::imread(file);
+            if (image.empty()) {
+                continue;
+            }
+            cv::Mat frame;
+            cv::resize(image, frame, cv::Size(t_width, t_height), 0, 0, CV_INTER_AREA);
+            cv::cvtColor(frame, frame, CV_BGR2RGB);
+            t_frames.push_back(frame);
+        }
+
+        return !t_frames.empty();
+    }
+
+    // noise with a moving block, so that consecutive frames differ
+    const int blockSize = std::max(1, std::min(t_width, t_height) / 4);
+    for (int i = 0; i < std::max(1, t_syntheticFrames); ++i) {
+        cv::Mat frame(t_height, t_width, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        const int x = (i * blockSize / 2) % std::max(1, t_width - blockSize);
+        const int y = (i * blockSize / 4) % std::max(1, t_height - blockSize);
+        cv::rectangle(frame, cv::Point(x, y), cv::Point(x + blockSize, y + blockSize), cv::Scalar(200, 40, 40), -1);
+        t_frames.push_back(frame);
+    }
+
+    return true;
+}
+
+static void printDelivery(FILE *t_file, const char *t_output, const DeliveryStats &t_stats, uint64_t t_sent,
+                          double t_sendStart) {
+    const double deliveredRate = t_stats.delivered > 0 ? t_stats.delivered / (t_stats.lastTime - t_sendStart) : 0.0;
+    fprintf(t_file, "%-12s delivered %8llu / %llu (%.2f frames/s) dropped %llu reordered %llu duplicates %llu "
+                    "unmatched %llu\n", t_output, static_cast<unsigned long long>(t_stats.delivered),
+            static_cast<unsigned long long>(t_sent), deliveredRate,
+            static_cast<unsigned long long>(t_sent - t_stats.delivered),
+            static_cast<unsigned long long>(t_stats.reordered), static_cast<unsigned long long>(t_stats.duplicates),
+            static_cast<unsigned long long>(t_stats.unmatched));
+    fprintf(t_file, "%-12s latency p50 %.2f ms p95 %.2f ms p99 %.2f ms max %.2f ms\n", "",
+            t_stats.latency.p50 * 1000.0, t_stats.latency.p95 * 1000.0, t_stats.latency.p99 * 1000.0,
+            t_stats.latency.max * 1000.0);
+}
+
+static void writeDeliveryJson(FILE *t_file, const char *t_output, const DeliveryStats &t_stats, uint64_t t_sent,
+                              double t_sendStart, bool t_last) {
+    const double deliveredRate = t_stats.delivered > 0 ? t_stats.delivered / (t_stats.lastTime - t_sendStart) : 0.0;
+    fprintf(t_file, "  \"%s\": {\"delivered\": %llu, \"dropped\": %llu, \"reordered\": %llu, \"duplicates\": %llu, "
+                    "\"unmatched\": %llu, \"delivered_fps\": %.3f, \"latency_ms\": {\"p50\": %.3f, \"p95\": %.3f, "
+                    "\"p99\": %.3f, \"max\": %.3f}}%s\n", t_output,
+            static_cast<unsigned long long>(t_stats.delivered),
+            static_cast<unsigned long long>(t_sent - t_stats.delivered),
+            static_cast<unsigned long long>(t_stats.reordered), static_cast<unsigned long long>(t_stats.duplicates),
+            static_cast<unsigned long long>(t_stats.unmatched), deliveredRate, t_stats.latency.p50 * 1000.0,
+            t_stats.latency.p95 * 1000.0, t_stats.latency.p99 * 1000.0, t_stats.latency.max * 1000.0,
+            t_last ? "" : ",");
+}
+
+
+int main(int argc, char *argv[]) {
+
+    Network yarp;
+    if (!Network::checkNetwork()) {
+        yError("No yarpserver found\n");
+        return 1;
+    }
+
+    ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    const std::string name = rf.check("name", Value("/objectDetectionLoad"), "Prefix of the ports (string)").asString();
+    const int width = rf.check("width", Value(640), "Width of the frames sent (int)").asInt();
+    const int height = rf.check("height", Value(480), "Height of the frames sent (int)").asInt();
+    const double rate = rf.check("rate", Value(30.0), "Frames sent per second (double)").asDouble();
+    const double duration = rf.check("duration", Value(30.0), "Duration of the test (s)").asDouble();
+    const std::string imagesPath = rf.check("images", Value(""), "Directory of pre-recorded frames (string)").asString();
+    const int syntheticFrames = rf.check("synthetic_frames", Value(16), "Synthetic frames sent in a loop (int)").asInt();
+    const double drain = rf.check("drain", Value(2.0), "Wait for the last outputs after the test (s)").asDouble();
+    const double connectTimeout = rf.check("connect_timeout", Value(10.0),
+                                           "Wait for the connections before sending (s)").asDouble();
+    const std::string jsonPath = rf.check("json", Value(""), "Result file, - for the standard output (string)").asString();
+
+    std::vector<cv::Mat> frames;
+    if (width <= 0 || height <= 0 || rate <= 0.0 || !loadFrames(imagesPath, width, height, syntheticFrames, frames)) {
+        yError("No frame to send\n");
+        return 1;
+    }
+
+    const uint64_t frameCount = static_cast<uint64_t>(std::max(1.0, rate * duration));
+
+    BufferedPort<ImageOf<PixelRgb> > imagePort;
+    DeliveryPort<Bottle> labelPort(frameCount);
+    DeliveryPort<ImageOf<PixelRgb> > imageBoxesPort(frameCount);
+    labelPort.useCallback();
+    imageBoxesPort.useCallback();
+
+    if (!imagePort.open(name + "/image:o") || !labelPort.open(name + "/label:i") ||
+        !imageBoxesPort.open(name + "/imageBoxes:i")) {
+        yError("Unable to open the ports of %s\n", name.c_str());
+        return 1;
+    }
+
+    // the connections are made by the application
+    const double connectStart = Time::now();
+    while ((imagePort.getOutputCount() == 0 || labelPort.getInputCount() == 0 ||
+            imageBoxesPort.getInputCount() == 0) && Time::now() - connectStart < connectTimeout) {
+        Time::delay(0.1);
+    }
+    if (imagePort.getOutputCount() == 0) {
+        yError("Nothing is connected to %s/image:o\n", name.c_str());
+        return 1;
+    }
+    if (labelPort.getInputCount() == 0 || imageBoxesPort.getInputCount() == 0) {
+        yWarning("An output of the module is not connected, its deliveries will be 0\n");
+    }
+
+    yInfo("Sending %llu frames %dx%d at %.1f frames/s\n", static_cast<unsigned long long>(frameCount), width, height,
+          rate);
+
+    // frames sent on an absolute schedule, a late frame does not delay the next ones
+    const double sendStart = Time::now();
+    uint64_t lateFrames = 0;
+    for (uint64_t sequence = 0; sequence < frameCount; ++sequence) {
+        const double deadline = sendStart + sequence / rate;
+        const double now = Time::now();
+        if (now < deadline) {
+            Time::delay(deadline - now);
+        }
+        else if (now - deadline > 1.0 / rate) {
+            ++lateFrames;
+        }
+
+        const cv::Mat &frame = frames[sequence % frames.size()];
+        ImageOf<PixelRgb> &image = imagePort.prepare();
+        image.resize(width, height);
+        for (int row = 0; row < height; ++row) {
+            memcpy(image.getRow(static_cast<size_t>(row)), frame.ptr(row), 3 * static_cast<size_t>(width));
+        }
+
+        imagePort.setEnvelope(Stamp(static_cast<int>(sequence), Time::now()));
+        imagePort.write();
+    }
+    const double sendEnd = Time::now();
+
+    Time::delay(drain);
+
+    const DeliveryStats labelStats = labelPort.getStats();
+    const DeliveryStats imageBoxesStats = imageBoxesPort.getStats();
+
+    FILE *report = jsonPath == "-" ? stderr : stdout;
+    fprintf(report, "%-12s %8llu frames in %.2f s (%.2f frames/s) late %llu\n", "sent",
+            static_cast<unsigned long long>(frameCount), sendEnd - sendStart, frameCount / (sendEnd - sendStart),
+            static_cast<unsigned long long>(lateFrames));
+    printDelivery(report, "label", labelStats, frameCount, sendStart);
+    printDelivery(report, "imageBoxes", imageBoxesStats, frameCount, sendStart);
+
+    if (!jsonPath.empty()) {
+        FILE *jsonFile = jsonPath == "-" ? stdout : fopen(jsonPath.c_str(), "w");
+        if (jsonFile == nullptr) {
+            yError("Unable to write %s\n", jsonPath.c_str());
+        }
+        else {
+            fprintf(jsonFile, "{\n");
+            fprintf(jsonFile, "  \"width\": %d,\n  \"height\": %d,\n  \"rate\": %.3f,\n", width, height, rate);
+            fprintf(jsonFile, "  \"sent\": %llu,\n  \"late\": %llu,\n  \"sent_fps\": %.3f,\n",
+                    static_cast<unsigned long long>(frameCount), static_cast<unsigned long long>(lateFrames),
+                    frameCount / (sendEnd - sendStart));
+            writeDeliveryJson(jsonFile, "label", labelStats, frameCount, sendStart, false);
+            writeDeliveryJson(jsonFile, "imageBoxes", imageBoxesStats, frameCount, sendStart, true);
+            fprintf(jsonFile, "}\n");
+            if (jsonFile != stdout) {
+                fclose(jsonFile);
+            }
+        }
+    }
+
+    imagePort.interrupt();
+    labelPort.interrupt();
+    imageBoxesPort.interrupt();
+    imagePort.close();
+    labelPort.close();
+    imageBoxesPort.close();
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+//
+// Microbenchmarks of the hot path kernels of the detection, independent of YARP and Tensorflow.
+//
+// Usage : objectDetectionMicroBench [--width 640] [--height 480] [--iterations 1000]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv/cv.hpp>
+
+#include "iCub/DetectionKernels.h"
+#include "iCub/ImageKernels.h"
+#include "iCub/MotionGate.h"
+
+
+struct BenchOptions {
+    int width;
+    int height;
+    int iterations;
+};
+
+/**
+ * Run a kernel and print its mean time per call
+ * @param t_name
+ * @param t_iterations
+ * @param t_bytes bytes processed per call, used for the bandwidth
+ * @param t_kernel
+ * @return mean time per call in microseconds
+ */
+static double runBench(const std::string &t_name, int t_iterations, size_t t_bytes,
+                       const std::function<void()> &t_kernel) {
+    // warm up the caches and the branch predictors
+    for (int i = 0; i < t_iterations / 10 + 1; ++i) {
+        t_kernel();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < t_iterations; ++i) {
+        t_kernel();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double meanUs = std::chrono::duration<double, std::micro>(end - start).count() / t_iterations;
+    printf("%-40s %10.2f us %10.2f MB/s\n", t_name.c_str(), meanUs, t_bytes / meanUs);
+
+    return meanUs;
+}
+
+/**
+ * BGR->RGB conversion of a camera frame into the input tensor memory :
+ * in place cvtColor followed by a copy (previous path) against the fused kernel
+ */
+static void benchSwapRedBlue(const BenchOptions &t_options) {
+    printf("\n-- colour swizzle + copy %dx%d --\n", t_options.width, t_options.height);
+
+    cv::Mat cameraImage(t_options.height, t_options.width, CV_8UC3);
+    for (size_t i = 0; i < cameraImage.total() * 3; ++i) {
+        cameraImage.data[i] = static_cast<unsigned char>(rand());
+    }
+    std::vector<uint8_t> tensorMemory(cameraImage.total() * 3);
+    cv::Mat tensorImage(t_options.height, t_options.width, CV_8UC3, tensorMemory.data());
+
+    const size_t frameBytes = tensorMemory.size();
+    const double twoPassUs = runBench("two pass cvtColor + copyTo", t_options.iterations, frameBytes, [&] {
+        cv::cvtColor(cameraImage, cameraImage, CV_BGR2RGB);
+        cameraImage.copyTo(tensorImage);
+    });
+
+    const KernelIsa cpuIsa = detectKernelIsa();
+    const KernelIsa isas[] = {KernelIsa::Scalar, KernelIsa::SSSE3, KernelIsa::AVX2};
+    for (KernelIsa isa : isas) {
+        if (static_cast<int>(isa) > static_cast<int>(cpuIsa)) {
+            continue;
+        }
+
+        const double fusedUs = runBench(std::string("fused swapRedBlueCopy ") + kernelIsaName(isa),
+                                        t_options.iterations, frameBytes, [&] {
+                    swapRedBlueCopy(isa, cameraImage.data, cameraImage.step, tensorMemory.data(),
+                                    3 * static_cast<size_t>(t_options.width), t_options.width, t_options.height);
+                });
+        printf("%-40s %10.2fx\n", "  speedup", twoPassUs / fusedUs);
+    }
+}
+
+/**
+ * Conversion of a camera frame into a 300x300 model input : cv::resize followed by the colour conversion
+ * and a copy against the fused resize kernel, stretched and letterboxed
+ */
+static void benchResizeSwapRedBlue(const BenchOptions &t_options) {
+    const int targetSize = 300;
+    printf("\n-- resize + colour swizzle %dx%d -> %dx%d --\n", t_options.width, t_options.height, targetSize,
+           targetSize);
+
+    cv::Mat cameraImage(t_options.height, t_options.width, CV_8UC3);
+    for (size_t i = 0; i < cameraImage.total() * 3; ++i) {
+        cameraImage.data[i] = static_cast<unsigned char>(rand());
+    }
+    std::vector<uint8_t> tensorMemory(3 * targetSize * targetSize);
+    cv::Mat tensorImage(targetSize, targetSize, CV_8UC3, tensorMemory.data());
+    cv::Mat resizedImage;
+
+    const size_t frameBytes = cameraImage.total() * 3;
+    printf("%-40s %10zu bytes\n", "input tensor saved", frameBytes - tensorMemory.size());
+
+    const double opencvUs = runBench("cv::resize + cvtColor + copyTo", t_options.iterations, frameBytes, [&] {
+        cv::resize(cameraImage, resizedImage, cv::Size(targetSize, targetSize), 0, 0, CV_INTER_LINEAR);
+        cv::cvtColor(resizedImage, resizedImage, CV_BGR2RGB);
+        resizedImage.copyTo(tensorImage);
+    });
+
+    const KernelIsa cpuIsa = detectKernelIsa();
+    const KernelIsa isas[] = {KernelIsa::Scalar, KernelIsa::SSSE3};
+    for (int letterbox = 0; letterbox < 2; ++letterbox) {
+        const ResizePlan plan = buildResizePlan(computeResizeGeometry(t_options.width, t_options.height, targetSize,
+                                                                      targetSize, letterbox != 0));
+        for (KernelIsa isa : isas) {
+            if (static_cast<int>(isa) > static_cast<int>(cpuIsa)) {
+                continue;
+            }
+
+            const std::string name = std::string(letterbox ? "fused resizeSwapRedBlue letterbox " :
+                                                 "fused resizeSwapRedBlue ") + kernelIsaName(isa);
+            const double fusedUs = runBench(name, t_options.iterations, frameBytes, [&] {
+                resizeSwapRedBlue(isa, cameraImage.data, cameraImage.step, tensorMemory.data(), 3 * targetSize,
+                                  plan, 0);
+            });
+            printf("%-40s %10.2fx\n", "  speedup", opencvUs / fusedUs);
+        }
+    }
+}
+
+/**
+ * Postprocessing of the outputs of a graph with 100, 1k and 10k candidates : score threshold of the previous
+ * branching loop against the compaction kernels applying the per class thresholds and the class mask, then the
+ * class-wise suppression and top-k of sorted and unsorted candidates
+ */
+static void benchPostprocess(const BenchOptions &t_options) {
+    const size_t candidateCounts[] = {100, 1000, 10000};
+    const size_t topK = 100;
+    const float iouThreshold = 0.5f;
+
+    ClassFilter classFilter(0.5f);
+    classFilter.setClassThreshold(1, 0.3f);
+    classFilter.denyClasses({62, 63});
+
+    const KernelIsa cpuIsa = detectKernelIsa();
+    const KernelIsa isas[] = {KernelIsa::Scalar, KernelIsa::SSSE3, KernelIsa::AVX2};
+
+    for (const size_t candidateCount : candidateCounts) {
+        printf("\n-- postprocessing %zu candidates, top %zu --\n", candidateCount, topK);
+
+        // boxes ymin xmin ymax xmax normalised, uniform scores and 90 classes as the COCO graphs
+        std::vector<float> boxes(4 * candidateCount);
+        std::vector<float> scores(candidateCount);
+        std::vector<float> classes(candidateCount);
+        for (size_t i = 0; i < candidateCount; ++i) {
+            const float y = (rand() % 900) / 1000.0f;
+            const float x = (rand() % 900) / 1000.0f;
+            boxes[4 * i] = y;
+            boxes[4 * i + 1] = x;
+            boxes[4 * i + 2] = y + 0.02f + (rand() % 80) / 1000.0f;
+            boxes[4 * i + 3] = x + 0.02f + (rand() % 80) / 1000.0f;
+            scores[i] = (rand() % 1000) / 1000.0f;
+            classes[i] = static_cast<float>(1 + rand() % 90);
+        }
+        std::vector<float> sortedScores(scores);
+        std::sort(sortedScores.begin(), sortedScores.end(), [](float t_a, float t_b) {
+            return t_a > t_b;
+        });
+
+        std::vector<int32_t> indices(candidateCount);
+        const size_t scoreBytes = 2 * candidateCount * sizeof(float);
+        const double branchUs = runBench("branching threshold loop", t_options.iterations, scoreBytes, [&] {
+            size_t kept = 0;
+            for (size_t i = 0; i < candidateCount; ++i) {
+                if (scores[i] > classFilter.getThreshold()) {
+                    indices[kept++] = static_cast<int32_t>(i);
+                }
+            }
+        });
+
+        size_t keptCount = 0;
+        for (KernelIsa isa : isas) {
+            if (static_cast<int>(isa) > static_cast<int>(cpuIsa)) {
+                continue;
+            }
+
+            const double compactUs = runBench(std::string("compactCandidates ") + kernelIsaName(isa),
+                                              t_options.iterations, scoreBytes, [&] {
+                        keptCount = compactCandidates(isa, scores.data(), classes.data(), candidateCount,
+                                                      classFilter, indices.data());
+                    });
+            printf("%-40s %10.2fx\n", "  speedup", branchUs / compactUs);
+        }
+        printf("%-40s %10zu\n", "candidates above threshold", keptCount);
+
+        std::vector<int32_t> candidates(keptCount);
+        std::vector<int32_t> selected;
+        const size_t boxBytes = keptCount * 6 * sizeof(float);
+        for (KernelIsa isa : isas) {
+            if (static_cast<int>(isa) > static_cast<int>(cpuIsa)) {
+                continue;
+            }
+
+            runBench(std::string("top-k + nms sorted ") + kernelIsaName(isa), t_options.iterations, boxBytes, [&] {
+                std::copy(indices.begin(), indices.begin() + keptCount, candidates.begin());
+                selectDetections(isa, boxes.data(), sortedScores.data(), classes.data(), candidates.data(),
+                                 keptCount, iouThreshold, topK, &selected);
+            });
+            runBench(std::string("top-k + nms unsorted ") + kernelIsaName(isa), t_options.iterations, boxBytes, [&] {
+                std::copy(indices.begin(), indices.begin() + keptCount, candidates.begin());
+                selectDetections(isa, boxes.data(), scores.data(), classes.data(), candidates.data(), keptCount,
+                                 iouThreshold, topK, &selected);
+            });
+        }
+        printf("%-40s %10zu\n", "detections kept", selected.size());
+    }
+}
+
+/**
+ * Motion check of a camera frame before its inference : grey thumbnail sampling, per block differences with
+ * the last inferred thumbnail for each instruction set, and the whole check of the gate
+ */
+static void benchMotionCheck(const BenchOptions &t_options) {
+    printf("\n-- motion check %dx%d -> %dx%d thumbnail --\n", t_options.width, t_options.height,
+           MotionGate::ThumbnailWidth, MotionGate::ThumbnailHeight);
+
+    cv::Mat cameraImage(t_options.height, t_options.width, CV_8UC3);
+    for (size_t i = 0; i < cameraImage.total() * 3; ++i) {
+        cameraImage.data[i] = static_cast<unsigned char>(rand());
+    }
+
+    const size_t thumbnailBytes = MotionGate::ThumbnailWidth * MotionGate::ThumbnailHeight;
+    std::vector<uint8_t> thumbnail(thumbnailBytes);
+    std::vector<uint8_t> reference(thumbnailBytes);
+    for (uint8_t &grey : reference) {
+        grey = static_cast<uint8_t>(rand());
+    }
+    std::vector<uint32_t> blockSums(thumbnailBytes / (kDifferenceBlockSize * kDifferenceBlockSize));
+
+    runBench("sampleGreyThumbnail", t_options.iterations, thumbnailBytes, [&] {
+        sampleGreyThumbnail(cameraImage.data, cameraImage.step, t_options.width, t_options.height, thumbnail.data(),
+                            MotionGate::ThumbnailWidth, MotionGate::ThumbnailHeight);
+    });
+
+    const KernelIsa cpuIsa = detectKernelIsa();
+    const KernelIsa isas[] = {KernelIsa::Scalar, KernelIsa::SSSE3, KernelIsa::AVX2};
+    for (KernelIsa isa : isas) {
+        if (static_cast<int>(isa) > static_cast<int>(cpuIsa)) {
+            continue;
+        }
+
+        runBench(std::string("blockAbsoluteDifferences ") + kernelIsaName(isa), t_options.iterations,
+                 2 * thumbnailBytes, [&] {
+                    blockAbsoluteDifferences(isa, thumbnail.data(), reference.data(), MotionGate::ThumbnailWidth,
+                                             MotionGate::ThumbnailHeight, blockSums.data());
+                });
+    }
+
+    MotionGate gate;
+    gate.configure({4.0, 1, 30});
+    gate.frameChanged(0, cameraImage.data, cameraImage.step, t_options.width, t_options.height);
+    std::vector<uint8_t> inferredThumbnail;
+    gate.takeThumbnail(0, &inferredThumbnail);
+    gate.commitReference(0, &inferredThumbnail);
+    runBench("MotionGate::frameChanged", t_options.iterations, cameraImage.total() * 3, [&] {
+        gate.frameChanged(0, cameraImage.data, cameraImage.step, t_options.width, t_options.height);
+    });
+}
+
+
+int main(int argc, char *argv[]) {
+    BenchOptions options = {640, 480, 1000};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--width")) {
+            options.width = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--height")) {
+            options.height = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--iterations")) {
+            options.iterations = atoi(argv[i + 1]);
+        }
+    }
+
+    printf("Kernels dispatched to %s\n", kernelIsaName(detectKernelIsa()));
+
+    benchSwapRedBlue(options);
+    benchResizeSwapRedBlue(options);
+    benchPostprocess(options);
+    benchMotionCheck(options);
+
+    return 0;
+}
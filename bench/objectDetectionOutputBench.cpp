@@ -0,0 +1,196 @@
+//
+// Benchmark of the formats of the label port : cost of filling the Bottle on the module side, size on the wire and
+// cost of decoding it on the consumer side, for the legacy string, the typed lists and the binary blob.
+//
+// Usage : objectDetectionOutputBench [--iterations 10000]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "iCub/DetectionOutput.h"
+
+
+// Detection as a consumer of the label port uses it
+struct DecodedDetection {
+    std::string label;
+    int classId;
+    double score;
+    int box[4];
+};
+
+/**
+ * Run a function and return its mean time per call
+ * @param t_iterations
+ * @param t_function
+ * @return mean time per call in microseconds
+ */
+static double meanTimeUs(int t_iterations, const std::function<void()> &t_function) {
+    for (int i = 0; i < t_iterations / 10 + 1; ++i) {
+        t_function();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < t_iterations; ++i) {
+        t_function();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / t_iterations;
+}
+
+/**
+ * Detections as extracted from the graph, numbered per class
+ * @param t_count
+ * @param t_labels filled with the labels of the classes
+ * @param t_objectsDetected
+ */
+static void makeDetections(int t_count, LabelTable &t_labels, DetectionBuffer &t_objectsDetected) {
+    const char *labels[] = {"person", "cup", "bottle", "chair", "book", "laptop", "keyboard", "cell phone"};
+    const int labelCount = sizeof(labels) / sizeof(labels[0]);
+    std::map<int, std::string> labelNames;
+    for (int classId = 1; classId <= labelCount; ++classId) {
+        labelNames[classId] = labels[classId - 1];
+    }
+    t_labels.assign(labelNames);
+
+    std::vector<int32_t> instanceCounts(labelCount + 1, 0);
+    t_objectsDetected.reset(static_cast<size_t>(t_count));
+    for (int i = 0; i < t_count; ++i) {
+        const int classId = 1 + rand() % labelCount;
+        const int x = rand() % 600;
+        const int y = rand() % 440;
+        const Detection detection = {classId, instanceCounts[classId]++, 0.5f + (rand() % 500) / 1000.0f,
+                                     {x, y, x + 40, y + 40}};
+        t_objectsDetected.push(detection);
+    }
+}
+
+/**
+ * Decode a Bottle read on the label port
+ * @param t_format
+ * @param t_input
+ * @param t_detections
+ */
+static void decodeDetections(LabelFormat t_format, const yarp::os::Bottle &t_input,
+                             std::vector<DecodedDetection> &t_detections) {
+    t_detections.clear();
+
+    switch (t_format) {
+        case LabelFormat::List:
+            for (int i = 0; i < t_input.size(); ++i) {
+                const yarp::os::Bottle *item = t_input.get(i).asList();
+                DecodedDetection detection;
+                detection.classId = item->get(0).asInt();
+                detection.label = item->get(1).asString();
+                detection.score = item->get(2).asDouble();
+                for (int c = 0; c < 4; ++c) {
+                    detection.box[c] = item->get(3 + c).asInt();
+                }
+                t_detections.push_back(detection);
+            }
+            break;
+
+        case LabelFormat::Blob: {
+            const char *blob = t_input.get(0).asBlob();
+            DetectionBlobHeader header;
+            memcpy(&header, blob, sizeof(header));
+
+            const char *recordData = blob + sizeof(header);
+            for (uint32_t i = 0; i < header.count; ++i) {
+                DetectionRecord record;
+                memcpy(&record, recordData + i * sizeof(record), sizeof(record));
+
+                DecodedDetection detection;
+                detection.classId = record.classId;
+                detection.score = record.score;
+                memcpy(detection.box, record.box, sizeof(detection.box));
+                t_detections.push_back(detection);
+            }
+            break;
+        }
+
+        default: {
+            // "label : x1 y1 x2 y2 score ; ..." as parsed by the legacy consumers
+            const std::string labels = t_input.get(0).asString();
+            size_t begin = 0;
+            size_t end;
+            while ((end = labels.find(" ; ", begin)) != std::string::npos) {
+                const std::string item = labels.substr(begin, end - begin);
+                const size_t separator = item.find(" : ");
+
+                DecodedDetection detection;
+                detection.classId = -1;
+                detection.label = item.substr(0, separator);
+                sscanf(item.c_str() + separator + 3, "%d %d %d %d %lf", &detection.box[0], &detection.box[1],
+                       &detection.box[2], &detection.box[3], &detection.score);
+                t_detections.push_back(detection);
+
+                begin = end + 3;
+            }
+            break;
+        }
+    }
+}
+
+static void benchFormats(int t_detectionCount, int t_iterations) {
+    printf("\n-- %d detections --\n", t_detectionCount);
+    printf("%-10s %12s %12s %12s\n", "format", "write (us)", "bytes", "read (us)");
+
+    LabelTable labels;
+    DetectionBuffer objectsDetected;
+    makeDetections(t_detectionCount, labels, objectsDetected);
+    const LabelFormat formats[] = {LabelFormat::String, LabelFormat::List, LabelFormat::Blob};
+
+    for (LabelFormat format : formats) {
+        yarp::os::Bottle output;
+        std::vector<char> blobBuffer;
+        const double writeUs = meanTimeUs(t_iterations, [&] {
+            output.clear();
+            writeDetections(format, objectsDetected, labels, blobBuffer, output);
+        });
+
+        // what travels on the port and what the consumer receives
+        size_t wireSize = 0;
+        const char *wireData = output.toBinary(&wireSize);
+        const std::string wire(wireData, wireSize);
+
+        yarp::os::Bottle input;
+        std::vector<DecodedDetection> detections;
+        const double readUs = meanTimeUs(t_iterations, [&] {
+            input.fromBinary(wire.data(), static_cast<int>(wire.size()));
+            decodeDetections(format, input, detections);
+        });
+
+        if (detections.size() != objectsDetected.size()) {
+            printf("%s : %zu detections decoded instead of %zu\n", labelFormatName(format), detections.size(),
+                   objectsDetected.size());
+        }
+
+        printf("%-10s %12.2f %12zu %12.2f\n", labelFormatName(format), writeUs, wireSize, readUs);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    int iterations = 10000;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--iterations")) {
+            iterations = atoi(argv[i + 1]);
+        }
+    }
+
+    const int detectionCounts[] = {5, 20, 100};
+    for (int detectionCount : detectionCounts) {
+        benchFormats(detectionCount, iterations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef _BoundedQueue_H_
+#define _BoundedQueue_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+
+/**
+ * Fixed capacity blocking queue used to connect the stages of the detection pipeline
+ */
+template<typename T>
+class BoundedQueue {
+public:
+    /**
+     * Constructor
+     * @param t_capacity maximum number of items waiting in the queue
+     */
+    explicit BoundedQueue(size_t t_capacity) : m_capacity(t_capacity > 0 ? t_capacity : 1), m_closed(false),
+                                               m_dropped(0) {}
+
+    /**
+     * Push an item, blocking while the queue is full
+     * @param t_item
+     * @return false if the queue has been closed
+     */
+    bool push(T t_item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed) {
+            return false;
+        }
+
+        m_items.push_back(std::move(t_item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Push an item without blocking, discarding the oldest waiting item when the queue is full.
+     * Used by producers that must never fall behind a live stream.
+     * @param t_item
+     * @return false if the queue has been closed
+     */
+    bool pushDropOldest(T t_item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return false;
+        }
+
+        if (m_items.size() >= m_capacity) {
+            m_items.pop_front();
+            ++m_dropped;
+        }
+
+        m_items.push_back(std::move(t_item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Pop the oldest item, blocking while the queue is empty
+     * @param t_item
+     * @return false if the queue has been closed
+     */
+    bool pop(T &t_item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_closed) {
+            return false;
+        }
+
+        t_item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Wake up every blocked producer and consumer, following calls fail
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_items.clear();
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    /**
+     * @return number of items currently waiting in the queue
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    /**
+     * @return number of items discarded by pushDropOldest
+     */
+    size_t dropped() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dropped;
+    }
+
+private:
+    const size_t m_capacity;
+    bool m_closed;
+    size_t m_dropped;
+
+    std::deque<T> m_items;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+#endif  //_BoundedQueue_H_
@@ -0,0 +1,196 @@
+#ifndef OBJECTRECOGNITIONINFER_DetectionBuffer_H
+#define OBJECTRECOGNITIONINFER_DetectionBuffer_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/**
+ * One detected object, the display name is resolved from the class id only when the detections are output
+ */
+struct Detection {
+    int32_t classId;
+    int32_t instance;           // 0 for the first object of its class in the frame, then 1, 2...
+    float score;
+    int32_t box[4];             // x1 y1 x2 y2 in the source image coordinates
+};
+
+static_assert(std::is_pod<Detection>::value, "Detection is copied as raw memory");
+
+/**
+ * @param t_first
+ * @param t_second
+ * @return intersection over union of the boxes of two detections, 0 if they do not overlap
+ */
+inline float detectionIoU(const Detection &t_first, const Detection &t_second) {
+    const int32_t width = std::min(t_first.box[2], t_second.box[2]) - std::max(t_first.box[0], t_second.box[0]);
+    const int32_t height = std::min(t_first.box[3], t_second.box[3]) - std::max(t_first.box[1], t_second.box[1]);
+    if (width <= 0 || height <= 0) {
+        return 0.0f;
+    }
+
+    const float intersection = static_cast<float>(width) * height;
+    const float firstArea = static_cast<float>(t_first.box[2] - t_first.box[0]) * (t_first.box[3] - t_first.box[1]);
+    const float secondArea = static_cast<float>(t_second.box[2] - t_second.box[0]) *
+                             (t_second.box[3] - t_second.box[1]);
+    return intersection / (firstArea + secondArea - intersection);
+}
+
+
+/**
+ * Detections of one frame in a contiguous array, in the order of the graph outputs (decreasing score).
+ * The storage is allocated once for the capacity, the buffers of the frames are recycled by a DetectionBufferPool
+ */
+class DetectionBuffer {
+public:
+    DetectionBuffer() : m_capacity(0), m_size(0) {}
+
+    /**
+     * Empty the buffer, allocating its storage only if it is smaller than the capacity
+     * @param t_capacity maximum number of detections
+     */
+    void reset(size_t t_capacity) {
+        if (m_detections.size() < t_capacity) {
+            m_detections.resize(t_capacity);
+        }
+        m_capacity = t_capacity;
+        m_size = 0;
+    }
+
+    void clear() {
+        m_size = 0;
+    }
+
+    /**
+     * Exchange the detections and the storage of two buffers, without copying
+     * @param t_other
+     */
+    void swap(DetectionBuffer &t_other) {
+        m_detections.swap(t_other.m_detections);
+        std::swap(m_capacity, t_other.m_capacity);
+        std::swap(m_size, t_other.m_size);
+    }
+
+    /**
+     * Append a detection
+     * @param t_detection
+     * @return false if the buffer is full
+     */
+    bool push(const Detection &t_detection) {
+        if (m_size >= m_capacity) {
+            return false;
+        }
+        m_detections[m_size++] = t_detection;
+        return true;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    const Detection &operator[](size_t t_index) const {
+        return m_detections[t_index];
+    }
+
+    const Detection *begin() const {
+        return m_detections.data();
+    }
+
+    const Detection *end() const {
+        return m_detections.data() + m_size;
+    }
+
+private:
+    std::vector<Detection> m_detections;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+
+/**
+ * Free list of detection buffers : a frame takes its buffers from the pool of its camera and gives them back
+ * when it is destroyed, so the following frames reuse their storage instead of allocating it. Thread safe
+ */
+class DetectionBufferPool {
+public:
+    DetectionBufferPool() : m_hits(0), m_misses(0) {}
+
+    /**
+     * Preallocate buffers so that the first frames do not allocate
+     * @param t_count buffers waiting in the pool
+     * @param t_capacity maximum number of detections of each
+     */
+    void reserve(size_t t_count, size_t t_capacity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeBuffers.reserve(std::max(m_freeBuffers.capacity(), 2 * t_count));
+        for (DetectionBuffer &buffer : m_freeBuffers) {
+            buffer.reset(t_capacity);
+        }
+        while (m_freeBuffers.size() < t_count) {
+            m_freeBuffers.emplace_back();
+            m_freeBuffers.back().reset(t_capacity);
+        }
+    }
+
+    /**
+     * @return an empty buffer, with the storage of a released one if any
+     */
+    DetectionBuffer acquire() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeBuffers.empty()) {
+            ++m_misses;
+            return DetectionBuffer();
+        }
+
+        ++m_hits;
+        DetectionBuffer buffer = std::move(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+        buffer.clear();
+        return buffer;
+    }
+
+    /**
+     * Give back the storage of a buffer, the buffer is left without storage
+     * @param t_buffer
+     */
+    void release(DetectionBuffer &t_buffer) {
+        if (t_buffer.capacity() == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeBuffers.emplace_back();
+        m_freeBuffers.back().swap(t_buffer);
+    }
+
+    uint64_t hits() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+
+    uint64_t misses() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_misses;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<DetectionBuffer> m_freeBuffers;
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+#endif //OBJECTRECOGNITIONINFER_DetectionBuffer_H
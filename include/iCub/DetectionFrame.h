@@ -0,0 +1,141 @@
+#ifndef _DetectionFrame_H_
+#define _DetectionFrame_H_
+
+#include <yarp/sig/all.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Time.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflowObjectDetection.h"
+
+
+typedef yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > ImagePort;
+
+/**
+ * Detections of a frame by one of the additional models
+ */
+struct ModelDetections {
+    DetectionBuffer objectsDetected;
+    std::string detectedLabels;                 // only built for the string label format
+    std::shared_ptr<const LabelTable> labels;
+};
+
+/**
+ * A frame owns the image it was read from without copying it : the buffer is acquired from the input port
+ * and handed back to the port when the last stage holding the frame releases it. Its detection buffers are
+ * taken from the pool of its camera and handed back the same way.
+ */
+struct DetectionFrame {
+    /**
+     * Take the ownership of the last image read on a port
+     * @param t_sourcePort port on which the image has just been read
+     * @param t_image image returned by the read
+     * @param t_cameraIndex index of the camera the port is connected to
+     * @param t_detectionPool pool of the camera, it must outlive the frame
+     */
+    DetectionFrame(ImagePort &t_sourcePort, yarp::sig::ImageOf<yarp::sig::PixelRgb> &t_image, size_t t_cameraIndex,
+                   DetectionBufferPool &t_detectionPool)
+            : image(t_image), cameraIndex(t_cameraIndex), receivedTime(yarp::os::Time::now()),
+              objectsDetected(t_detectionPool.acquire()), detectionPool(&t_detectionPool),
+              sourcePort(&t_sourcePort), portHandle(t_sourcePort.acquire()) {
+        t_sourcePort.getEnvelope(stamp);
+    }
+
+    ~DetectionFrame() {
+        detectionPool->release(objectsDetected);
+        for (ModelDetections &additional : additionalDetections) {
+            detectionPool->release(additional.objectsDetected);
+        }
+
+        if (portHandle != nullptr) {
+            sourcePort->release(portHandle);
+        }
+    }
+
+    /**
+     * @return an empty buffer of the pool of the camera, handed back with the frame if stored in it
+     */
+    DetectionBuffer acquireDetectionBuffer() {
+        return detectionPool->acquire();
+    }
+
+    DetectionFrame(const DetectionFrame &) = delete;
+    DetectionFrame &operator=(const DetectionFrame &) = delete;
+
+    // Image read on the input port, shared by all the stages
+    yarp::sig::ImageOf<yarp::sig::PixelRgb> &image;
+
+    // Camera the image comes from, envelope it was sent with and local time it was read at
+    size_t cameraIndex;
+    yarp::os::Stamp stamp;
+    double receivedTime;
+
+    // Placement of the image in the input of the graph (preprocess stage)
+    ResizeGeometry geometry;
+
+    // Tiles of the image in the input of the graph, in the tiled mode (preprocess stage)
+    TiledFrame tiles;
+
+    // Grey thumbnail compared by the motion gating, the reference of the next frames once inferred (dispatch stage)
+    std::vector<uint8_t> motionThumbnail;
+
+    // Detected objects and their string representation, only built for the string label format (publish stage)
+    DetectionBuffer objectsDetected;
+    std::string detectedLabels;
+
+    // Labels of the model that inferred the frame, they keep that model alive until the frame is published even
+    // if another model was swapped in meanwhile (postprocess stage)
+    std::shared_ptr<const LabelTable> labels;
+
+    // Detections of the additional models, in the order of the models parameter (postprocess stage)
+    std::vector<ModelDetections> additionalDetections;
+
+private:
+    DetectionBufferPool *detectionPool;
+    ImagePort *sourcePort;
+    void *portHandle;
+};
+
+typedef std::shared_ptr<DetectionFrame> FramePtr;
+
+
+/**
+ * Frames of all the cameras captured at the same time, inferred together in one batched Session::Run
+ */
+struct DetectionBatch {
+    // Order of capture, the batches inferred concurrently are published in this order
+    uint64_t sequence = 0;
+
+    // Model converting, inferring and postprocessing the batch, taken once when its inference starts
+    std::shared_ptr<tensorflowObjectDetection> detector;
+
+    // False if the conversion or the inference failed, nothing is published for the batch
+    bool inferred = false;
+
+    // Not inferred, its detections are predicted from the tracks of the previous inferences (dispatch stage)
+    bool tracked = false;
+
+    // Not inferred, the scene did not change : the detections of the last inferred frames are published again
+    // (dispatch stage)
+    bool unchanged = false;
+
+    // One frame per camera, the batch index of a frame is its camera index
+    std::vector<FramePtr> frames;
+
+    // Batched input of the graph (preprocess stage)
+    tensorflow::Tensor inputTensor;
+
+    // Raw batched output of the graph (inference stage)
+    std::vector<tensorflow::Tensor> outputs;
+
+    // Raw batched outputs of the additional models, run on the same input tensor (inference stage)
+    std::vector<std::vector<tensorflow::Tensor> > additionalOutputs;
+};
+
+typedef std::shared_ptr<DetectionBatch> BatchPtr;
+
+#endif  //_DetectionFrame_H_
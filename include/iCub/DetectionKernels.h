@@ -0,0 +1,187 @@
+#ifndef OBJECTRECOGNITIONINFER_DetectionKernels_H
+#define OBJECTRECOGNITIONINFER_DetectionKernels_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "DetectionBuffer.h"
+#include "ImageKernels.h"
+
+/**
+ * Boxes of the detections stored by coordinate, so that one box is compared to eight others per instruction
+ */
+struct DetectionBoxes {
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> x2;
+    std::vector<float> y2;
+    std::vector<float> area;
+    std::vector<int32_t> classId;
+
+    /**
+     * @param t_detections
+     * @param t_count
+     */
+    void assign(const Detection *t_detections, size_t t_count);
+
+    void clear();
+
+    /**
+     * Append a box
+     * @param t_x1
+     * @param t_y1
+     * @param t_x2
+     * @param t_y2
+     * @param t_classId
+     */
+    void push(float t_x1, float t_y1, float t_x2, float t_y2, int32_t t_classId);
+
+    size_t size() const {
+        return x1.size();
+    }
+};
+
+/**
+ * Greedy non maximum suppression : each kept box suppresses the following boxes of its class overlapping it by
+ * more than the threshold. The boxes must be sorted by decreasing score
+ * @param t_isa instruction set of the overlap kernel, the CPU must support it
+ * @param t_boxes
+ * @param t_iouThreshold
+ * @param t_maxKept the suppression stops once this many boxes are kept
+ * @param t_keep resized to the number of boxes, -1 for a kept box and 0 for a suppressed one
+ * @return number of kept boxes
+ */
+size_t suppressOverlaps(KernelIsa t_isa, const DetectionBoxes &t_boxes, float t_iouThreshold, size_t t_maxKept,
+                        std::vector<int32_t> *t_keep);
+
+/**
+ * Same as above with the best instruction set of the CPU
+ */
+size_t suppressOverlaps(const DetectionBoxes &t_boxes, float t_iouThreshold, size_t t_maxKept,
+                        std::vector<int32_t> *t_keep);
+
+/**
+ * Merge the detections of overlapping views of an image, e.g. its tiles : the duplicates of an object are
+ * suppressed and the instances of each class are numbered again
+ * @param t_candidates detections in the image coordinates, sorted by decreasing score in place
+ * @param t_iouThreshold two detections of a class overlapping by more are the same object
+ * @param t_maxDetections best scored detections kept
+ * @param t_objectsDetected emptied then filled with the kept detections
+ */
+void nonMaxSuppression(std::vector<Detection> *t_candidates, float t_iouThreshold, size_t t_maxDetections,
+                       DetectionBuffer *t_objectsDetected);
+
+/**
+ * Score threshold of each class of a model and mask of the classes it outputs. Both are folded into one table of
+ * thresholds indexed by class id, a class out of the mask having an infinite threshold, so that a candidate is
+ * filtered by a single lookup
+ */
+class ClassFilter {
+public:
+    explicit ClassFilter(float t_threshold = 0.5f);
+
+    /**
+     * Threshold of the classes without their own
+     * @param t_threshold
+     */
+    void setThreshold(float t_threshold);
+
+    float getThreshold() const;
+
+    /**
+     * @param t_classId
+     * @param t_threshold negative to use the default threshold again
+     */
+    void setClassThreshold(int32_t t_classId, float t_threshold);
+
+    /**
+     * Keep only the given classes
+     * @param t_classIds empty to keep all of them again
+     */
+    void allowClasses(const std::vector<int32_t> &t_classIds);
+
+    /**
+     * Drop the given classes, the other ones are kept
+     * @param t_classIds
+     */
+    void denyClasses(const std::vector<int32_t> &t_classIds);
+
+    bool allowed(int32_t t_classId) const;
+
+    /**
+     * @param t_classId
+     * @return threshold of the class, infinite if it is not allowed
+     */
+    float threshold(int32_t t_classId) const;
+
+    /**
+     * @return thresholds of the class ids 0 to lastClassId(), the last one applies to all the larger ids
+     */
+    const float *thresholds() const {
+        return m_thresholds.data();
+    }
+
+    int32_t lastClassId() const {
+        return static_cast<int32_t>(m_thresholds.size()) - 1;
+    }
+
+private:
+    float m_threshold;
+    std::vector<float> m_classThresholds;   // per class id, negative for the default threshold
+    std::vector<uint64_t> m_classMask;      // one bit per class id, set if the class is kept
+    bool m_keepOtherClasses;                // classes beyond the mask
+
+    std::vector<float> m_thresholds;
+
+    void setMaskBit(int32_t t_classId, bool t_keep);
+
+    void updateThresholds();
+};
+
+/**
+ * Compact the candidates of a detection graph whose score is above the threshold of their class, in one pass
+ * over the output buffers
+ * @param t_isa instruction set of the kernel, the CPU must support it
+ * @param t_scores
+ * @param t_classes class ids as output by the graph, in float
+ * @param t_count
+ * @param t_filter
+ * @param t_indices filled with the indices of the kept candidates in increasing order, room for t_count
+ * @return number of kept candidates
+ */
+size_t compactCandidates(KernelIsa t_isa, const float *t_scores, const float *t_classes, size_t t_count,
+                         const ClassFilter &t_filter, int32_t *t_indices);
+
+/**
+ * Same as above with the best instruction set of the CPU
+ */
+size_t compactCandidates(const float *t_scores, const float *t_classes, size_t t_count, const ClassFilter &t_filter,
+                         int32_t *t_indices);
+
+/**
+ * Best scored candidates after a class-wise non maximum suppression. The candidates are taken by decreasing score
+ * from a heap, or in order if they are already sorted as the graphs output them, so that no full sort is needed
+ * when only the first ones are kept
+ * @param t_isa instruction set of the overlap kernel, the CPU must support it
+ * @param t_boxes boxes of all the candidates, ymin xmin ymax xmax
+ * @param t_scores
+ * @param t_classes
+ * @param t_candidates indices of the candidates to consider, reordered
+ * @param t_count
+ * @param t_iouThreshold a candidate overlapping a kept one of its class by more is suppressed, 0 to disable
+ * the suppression when the graph already applies it
+ * @param t_topK maximum number of kept candidates
+ * @param t_selected emptied then filled with the indices of the kept candidates by decreasing score
+ */
+void selectDetections(KernelIsa t_isa, const float *t_boxes, const float *t_scores, const float *t_classes,
+                      int32_t *t_candidates, size_t t_count, float t_iouThreshold, size_t t_topK,
+                      std::vector<int32_t> *t_selected);
+
+/**
+ * Same as above with the best instruction set of the CPU
+ */
+void selectDetections(const float *t_boxes, const float *t_scores, const float *t_classes, int32_t *t_candidates,
+                      size_t t_count, float t_iouThreshold, size_t t_topK, std::vector<int32_t> *t_selected);
+
+#endif //OBJECTRECOGNITIONINFER_DetectionKernels_H
@@ -0,0 +1,78 @@
+#ifndef _DetectionOutput_H_
+#define _DetectionOutput_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <yarp/os/Bottle.h>
+
+#include "tensorflowObjectDetection.h"
+
+
+/**
+ * Content of the Bottle written on the label port for each frame
+ */
+enum class LabelFormat {
+    String,                 // one string "label : x1 y1 x2 y2 score ; ...", for the legacy consumers
+    List,                   // one list (classId "label" score x1 y1 x2 y2) per detection
+    Blob                    // one blob : DetectionBlobHeader followed by one DetectionRecord per detection
+};
+
+/**
+ * @param t_format name as given in the configuration file : string, list or blob
+ * @return LabelFormat, String for an unknown name
+ */
+LabelFormat parseLabelFormat(const std::string &t_format);
+
+const char *labelFormatName(LabelFormat t_format);
+
+/**
+ * Ports on which the detections of the additional models are written
+ */
+enum class ModelOutput {
+    Separate,               // one label port per camera and per additional model
+    Merged                  // the label port of the camera, after the detections of the main model
+};
+
+/**
+ * @param t_output name as given in the configuration file : separate or merged
+ * @return ModelOutput, Separate for an unknown name
+ */
+ModelOutput parseModelOutput(const std::string &t_output);
+
+const uint32_t DetectionBlobVersion = 1;
+
+/**
+ * Start of the blob, in the byte order of the host
+ */
+struct DetectionBlobHeader {
+    uint32_t version;
+    uint32_t count;         // records following the header
+};
+
+/**
+ * One detection of the blob, the label is resolved from the class id with the label file of the model
+ */
+struct DetectionRecord {
+    int32_t classId;
+    float score;
+    int32_t box[4];         // x1 y1 x2 y2 in the image coordinates
+};
+
+static_assert(sizeof(DetectionBlobHeader) == 8 && sizeof(DetectionRecord) == 24,
+              "The detection blob layout must not depend on the compiler");
+
+/**
+ * Append the detections of a frame to the Bottle prepared on the label port, in place
+ * @param t_format
+ * @param t_objectsDetected
+ * @param t_labels labels of the model by class id
+ * @param t_blobBuffer storage of the blob, kept by the caller to be reused between the frames
+ * @param t_output
+ */
+void writeDetections(LabelFormat t_format, const DetectionBuffer &t_objectsDetected,
+                     const LabelTable &t_labels, std::vector<char> &t_blobBuffer,
+                     yarp::os::Bottle &t_output);
+
+#endif  //_DetectionOutput_H_
@@ -0,0 +1,103 @@
+#ifndef OBJECTRECOGNITIONINFER_GraphOptimization_H
+#define OBJECTRECOGNITIONINFER_GraphOptimization_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tensorflow/core/framework/graph.pb.h>
+#include <tensorflow/core/lib/core/status.h>
+
+
+/**
+ * Graph transforms applied by default : prune to the fetched outputs, fold the constant subgraphs and the batch
+ * normalizations into the convolution weights, fuse the paddings into the convolutions and merge the duplicates
+ */
+extern const char DefaultGraphTransforms[];
+
+/**
+ * Graph transforms of objectDetectionQuantizeGraph : the optimisations above, then the weights stored in eight bits
+ * and the float ops replaced by their eight bits versions where TensorFlow has one
+ */
+extern const char QuantizeGraphTransforms[];
+
+/**
+ * Arithmetic of the graph run by the sessions
+ */
+enum class Precision {
+    Float,                      // graph as exported
+    Int8                        // graph written by objectDetectionQuantizeGraph next to the exported one
+};
+
+/**
+ * @param t_precision name as given in the configuration file : float or int8
+ * @return Precision, Float for an unknown name
+ */
+Precision parsePrecision(const std::string &t_precision);
+
+/**
+ * Graph file of a precision : model.pb for Float, model.int8.pb for Int8
+ * @param t_graphPath exported graph, or memmapped package
+ * @param t_precision
+ * @return path of the graph
+ */
+std::string precisionGraphPath(const std::string &t_graphPath, Precision t_precision);
+
+/**
+ * Result of the optimisation of the graph at startup
+ */
+struct GraphOptimizationStats {
+    bool applied;
+    bool fromCache;             // the optimised graph was read from the cache instead of being built
+    int nodesBefore;            // nodes of the exported graph, 0 when read from the cache
+    int nodesAfter;
+    double optimizeTimeMs;
+    double p50BeforeMs;         // median run of the exported and the optimised graph, measured when it is built
+    double p50AfterMs;
+};
+
+/**
+ * @param t_tensorName name of a tensor, "image_tensor:0"
+ * @return name of the node producing it, "image_tensor"
+ */
+std::string graphNodeName(const std::string &t_tensorName);
+
+/**
+ * Key of an optimised graph : the same exported graph optimised with the same transforms
+ * @param t_graphHash hash of the exported graph
+ * @param t_transforms
+ * @return key of the cache
+ */
+uint64_t optimizedGraphKey(uint64_t t_graphHash, const std::string &t_transforms);
+
+/**
+ * Cache of the optimised graph, next to the exported one : model.pb gives model.optimized-<key>.pb
+ * @param t_graphPath
+ * @param t_key
+ * @return path of the cache
+ */
+std::string optimizedGraphPath(const std::string &t_graphPath, uint64_t t_key);
+
+/**
+ * Apply the graph transforms between the input and the fetched outputs
+ * @param t_graphDef exported graph
+ * @param t_input tensor fed to the graph
+ * @param t_outputs tensors fetched from the graph, everything else is pruned
+ * @param t_transforms transforms in the syntax of transform_graph
+ * @param t_optimized
+ * @return Tensor status of the success of the process
+ */
+tensorflow::Status optimizeGraph(const tensorflow::GraphDef &t_graphDef, const std::string &t_input,
+                                 const std::vector<std::string> &t_outputs, const std::string &t_transforms,
+                                 tensorflow::GraphDef *t_optimized);
+
+/**
+ * Save a graph in a temporary file renamed once complete, so that a start reading it never sees a partial file.
+ * The temporary name is unique to the writer, concurrent writers of the same path do not clobber each other.
+ * @param t_path
+ * @param t_graphDef
+ * @return Tensor status of the success of the process
+ */
+tensorflow::Status writeGraphAtomically(const std::string &t_path, const tensorflow::GraphDef &t_graphDef);
+
+#endif //OBJECTRECOGNITIONINFER_GraphOptimization_H
@@ -0,0 +1,146 @@
+#ifndef OBJECTRECOGNITIONINFER_ImageKernels_H
+#define OBJECTRECOGNITIONINFER_ImageKernels_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Instruction sets available for the image kernels, the best one supported by the CPU is chosen at runtime
+ */
+enum class KernelIsa {
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+/**
+ * @return best instruction set supported by the running CPU
+ */
+KernelIsa detectKernelIsa();
+
+/**
+ * @param t_isa
+ * @return printable name of the instruction set
+ */
+const char *kernelIsaName(KernelIsa t_isa);
+
+/**
+ * Copy a packed 3 channels image while swapping its first and third channels (RGB <-> BGR), in one pass.
+ * The rows may be padded, the source and destination buffers must not overlap.
+ * @param t_src first pixel of the source image
+ * @param t_srcStride bytes between two rows of the source
+ * @param t_dst first pixel of the destination image
+ * @param t_dstStride bytes between two rows of the destination
+ * @param t_width in pixels
+ * @param t_height in pixels
+ */
+void swapRedBlueCopy(const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst, size_t t_dstStride,
+                     int t_width, int t_height);
+
+/**
+ * Same as swapRedBlueCopy with a forced instruction set, the CPU must support it
+ */
+void swapRedBlueCopy(KernelIsa t_isa, const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst,
+                     size_t t_dstStride, int t_width, int t_height);
+
+
+/**
+ * Grey thumbnail of a packed 3 channels image : one pixel sampled at the centre of each cell of a regular grid,
+ * its grey level (r + 2g + b) / 4 does not depend on the channel order
+ * @param t_src first pixel of the image
+ * @param t_srcStride bytes between two rows of the image
+ * @param t_width in pixels
+ * @param t_height in pixels
+ * @param t_thumbnail t_thumbnailWidth * t_thumbnailHeight grey levels, row major
+ * @param t_thumbnailWidth
+ * @param t_thumbnailHeight
+ */
+void sampleGreyThumbnail(const uint8_t *t_src, size_t t_srcStride, int t_width, int t_height, uint8_t *t_thumbnail,
+                         int t_thumbnailWidth, int t_thumbnailHeight);
+
+// Side of the blocks compared by blockAbsoluteDifferences
+static const int kDifferenceBlockSize = 8;
+
+/**
+ * Sum of the absolute differences between two grey images of the same size, per block of 8x8 pixels
+ * @param t_first
+ * @param t_second
+ * @param t_width in pixels, multiple of the block size, the rows are not padded
+ * @param t_height in pixels, multiple of the block size
+ * @param t_blockSums (t_width / 8) * (t_height / 8) sums, row major
+ */
+void blockAbsoluteDifferences(const uint8_t *t_first, const uint8_t *t_second, int t_width, int t_height,
+                              uint32_t *t_blockSums);
+
+/**
+ * Same as blockAbsoluteDifferences with a forced instruction set, the CPU must support it
+ */
+void blockAbsoluteDifferences(KernelIsa t_isa, const uint8_t *t_first, const uint8_t *t_second, int t_width,
+                              int t_height, uint32_t *t_blockSums);
+
+
+/**
+ * Placement of a source image resized inside the input tensor of the graph
+ */
+struct ResizeGeometry {
+    int sourceWidth;        // image read on the port
+    int sourceHeight;
+    int targetWidth;        // input tensor
+    int targetHeight;
+    int contentWidth;       // resized image inside the input tensor
+    int contentHeight;
+    int offsetX;            // letterbox border on the left
+    int offsetY;            // letterbox border on the top
+};
+
+/**
+ * Compute where a source image lands in the target image
+ * @param t_sourceWidth
+ * @param t_sourceHeight
+ * @param t_targetWidth
+ * @param t_targetHeight
+ * @param t_letterbox keep the aspect ratio and centre the image between borders, stretch it otherwise
+ * @return ResizeGeometry
+ */
+ResizeGeometry computeResizeGeometry(int t_sourceWidth, int t_sourceHeight, int t_targetWidth, int t_targetHeight,
+                                     bool t_letterbox);
+
+/**
+ * Precomputed bilinear taps of a resize, built once per geometry and reused for every frame
+ */
+struct ResizePlan {
+    ResizeGeometry geometry;
+    std::vector<int> firstColumn;       // left source pixel of each target column
+    std::vector<int> columnWeight;      // 8 bits weight of the right source pixel
+    std::vector<int> firstRow;          // top source row of each target row
+    std::vector<int> rowWeight;         // 8 bits weight of the bottom source row
+};
+
+/**
+ * @param t_geometry computed by computeResizeGeometry
+ * @return the plan used by resizeSwapRedBlue
+ */
+ResizePlan buildResizePlan(const ResizeGeometry &t_geometry);
+
+/**
+ * Bilinear resize of a packed 3 channels image fused with the swap of its first and third channels : each
+ * target row is produced by one vertical blend of its two source rows and one horizontal pass writing the
+ * swapped pixels. The letterbox borders are filled with t_fill.
+ * @param t_src first pixel of the source image
+ * @param t_srcStride bytes between two rows of the source
+ * @param t_dst first pixel of the target image
+ * @param t_dstStride bytes between two rows of the target
+ * @param t_plan built by buildResizePlan
+ * @param t_fill value of the border bytes
+ */
+void resizeSwapRedBlue(const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst, size_t t_dstStride,
+                       const ResizePlan &t_plan, uint8_t t_fill);
+
+/**
+ * Same as resizeSwapRedBlue with a forced instruction set, the CPU must support it
+ */
+void resizeSwapRedBlue(KernelIsa t_isa, const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst,
+                       size_t t_dstStride, const ResizePlan &t_plan, uint8_t t_fill);
+
+#endif //OBJECTRECOGNITIONINFER_ImageKernels_H
@@ -0,0 +1,92 @@
+#ifndef OBJECTRECOGNITIONINFER_LabelTable_H
+#define OBJECTRECOGNITIONINFER_LabelTable_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+ * Labels of a model indexed by class id. The names are interned in one block of null terminated strings and
+ * each id holds the offset of its name, so that a lookup is an array access. The table can be saved in a binary
+ * cache that is memory mapped on the next start instead of parsing the label file again.
+ */
+class LabelTable {
+public:
+    LabelTable();
+
+    ~LabelTable();
+
+    LabelTable(const LabelTable &) = delete;
+    LabelTable &operator=(const LabelTable &) = delete;
+
+    /**
+     * Build the table from the labels parsed from a label file
+     * @param t_labels name per class id, the ids must be positive
+     */
+    void assign(const std::map<int, std::string> &t_labels);
+
+    /**
+     * @param t_classId
+     * @return name of the class, empty if the id is unknown
+     */
+    const char *name(int t_classId) const {
+        if (t_classId < 0 || static_cast<uint32_t>(t_classId) >= m_idCount ||
+            m_offsets[t_classId] == UnknownOffset) {
+            return "";
+        }
+        return m_names + m_offsets[t_classId];
+    }
+
+    /**
+     * @return number of class ids, the largest id plus one
+     */
+    size_t size() const {
+        return m_idCount;
+    }
+
+    /**
+     * @return number of different names
+     */
+    size_t uniqueNames() const {
+        return m_uniqueNames;
+    }
+
+    /**
+     * Map a binary cache written by writeCache, only if it was built from the current content of the label file
+     * @param t_cachePath
+     * @param t_sourceHash hash of the content of the label file
+     * @return false if the cache is missing, corrupted or built from another label file
+     */
+    bool mapCache(const std::string &t_cachePath, uint64_t t_sourceHash);
+
+    /**
+     * Save the table in a binary cache, written in a temporary file unique to the writer and renamed once complete
+     * @param t_cachePath
+     * @param t_sourceHash hash of the content of the label file the table was parsed from
+     * @return false if the file can not be written
+     */
+    bool writeCache(const std::string &t_cachePath, uint64_t t_sourceHash) const;
+
+private:
+    static const uint32_t UnknownOffset = 0xffffffffu;
+
+    void unmap();
+
+    // Either owned by the table or pointing into the mapped cache
+    const uint32_t *m_offsets;
+    const char *m_names;
+    uint32_t m_idCount;
+    uint32_t m_namesSize;
+    uint32_t m_uniqueNames;
+
+    std::vector<uint32_t> m_ownedOffsets;
+    std::vector<char> m_ownedNames;
+
+    void *m_mapping;
+    size_t m_mappingSize;
+};
+
+#endif //OBJECTRECOGNITIONINFER_LabelTable_H
@@ -0,0 +1,71 @@
+#ifndef _LatencyWindow_H_
+#define _LatencyWindow_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+
+struct LatencyPercentiles {
+    size_t samples;             // latencies in the window
+    double p50;                 // s
+    double p95;
+    double p99;
+    double max;
+};
+
+/**
+ * Percentiles of the latencies of the last frames published
+ */
+class LatencyWindow {
+public:
+    /**
+     * Constructor
+     * @param t_capacity number of latest latencies kept, the oldest are overwritten
+     */
+    explicit LatencyWindow(size_t t_capacity) : m_samples(t_capacity > 0 ? t_capacity : 1, 0.0), m_next(0),
+                                                m_count(0) {}
+
+    /**
+     * Record the latency of one frame
+     * @param t_latency s
+     */
+    void add(double t_latency) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_samples[m_next] = t_latency;
+        m_next = (m_next + 1) % m_samples.size();
+        m_count = std::min(m_count + 1, m_samples.size());
+    }
+
+    /**
+     * Sort a copy of the window, the frames keep being recorded meanwhile
+     * @return percentiles of the window, zero if it is empty
+     */
+    LatencyPercentiles getPercentiles() const {
+        std::vector<double> sorted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            sorted.assign(m_samples.begin(), m_samples.begin() + m_count);
+        }
+
+        if (sorted.empty()) {
+            return {0, 0.0, 0.0, 0.0, 0.0};
+        }
+
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double t_rank) {
+            return sorted[std::min(sorted.size() - 1, static_cast<size_t>(t_rank * sorted.size()))];
+        };
+
+        return {sorted.size(), percentile(0.50), percentile(0.95), percentile(0.99), sorted.back()};
+    }
+
+private:
+    std::vector<double> m_samples;
+    size_t m_next;
+    size_t m_count;
+    mutable std::mutex m_mutex;
+};
+
+#endif  //_LatencyWindow_H_
@@ -0,0 +1,112 @@
+#ifndef OBJECTRECOGNITIONINFER_MotionGate_H
+#define OBJECTRECOGNITIONINFER_MotionGate_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ImageKernels.h"
+
+/**
+ * Skipping of the inference of the frames whose scene did not change since the last inferred one
+ */
+struct MotionGateConfig {
+    double blockThreshold;      // mean grey difference (0-255) of a block above which it changed, 0 to disable
+    int minChangedBlocks;       // changed blocks from which the frame is inferred
+    int refreshFrames;          // frames after which an unchanged scene is inferred anyway, at least 1
+
+    bool enabled() const {
+        return blockThreshold > 0.0;
+    }
+};
+
+struct MotionGateStats {
+    uint64_t framesChecked;
+    uint64_t framesSkipped;         // not inferred, the scene did not change
+    uint64_t lastChangedBlocks;     // in the last frame checked
+};
+
+/**
+ * Change detector run before the inference : each frame is downsampled to a grey thumbnail compared per block
+ * of 8x8 pixels with the thumbnail of the last frame successfully inferred from the same source. Thread safe
+ */
+class MotionGate {
+public:
+    // Resolution of the thumbnails, 8x6 blocks
+    static const int ThumbnailWidth = 64;
+    static const int ThumbnailHeight = 48;
+
+    MotionGate();
+
+    /**
+     * Change the gating, the state of the sources is dropped. minChangedBlocks and refreshFrames are raised to 1
+     * @param t_config
+     */
+    void configure(const MotionGateConfig &t_config);
+
+    MotionGateConfig getConfig() const;
+
+    /**
+     * Compare a frame with the last frame inferred from its source, its change mask replaces the previous one
+     * @param t_source camera of the frame
+     * @param t_pixels first pixel of the packed 3 channels image
+     * @param t_stride bytes between two rows of the image
+     * @param t_width
+     * @param t_height
+     * @return true if the frame has to be inferred : minChangedBlocks blocks changed, the source has no inferred
+     * frame of this size yet, or refreshFrames frames were skipped. Always true if the gating is disabled
+     */
+    bool frameChanged(size_t t_source, const uint8_t *t_pixels, size_t t_stride, int t_width, int t_height);
+
+    /**
+     * Count the frame last compared for a source as not inferred because it did not change
+     * @param t_source
+     */
+    void countSkipped(size_t t_source);
+
+    /**
+     * Hand over the thumbnail of the frame last compared for a source, which is going to be inferred
+     * @param t_source
+     * @param t_thumbnail receives the thumbnail, kept with the frame until its inference succeeded
+     */
+    void takeThumbnail(size_t t_source, std::vector<uint8_t> *t_thumbnail);
+
+    /**
+     * Make the thumbnail of a successfully inferred frame the reference of the next frames of its source, in the
+     * order of capture. A frame whose inference failed or was dropped never becomes the reference
+     * @param t_source
+     * @param t_thumbnail given by takeThumbnail, receives a storage to reuse
+     */
+    void commitReference(size_t t_source, std::vector<uint8_t> *t_thumbnail);
+
+    /**
+     * @param t_source
+     * @return one byte per block of the last frame compared, 1 if the block changed, row major
+     */
+    std::vector<uint8_t> getChangeMask(size_t t_source) const;
+
+    MotionGateStats getStats() const;
+
+private:
+    struct SourceFrames {
+        int width = 0;                          // of the frames, the reference is dropped when it changes
+        int height = 0;
+        std::vector<uint8_t> reference;         // thumbnail of the last frame inferred, empty before the first
+        std::vector<uint8_t> current;           // thumbnail of the last frame compared
+        std::vector<uint8_t> spare;             // storage of a previous reference, reused by the next comparison
+        std::vector<uint8_t> changeMask;
+        int skippedFrames = 0;
+    };
+
+    MotionGateConfig m_config;
+    mutable std::mutex m_mutex;
+    std::map<size_t, SourceFrames> m_sources;
+
+    uint64_t m_framesChecked;
+    uint64_t m_framesSkipped;
+    uint64_t m_lastChangedBlocks;
+};
+
+#endif //OBJECTRECOGNITIONINFER_MotionGate_H
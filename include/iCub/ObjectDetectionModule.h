@@ -61,6 +61,10 @@
  * - \c config  \n
  *   specifies the name of the script that will be used
  *
+ * - \c benchmark \c N \n
+ *   does not start the module : infers \c benchmark_frames (100) times \c benchmark_image (random pixels at
+ *   the camera resolution if not given) with 1 to N workers and prints the frame rate reached by each
+ *
  *
  * <b>Configuration File Parameters</b>
  *
@@ -68,7 +72,194 @@
  * (they can also be specified as command-line parameters if you so wish).
  * The value part can be changed to suit your needs; the default values are shown below.
  *
- *
+ * - \c realTime \c false \n
+ *   process continuously the images received on the input port, each frame as soon as it arrives and the
+ *   previous one is done
+ *
+ * - \c latency_budget \c 0 \n
+ *   in realTime, maximum age (s) of a frame when its inference starts, older frames are dropped instead of
+ *   being processed late. With a budget the captured frames wait in a mailbox where the latest capture
+ *   replaces the one not dispatched yet. 0 disables it
+ *
+ * - \c pipeline \c true \n
+ *   in realTime, run capture, dispatch and publishing in separate threads and the inference on a pool of
+ *   workers, connected by bounded queues, so that the rate is only limited by the inference
+ *
+ * - \c queue_size \c 2 \n
+ *   capacity of the queues between two pipeline stages. When the inference falls behind the camera,
+ *   the oldest captured frame is dropped
+ *
+ * - \c workers \c 2 \n
+ *   in the pipeline, number of batches converted and inferred concurrently. Each worker has its own queue of
+ *   batches and steals from the others when idle, the detections are published in the order of capture
+ *
+ * - \c sessions \c 1 \n
+ *   number of sessions created from the graph, the cores are shared between them and the concurrent runs go
+ *   to the least busy one. A single session is shared by all the runs
+ *
+ * - \c intra_op_threads \c 0 \n
+ * - \c inter_op_threads \c 0 \n
+ * - \c per_session_threads \c false \n
+ *   thread pools of the sessions, 0 lets TensorFlow pick them (the cores are split between several sessions)
+ *
+ * - \c tune_threads \c off \n
+ *   \c latency or \c throughput : at startup, measure a grid of thread pool configurations on synthetic frames
+ *   of the input resolution and keep the one with the lowest median run time or the highest frame rate.
+ *   The result replaces the three parameters above and is stored in \c tune_cache
+ *   (\c $HOME/.objectDetectionThreading.cache), keyed by host, graph and input, so that the next start reuses it
+ *
+ * - \c tune_runs \c 10 \n
+ *   runs measured per configuration and per worker
+ *
+ * - \c camera_width \c 640 \n
+ * - \c camera_height \c 480 \n
+ *   expected resolution of the input images, the input tensors are preallocated for it
+ *
+ * - \c input_width \c 0 \n
+ * - \c input_height \c 0 \n
+ *   native input resolution of the model (300 300 for the SSD graphs). The images are resized to it
+ *   while converted, 0 keeps the camera resolution
+ *
+ * - \c letterbox \c false \n
+ *   keep the aspect ratio of the images when resizing them, the borders are filled with black
+ *
+ * - \c graph_format \c frozen \n
+ *   \c memmapped : \c graph_path is a package written by \c objectDetectionConvertGraph. Its weights are mapped
+ *   read only instead of being copied in the heap, the startup is shorter and the modules running the same
+ *   model on one host share a single copy of the weights in the page cache. The startup time and the resident
+ *   memory are logged for both formats
+ *
+ * - \c precision \c float \n
+ *   \c int8 : run the graph quantised by \c objectDetectionQuantizeGraph, \c model.int8.pb next to
+ *   \c graph_path (\c model.pb). Its weights are stored in eight bits and its convolutions run in eight bits
+ *   where TensorFlow has a quantised kernel, faster on the CPU nodes at the cost of some accuracy : compare both
+ *   graphs on a representative image set with \c objectDetectionEvalPrecision before switching a deployment
+ *
+ * - \c optimize_graph \c false \n
+ *   optimise the frozen graph at startup : prune the nodes the four fetched outputs do not use, fold the
+ *   constant subgraphs and the batch normalizations, fuse the paddings into the convolutions. The optimised graph
+ *   is saved next to \c graph_path (\c model.optimized-<key>.pb, keyed by the hash of the exported graph and the
+ *   transforms) and read directly by the next starts. When it is built, the node counts and the median run time
+ *   of both graphs are logged. A memmapped package is not optimised, convert the optimised graph instead
+ *
+ * - \c graph_transforms \n
+ *   transforms applied by \c optimize_graph, in the syntax of transform_graph. Empty for the default ones
+ *
+ * - \c tile_columns \c 1 \n
+ * - \c tile_rows \c 1 \n
+ * - \c tile_overlap \c 0.2 \n
+ *   tiled mode, for the objects too small for a single pass over the downscaled frame : each frame is split into
+ *   columns x rows tiles of the same size overlapping by at least this fraction, each one converted to the input
+ *   resolution of the model. All the tiles of a batch run in one batched Session::Run, their boxes are mapped back
+ *   to the frame and the detections of an object seen by two tiles are merged
+ *
+ * - \c tile_merge_iou \c 0.5 \n
+ *   overlap above which two detections of the same class from different tiles are the same object
+ *
+ * - \c tile_change_threshold \c 0 \n
+ * - \c tile_refresh \c 30 \n
+ *   a tile whose mean grey difference (0-255, on a 16x16 sampling) with the content it was last inferred on is
+ *   below the threshold is not inferred again, its last detections are reused. It is inferred anyway after
+ *   \c tile_refresh frames. 0 infers all the tiles of every frame
+ *
+ * - \c tracking \c false \n
+ * - \c inference_period \c 5 \n
+ *   publish every frame at the camera rate while inferring one frame out of \c inference_period : the other frames
+ *   are published at once with the boxes of the tracked objects predicted at their capture time. An inferred frame
+ *   older than a frame already published only corrects the tracks. A frame is also inferred as soon as an object
+ *   appears or the motion of a track was mispredicted, if a worker is free to infer it. With tracking, the
+ *   instance of a detection (the suffix of its label in the \c string format) is the id of its track, kept as
+ *   long as the object is detected. The additional models are only published on the inferred frames
+ *
+ * - \c track_match_iou \c 0.3 \n
+ *   overlap of a detection with the predicted box of a track of its class above which it updates the track
+ *
+ * - \c track_min_confidence \c 0.5 \n
+ *   overlap of the predicted box of a track with its detection under which the next frame is inferred
+ *
+ * - \c track_max_missed \c 2 \n
+ *   inferences a track survives without being detected, not published meanwhile, an occluded object gets its id back
+ *
+ * - \c track_process_noise \c 500 \n
+ * - \c track_measurement_noise \c 4 \n
+ *   standard deviations of the acceleration of the objects (px/s^2) and of the error of the detected boxes (px),
+ *   for the constant velocity Kalman filters of the tracks
+ *
+ * - \c motion_threshold \c 0 \n
+ * - \c motion_min_blocks \c 1 \n
+ * - \c motion_refresh \c 30 \n
+ *   motion gating, for a robot looking at a still scene : each frame is downsampled to a 64x48 grey thumbnail
+ *   compared per block of 8x8 with the thumbnail of the last successfully inferred frame of its camera. A block changed when
+ *   its mean grey difference (0-255) is above \c motion_threshold. A batch in which no frame has
+ *   \c motion_min_blocks changed blocks is not inferred, the detections of the last inferred frames are
+ *   published again, or predicted from the tracks with tracking. It is inferred anyway after \c motion_refresh
+ *   skipped frames, at least 1. 0 as \c motion_threshold disables the gating
+ *
+ * - \c additional_models \c (open) \n
+ *   models inferring the same frames as the main one, each configured by a group of the same name
+ *   (\c [open]) with \c graph_path, \c labels_path, and optionally \c model_name (the one of the main model by
+ *   default), \c threshold, \c labels_cache and the class filter. The other parameters are those of the main model. The frames
+ *   are read and converted once, the models run concurrently on the same input tensor, so they must share the
+ *   input resolution of the main model
+ *
+ * - \c model_output \c separate \n
+ *   \c separate : the detections of an additional model are written on \c /<camera>/<model>/label:o.
+ *   \c merged : they are appended to the Bottle of the label port of the camera, one element per additional
+ *   model after those of the main model. The boxes of all the models are drawn on the same image
+ *
+ * - \c swap_warmup_runs \c 2 \n
+ *   runs of each session on a synthetic frame before a model loaded by \c set \c model replaces the current one,
+ *   so that its first frames do not pay the lazy initialisation of TensorFlow
+ *
+ * - \c labels_cache \n
+ *   binary cache of the labels of \c labels_path, memory mapped at startup instead of parsing the label file
+ *   when it was built from the same file content (checked with a hash), rebuilt otherwise. Empty by default,
+ *   the label file is parsed on every start
+ *
+ * - \c max_detections \c 20 \n
+ *   maximum number of objects kept per image, the best scored ones. The detections of a frame are stored in
+ *   a buffer of this capacity taken from a pool of its camera and given back when the frame is released, the
+ *   following frames reuse it instead of allocating
+ *
+ * - \c class_thresholds \c ((1 \c 0.6) \c (44 \c 0.3)) \n
+ *   detection threshold of some class ids, the others use the detection threshold
+ *
+ * - \c allowed_classes \c (1 \c 3) \n
+ * - \c denied_classes \c (62 \c 63) \n
+ *   class ids output only, or never output. The thresholds and the mask are applied in the same pass over the
+ *   scores of the graph, before the best \c max_detections are taken. An additional model reads them from its
+ *   group only, the class ids depending on its label file. A model loaded by \c set \c model keeps every class
+ *   above the detection threshold
+ *
+ * - \c nms_iou \c 0 \n
+ *   class-wise non maximum suppression of the graph outputs, for the graphs outputting raw candidates : a
+ *   candidate overlapping a better one of its class by more is dropped. 0 when the graph applies it already
+ *
+ * - \c label_format \c string \n
+ *   content of the Bottle written on \c /label:o for each frame : \c string is the legacy
+ *   "label : x1 y1 x2 y2 score ; ..." string (the second object of a class is label1, then label2...), \c list gives one list (classId "label" score x1 y1 x2 y2) per
+ *   detection, \c blob a single blob of an 8 bytes header {version, count} followed by 24 bytes records
+ *   {int32 classId, float32 score, int32 x1 y1 x2 y2} in the byte order of the host (see DetectionOutput.h)
+ *
+ * - \c stats_period \c 1.0 \n
+ *   period (s) of the statistics written on the \c /stats:o port when it is connected
+ *
+ * - \c monitor_log_period \c 0.0 \n
+ *   period (s) of a summary of the pipeline (rates, latency, queues, pools) in the log, 0 to disable it
+ *
+ * - \c latency_window \c 500 \n
+ *   number of frames over which the capture to publish latency percentiles are computed. The capture time is
+ *   the envelope of the input frame, that is also attached to the outputs of the frame
+ *
+ * - \c cameras \c (left \c right) \n
+ *   names of the cameras whose frames are inferred together in one batched run. Each camera gets its own
+ *   \c /<name>/imageRGB:i, \c /<name>/label:o and \c /<name>/imageBoxes:o ports. Without this parameter
+ *   a single camera uses \c /imageRGB:i, \c /label:o and \c /imageBoxes:o. Cameras of different resolutions
+ *   require \c input_width and \c input_height
+ *
+ * - \c sync_window \c 0.03 \n
+ *   maximum time (s) between the envelopes of the frames of a batch, the frames of a camera lagging behind
+ *   are dropped until the batch is aligned
  *
  * \section portsa_sec Ports Accessed
  *
@@ -85,6 +276,31 @@
  *  -  \c help \n
  *  -  \c quit \n
  *  -  \c exe  \n
+ *  -  \c set \c threshold \c <value> \c [model] : detection threshold of the main model, or of an additional one \n
+ *  -  \c get \c label : infer one batch and publish it, or in realTime reply with the detections last published
+ *    on each camera, as on its label port, the ports being written by the pipeline only \n
+ *  -  \c get \c threshold \c [model] \n
+ *  -  \c get \c queue : number of frames waiting between the pipeline stages \n
+ *  -  \c get \c pool : hits, misses and bytes allocated by the input tensor pool \n
+ *  -  \c get \c prep : mean preprocessing time (ms) and bytes saved per frame \n
+ *  -  \c get \c late : capture to publish latency (ms) p50, p95, p99 and max over the last frames, and their number \n
+ *  -  \c get \c stats : frames in, out and dropped, and for each stage (port read, colour conversion, tensor
+ *        conversion, session run, postprocessing, drawing, port write) its count and mean, p50, p90, p99 and max
+ *        duration in ms \n
+ *  -  \c get \c rate : achieved rate (batches/s), batches published, dropped as stale and replaced in the mailbox \n
+ *  -  \c get \c tile : frames inferred in the tiled mode, tiles inferred and tiles skipped because unchanged \n
+ *  -  \c get \c track : frames inferred, frames published from the tracks, inferred frames superseded, tracks
+ *        created and tracks active \n
+ *  -  \c get \c motion : frames compared by the motion gating, frames skipped, skipped ratio, time (ms) spent
+ *        comparing and inference time (ms) saved \n
+ *  -  \c set \c model \c <name> \c <graph> \c <labels> : load another model in the background, configured like
+ *        the current one, and switch to it between two batches once it is warmed up. The current model keeps
+ *        serving meanwhile and is freed with the last batch it inferred. Fails if a model is already loading.
+ *        The new model only keeps the detection threshold of the current one, without the per class thresholds
+ *        and the class mask which refer to the class ids of the current label file \n
+ *  -  \c get \c model : name of the serving model, 1 while another one loads, load and warmup time (ms) of the
+ *        last swap, latency (ms) from the switch to the first frame published by the new model, frames served
+ *        during the load, and the error of the last failed swap \n
  *
  *    Note that the name of this port mirrors whatever is provided by the \c --name parameter value
  *    The port is attached to the terminal so that you can type in commands and receive replies.
@@ -94,7 +310,8 @@
  *
  * <b>Output ports</b>
  *
- *  - None
+ *  - \c /ObjectDetectionModule/stats:o \n
+ *    every \c stats_period, the statistics returned by \c get \c stats
  *
  * \section in_files_sec Input Data Files
  *
@@ -150,6 +367,16 @@
 #define COMMAND_VOCAB_FAILED             VOCAB4('f','a','i','l')
 #define COMMAND_VOCAB_LABEL              VOCAB4('l','a','b','e')
 #define COMMAND_VOCAB_THRESHOLD          VOCAB4('t','h','r','e')
+#define COMMAND_VOCAB_QUEUE              VOCAB4('q','u','e','u')
+#define COMMAND_VOCAB_POOL               VOCAB4('p','o','o','l')
+#define COMMAND_VOCAB_PREPROCESS         VOCAB4('p','r','e','p')
+#define COMMAND_VOCAB_RATE               VOCAB4('r','a','t','e')
+#define COMMAND_VOCAB_LATENCY            VOCAB4('l','a','t','e')
+#define COMMAND_VOCAB_STATS              VOCAB4('s','t','a','t')
+#define COMMAND_VOCAB_MODEL              VOCAB4('m','o','d','e')
+#define COMMAND_VOCAB_TILE               VOCAB4('t','i','l','e')
+#define COMMAND_VOCAB_TRACK              VOCAB4('t','r','a','c')
+#define COMMAND_VOCAB_MOTION             VOCAB4('m','o','t','i')
 
 class ObjectDetectionModule:public yarp::os::RFModule {
 
@@ -32,12 +32,25 @@
 #include <yarp/dev/all.h>
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Log.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <time.h>
 
 #include "tensorflowObjectDetection.h"
+#include "BoundedQueue.h"
+#include "DetectionFrame.h"
+#include "DetectionOutput.h"
+#include "LatencyWindow.h"
+#include "MotionGate.h"
+#include "ObjectTracker.h"
+#include "StageStatistics.h"
+#include "PipelineStage.h"
+#include "ReorderBuffer.h"
+#include "WorkStealingScheduler.h"
 
 
 struct Color{
@@ -46,9 +59,97 @@ struct Color{
     unsigned int blue;
 };
 
+/**
+ * Ports of one camera : its images are read on imageRGB:i, its detections are published on label:o and imageBoxes:o
+ */
+struct CameraPorts{
+    // Detection buffers of the frames of the camera, declared first so that it outlives them
+    DetectionBufferPool detectionPool;
+
+    std::string cameraName;
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > inputImagePort;
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > outputImageBoxesPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> outputLabelPort;
+
+    // Frame whose buffer is wrapped by the image being written on outputImageBoxesPort
+    FramePtr publishedFrame;
+
+    // Capture time of the last frame published, an older inferred frame only corrects the tracks
+    double publishedTime = 0.0;
+
+    // Detections of the last inferred frame published, published again while the scene does not change. They
+    // are exchanged with those of the frames, never copied
+    ModelDetections inferredDetections;
+    std::vector<ModelDetections> inferredAdditionalDetections;
+
+    // Detections of the main model last published, answered to get label while the pipeline runs
+    DetectionBuffer publishedDetections;
+    std::shared_ptr<const LabelTable> publishedLabels;
+
+    // Envelope given to the frames received without one
+    yarp::os::Stamp localStamp;
+
+    // Storage of the detection blob written on outputLabelPort, reused between the frames
+    std::vector<char> labelBlob;
+
+    // Label ports of the additional models published separately, /<camera>/<model>/label:o
+    std::vector<std::unique_ptr<yarp::os::BufferedPort<yarp::os::Bottle> > > modelLabelPorts;
+    std::vector<std::vector<char> > modelLabelBlobs;
+};
+
+struct AdditionalModel{
+    std::string name;                    // group of the configuration file, also names its ports
+    std::shared_ptr<tensorflowObjectDetection> detector;
+};
+
+struct SchedulingStats{
+    double achievedRate;                 // batches published per second over the last monitoring period
+    uint64_t batchesPublished;
+    uint64_t staleBatchesDropped;        // older than the latency budget when their inference could start
+    uint64_t replacedBatches;            // overwritten by a newer capture before being dispatched
+    double latencyBudget;                // s, 0 if disabled
+};
+
+struct FrameCounters{
+    uint64_t framesIn;                   // read on the input ports
+    uint64_t framesOut;                  // published on the output ports
+    uint64_t framesDropped;              // discarded before their inference
+};
+
+struct ModelSwapStats{
+    std::string modelName;               // model serving the frames
+    bool loading;                        // a new model is being loaded and warmed up
+    std::string lastError;               // reason of the last failed swap, empty if it succeeded
+    double loadTimeMs;                   // graph, labels and sessions of the last swapped model
+    double warmupTimeMs;
+    double switchLatencyMs;              // from the switch to the publication of the first frame of the new model
+    uint64_t framesServedDuringLoad;     // frames published by the previous model while the new one was loading
+};
+
+struct MotionStats{
+    uint64_t framesChecked;
+    uint64_t framesSkipped;              // published with the detections of the last inferred frame
+    double skippedRatio;
+    double checkTimeMs;                  // spent comparing the frames with the last inferred ones
+    double inferenceTimeSavedMs;         // estimate : skipped batches times the mean conversion, run and
+                                         // postprocessing of a batch, less the comparisons
+};
+
+struct PipelineQueueDepth{
+    std::string queueName;
+    size_t depth;
+    size_t capacity;
+    size_t dropped;
+};
+
 class ObjectDetectionThread : public yarp::os::RateThread {
 private:
     bool runRealTime;                    //result of the processing
+    bool runPipeline;                    // process the realTime stream with the staged pipeline
+    int pipelineQueueSize;               // capacity of the queues between two pipeline stages
+    int inferenceWorkers;                // batches converted and inferred concurrently
+    double latencyBudget;                // frames older than this (s) are dropped instead of inferred, 0 to disable
+    LabelFormat labelFormat;             // content of the Bottles written on the label port
 
     std::string robot;              // name of the robot
     std::string name;               // rootname of all the ports opened by this thread
@@ -58,16 +159,74 @@ private:
 
 
 
-    std::unique_ptr<tensorflowObjectDetection> tfObjectDetection;
+    // Model serving the frames, replaced atomically by a model swap. Read it with currentDetector()
+    std::shared_ptr<tensorflowObjectDetection> tfObjectDetection;
+
+    // Hot swap of the model : loaded and warmed up by modelLoader while the current model keeps serving
+    std::thread modelLoader;
+    std::mutex modelSwapMutex;
+    ModelSwapStats modelSwapStats;
+    int swapWarmupRuns;
+    std::atomic<bool> awaitingSwappedModel;          // the switch latency is taken on its first published frame
+    const tensorflowObjectDetection *swappedDetector;
+    double switchTime;
+
+    // Tracking between the inferred frames : the other frames are published at once from the tracks, by the
+    // dispatch stage while the publish stage publishes the inferred ones, one at a time
+    bool tracking;
+    ObjectTracker objectTracker;
+    std::shared_ptr<const LabelTable> trackedLabels;    // of the model whose detections the tracks follow
+    std::mutex publishMutex;
+
+    // Motion gating : the batches whose scene did not change are not inferred
+    MotionGate motionGate;
+    std::atomic<uint64_t> unchangedBatches;             // not inferred because their scene did not change
+
+    // Models inferring the same converted frames as the main one, on the persistent threads of additionalScheduler
+    std::vector<AdditionalModel> additionalModels;
+    std::unique_ptr<WorkStealingScheduler> additionalScheduler;
+    ModelOutput modelOutput;
 
     yarp::sig::ImageOf<yarp::sig::PixelRgb>* outputBoxesImage;
 
-    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > inputImagePort;
-    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > outputImageBoxesPort;
-    yarp::os::BufferedPort<yarp::os::Bottle> outputLabelPort;
+    // One entry per camera, a single camera uses the historical port names
+    std::vector<std::unique_ptr<CameraPorts> > cameras;
+    int cameraWidth;                     // expected resolution of the input images
+    int cameraHeight;
+    double syncWindow;                   // maximum time between the frames of a batch (s)
+    size_t unalignedFramesDropped;       // frames discarded because a camera was ahead of the others
 
     std::map<std::string, Color> objectsColor;
 
+    // Staged pipeline capture -> dispatch -> (preprocess, infer, postprocess on the workers) -> publish
+    std::unique_ptr<BoundedQueue<BatchPtr> > capturedQueue;
+    std::unique_ptr<WorkStealingScheduler> inferenceScheduler;
+    std::unique_ptr<ReorderBuffer<BatchPtr> > reorderBuffer;
+    std::vector<std::unique_ptr<PipelineStage> > pipelineStages;
+
+    // Counters of the event driven processing
+    std::atomic<uint64_t> batchesPublished;
+    std::atomic<uint64_t> staleBatchesDropped;
+    std::atomic<double> achievedRate;
+    uint64_t lastBatchesPublished;
+    double lastMonitorTime;
+
+    // Summary of the pipeline in the log every monitorLogPeriod, off when 0
+    double monitorLogPeriod;
+    double lastMonitorLogTime;
+
+    // Capture to publish latency of the last frames
+    std::unique_ptr<LatencyWindow> publishLatency;
+
+    // Timing of the hot path stages, streamed on statsPort every statsPeriod
+    StageStatistics stageStatistics;
+    std::atomic<uint64_t> framesIn;
+    std::atomic<uint64_t> framesOut;
+    std::atomic<uint64_t> framesDropped;
+    yarp::os::BufferedPort<yarp::os::Bottle> statsPort;
+    double statsPeriod;
+    double lastStatsTime;
+
 
     
     const int fontFace = CV_FONT_HERSHEY_TRIPLEX;
@@ -128,12 +287,35 @@ public:
 
 
     /**
-     * Function to write into the Bottle outputLabelPort
-     * @param label
+     * Swap the detections of a frame with the last inferred ones of its camera, the buffers change hands
+     * without being copied
+     * @param t_camera
+     * @param t_frame
      */
-    void writeToLabelPort(std::string label);
+    void exchangeInferredDetections(CameraPorts &t_camera, DetectionFrame &t_frame);
 
-    std::string predictTopClass();
+    /**
+     * Function to write the detections of a frame into the Bottle outputLabelPort of its camera,
+     * with the envelope of the input frame. Called with publishMutex held
+     * @param t_frame
+     */
+    void writeToLabelPort(const FramePtr &t_frame);
+
+    /**
+     * Read one frame per camera on the input ports and run the detection on them in one batch. Only when the
+     * realTime stream is not processed, the input ports are read by the pipeline otherwise
+     * @return the frames with their detections, shared by the following drawing and publishing, nullptr if no image
+     */
+    BatchPtr predictTopClass();
+
+    /**
+     * Detections of the main model last published on each camera, for the get label request. Without realTime a
+     * batch is inferred and published first, while the realTime stream is processed its ports and its state are
+     * only touched by the pipeline and the request gets what it published last
+     * @param t_detections one list per camera with detections : its name, then its detections as on its label port
+     * @return false if no camera has detections
+     */
+    bool getLabels(yarp::os::Bottle &t_detections);
 
 
     /**
@@ -148,12 +330,36 @@ public:
     */
     double getDetectionThreshold();
 
-    void drawDetectedBoxes(IplImage* t_imageToDraw);
+    /**
+     * Set the detection threshold of one of the additional models
+     * @param t_modelName group of the model in the configuration file
+     * @param t_thresholdInference
+     * @return false if there is no such model
+     */
+    bool setModelThreshold(const std::string &t_modelName, double t_thresholdInference);
 
     /**
-     * Send to the ouputBoxPort the image with the detected boxes
+     * @param t_modelName group of the model in the configuration file
+     * @param t_thresholdInference detection threshold of the model
+     * @return false if there is no such model
      */
-    void sendImageBoxesDetected();
+    bool getModelThreshold(const std::string &t_modelName, double *t_thresholdInference);
+
+    /**
+     * Draw the boxes and the names of the detected objects
+     * @param t_imageToDraw
+     * @param t_objectsDetected
+     * @param t_labels labels of the model that detected them
+     */
+    void drawDetectedBoxes(IplImage* t_imageToDraw, const DetectionBuffer &t_objectsDetected,
+                           const LabelTable &t_labels);
+
+    /**
+     * Send to the ouputBoxPort of its camera the image of the frame with its detected boxes and the envelope
+     * of the input frame, the frame buffer is sent without copy. Called with publishMutex held
+     * @param t_frame frame returned by predictTopClass
+     */
+    void sendImageBoxesDetected(const FramePtr &t_frame);
 
 
 
@@ -167,6 +373,211 @@ public:
 
     Color getRandomColor();
 
+    /**
+     * Current number of frames waiting between the pipeline stages
+     * @return one entry per queue, empty if the pipeline is not running
+     */
+    std::vector<PipelineQueueDepth> getPipelineQueueDepths();
+
+    /**
+     * Rate reached by the realTime processing and frames dropped to respect the latency budget
+     */
+    SchedulingStats getSchedulingStats();
+
+    /**
+     * Percentiles of the time between the capture of the last frames, given by their envelope, and the
+     * publication of their detections
+     */
+    LatencyPercentiles getPublishLatency();
+
+    /**
+     * Durations of the hot path stages, merged over all the threads
+     * @return one summary per stage
+     */
+    std::vector<StageSummary> getStageSummaries();
+
+    FrameCounters getFrameCounters();
+
+    /**
+     * Format the frame counters and the stage durations as sent on the stats port :
+     * (frames in out dropped) (stage count mean p50 p90 p99 max) ... durations in ms
+     * @param t_stats
+     */
+    void writeStats(yarp::os::Bottle &t_stats);
+
+    /**
+     * Counters of the workers inferring the batches, zero workers if the pipeline is not running
+     */
+    SchedulerStats getSchedulerStats();
+
+    /**
+     * Benchmark mode : infer the same frame with 1 to t_maxWorkers concurrent workers and log the frame rate
+     * reached by each, the graph is loaded without opening any port
+     * @param t_maxWorkers
+     * @param t_frameCount frames inferred per worker count
+     * @param t_imagePath image inferred, random pixels at the camera resolution if empty
+     * @return false if the graph can not be loaded
+     */
+    bool runScalingBenchmark(int t_maxWorkers, int t_frameCount, const std::string &t_imagePath);
+
+    /**
+     * Counters of the pool of input tensors, the misses stay constant once the pool is warm
+     */
+    TensorPoolStats getInputTensorPoolStats();
+
+    /**
+     * Tiles inferred and skipped because unchanged, in the tiled mode
+     */
+    TileStats getTileStats();
+
+    /**
+     * Time spent and bytes saved by the conversion of the frames into input tensors
+     */
+    PreprocessStats getPreprocessStats();
+
+    /**
+     * Frames inferred and tracked, and tracks followed, when the tracking is enabled
+     */
+    TrackerStats getTrackerStats();
+
+    /**
+     * Frames skipped by the motion gating and inference time saved
+     */
+    MotionStats getMotionStats();
+
+    /**
+     * Start loading another model in the background, configured like the current one. Once its graph is loaded
+     * and its sessions warmed up, it replaces the current model between two batches, the batches already in
+     * progress finish with the previous model which is freed with the last of them
+     * @param t_modelName coco or open, gives the format of the labels and the layers of the graph
+     * @param t_graphPath
+     * @param t_labelsPath
+     * @return false if a model is already loading
+     */
+    bool requestModelSwap(const std::string &t_modelName, const std::string &t_graphPath,
+                          const std::string &t_labelsPath);
+
+    /**
+     * Model serving the frames and timing of the last swap
+     */
+    ModelSwapStats getModelSwapStats();
+
+private:
+
+    /**
+     * @return model serving the frames, kept alive by the caller even if it is swapped meanwhile
+     */
+    std::shared_ptr<tensorflowObjectDetection> currentDetector() const;
+
+    /**
+     * Body of modelLoader : load, warm up and switch to a new model
+     * @param t_modelName
+     * @param t_graphPath
+     * @param t_labelsPath
+     */
+    void loadModel(std::string t_modelName, std::string t_graphPath, std::string t_labelsPath);
+
+    /**
+     * Set the per class thresholds, the class mask and the suppression of a model from its configuration. The
+     * detection threshold of the model is kept
+     * @param t_detector
+     * @param t_config the module configuration for the main model, the group of an additional model
+     */
+    void configureClassFilter(tensorflowObjectDetection *t_detector, const yarp::os::Searchable &t_config);
+
+    /**
+     * Choose between inferring a batch and publishing it without inference : its scene did not change since the
+     * last inferred batch (unchanged), or its detections are predicted from the tracks (tracked). Always inferred
+     * without motion gating and tracking
+     * @param t_workerFree false if the inference would wait for a worker, the batch is tracked then
+     * @return true if the batch has to be inferred
+     */
+    bool scheduleInference(const BatchPtr &t_batch, bool t_workerFree);
+
+    /**
+     * Detections of the frames of a batch from the tracks : predicted for a tracked batch, the detections of an
+     * inferred batch correcting the tracks and getting their ids. Called with publishMutex held
+     * @param t_batch
+     */
+    void trackBatch(const BatchPtr &t_batch);
+
+    /**
+     * Start the threads processing the realTime stream as the frames arrive : one thread per pipeline stage, or
+     * a single thread reading, inferring and publishing when the pipeline is disabled
+     * @return flag for the success
+     */
+    bool startPipeline();
+
+    /**
+     * Unblock and join the pipeline stages
+     */
+    void stopPipeline();
+
+    /**
+     * Serial processing : read, infer and publish one batch, the next read starts right after
+     */
+    bool serialStep();
+
+    /**
+     * Capture stage : read a frame on the input port of each camera
+     */
+    bool captureStep();
+
+    /**
+     * Dispatch stage : number the captured batches and hand them over to the inference workers
+     */
+    bool dispatchStep();
+
+    /**
+     * Publish stage : draw the detections and write the output ports, in the order of capture
+     */
+    bool publishStep();
+
+    /**
+     * Read an image on the input port of a camera and take the ownership of its buffer
+     * @param t_cameraIndex
+     * @return nullptr if the read has been interrupted
+     */
+    FramePtr acquireFrame(size_t t_cameraIndex);
+
+    /**
+     * Read one image per camera, the frames of the cameras lagging behind are read again until all of them
+     * were captured within the synchronisation window
+     * @return nullptr if a read has been interrupted
+     */
+    BatchPtr acquireBatch();
+
+    /**
+     * Colour conversion and creation of the batched tensor
+     * @param t_batch
+     * @return false if the frames can not be converted
+     */
+    bool preprocessBatch(const BatchPtr &t_batch);
+
+    /**
+     * @param t_batch
+     * @return true if a frame of the batch was read longer than the latency budget ago
+     */
+    bool isBatchStale(const BatchPtr &t_batch) const;
+
+    /**
+     * Preprocessing, forward pass and postprocessing of a batch, run by the inference workers
+     * @param t_batch
+     * @return false if the batch could not be inferred
+     */
+    bool inferBatch(const BatchPtr &t_batch);
+
+    /**
+     * Extract the detections of each frame of an inferred batch and format them
+     * @param t_batch
+     */
+    void postprocessBatch(const BatchPtr &t_batch);
+
+    /**
+     * Publish the detections of each frame of a batch on the ports of its camera
+     * @param t_batch
+     */
+    void publishBatch(const BatchPtr &t_batch);
 
 };
 
@@ -0,0 +1,150 @@
+#ifndef OBJECTRECOGNITIONINFER_ObjectTracker_H
+#define OBJECTRECOGNITIONINFER_ObjectTracker_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "DetectionBuffer.h"
+
+/**
+ * Tracking of the detected objects between the inferred frames, the frames in between are published with the
+ * predicted boxes instead of waiting for an inference
+ */
+struct TrackerConfig {
+    int inferencePeriod;        // one frame out of inferencePeriod is inferred, the others are tracked
+    float matchIoU;             // a detection overlapping the predicted box of a track of its class by more updates it
+    float minConfidence;        // a track mispredicted by more on its last inference gets the next frame inferred
+    int maxMissed;              // inferences a track survives without detection, it is not output meanwhile
+    double processNoise;        // acceleration of the objects (px/s^2), standard deviation
+    double measurementNoise;    // error of the detected boxes (px), standard deviation
+};
+
+struct TrackerStats {
+    uint64_t framesInferred;
+    uint64_t framesTracked;
+    uint64_t framesSuperseded;  // inferred but not published, a later frame was published from the tracks meanwhile
+    uint64_t tracksCreated;
+    uint64_t activeTracks;      // tracks detected on the last inference of their source
+};
+
+/**
+ * Multi object tracker : the detections of an inferred frame are associated to the tracks of their class by the
+ * overlap with the predicted boxes, and each track follows its box with a constant velocity Kalman filter per
+ * coordinate. A track keeps its id for as long as it is detected, the id is output as the instance of the
+ * detection instead of the rank of the object in its class. Thread safe
+ */
+class ObjectTracker {
+public:
+
+    ObjectTracker();
+
+    /**
+     * Change the tracking, the tracks are dropped
+     * @param t_config
+     */
+    void configure(const TrackerConfig &t_config);
+
+    TrackerConfig getConfig() const;
+
+    /**
+     * @param t_source camera of the frame
+     * @return true if the next frame of the source has to be inferred : it has no tracks yet, inferencePeriod
+     * frames went by since its last inference, or the motion of one of its tracks was mispredicted
+     */
+    bool inferenceDue(size_t t_source) const;
+
+    /**
+     * Count a frame of a source as inferred or tracked
+     * @param t_source
+     * @param t_inferred
+     */
+    void countFrame(size_t t_source, bool t_inferred);
+
+    /**
+     * Count an inferred frame that only corrected the tracks, a later frame having been published meanwhile
+     */
+    void countSuperseded();
+
+    /**
+     * Correct the tracks of a source with the detections of an inferred frame, the frames must come in the order
+     * of their time
+     * @param t_source
+     * @param t_time capture time of the frame (s)
+     * @param t_objectsDetected detections of the frame, replaced by the tracks detected in it, their instance
+     * being the track id
+     */
+    void update(size_t t_source, double t_time, DetectionBuffer *t_objectsDetected);
+
+    /**
+     * Boxes of the tracks of a source predicted at the time of a frame that is not inferred, the tracks are not
+     * modified so the frames may come in any order
+     * @param t_source
+     * @param t_time capture time of the frame (s)
+     * @param t_maxDetections
+     * @param t_objectsDetected emptied then filled with the tracks detected on the last inference
+     */
+    void predict(size_t t_source, double t_time, size_t t_maxDetections, DetectionBuffer *t_objectsDetected) const;
+
+    /**
+     * Drop the tracks of all the sources, e.g. when the model and its classes change. The ids are not reused
+     */
+    void reset();
+
+    TrackerStats getStats() const;
+
+private:
+    // Position and velocity of one coordinate of a box, with their covariance
+    struct AxisState {
+        double position;
+        double velocity;
+        double positionVariance;
+        double covariance;
+        double velocityVariance;
+    };
+
+    struct Track {
+        int32_t id;
+        int32_t classId;
+        float score;
+        double time;            // of the last update
+        AxisState axes[4];      // centre x, centre y, width, height
+        float confidence;       // overlap of the predicted box with the detection of the last update
+        int missed;             // inferences since the last detection
+    };
+
+    struct SourceTracks {
+        std::vector<Track> tracks;
+        int framesSinceInference = 0;
+    };
+
+    TrackerConfig m_config;
+    mutable std::mutex m_mutex;
+    std::map<size_t, SourceTracks> m_sources;
+
+    int32_t m_nextTrackId;
+    uint64_t m_framesInferred;
+    uint64_t m_framesTracked;
+    uint64_t m_framesSuperseded;
+
+    /**
+     * @param t_track
+     * @param t_time
+     * @return box of the track extrapolated at a time, without modifying it
+     */
+    Detection predictedDetection(const Track &t_track, double t_time) const;
+
+    /**
+     * Kalman prediction of a coordinate to a time then correction with its measurement
+     * @param t_axis
+     * @param t_elapsed time since the last update (s)
+     * @param t_measurement
+     */
+    void correctAxis(AxisState *t_axis, double t_elapsed, double t_measurement) const;
+
+    Track createTrack(const Detection &t_detection, double t_time);
+};
+
+#endif //OBJECTRECOGNITIONINFER_ObjectTracker_H
@@ -0,0 +1,35 @@
+#ifndef _PipelineStage_THREAD_H_
+#define _PipelineStage_THREAD_H_
+
+#include <yarp/os/Thread.h>
+#include <functional>
+#include <string>
+
+
+/**
+ * Thread running one stage of the detection pipeline in a loop
+ */
+class PipelineStage : public yarp::os::Thread {
+private:
+    std::string stageName;                  // name of the stage, used for logging
+    std::function<bool()> step;             // processes one item, returns false to leave the loop
+
+public:
+    /**
+     * constructor
+     * @param t_stageName
+     * @param t_step function called in a loop until the thread is stopped or it returns false
+     */
+    PipelineStage(std::string t_stageName, std::function<bool()> t_step);
+
+    /**
+     *  active part of the thread
+     */
+    void run() override;
+
+    const std::string &getStageName() const;
+};
+
+#endif  //_PipelineStage_THREAD_H_
+
+//----- end-of-file --- ( next line intentionally left blank ) ------------------
@@ -0,0 +1,125 @@
+#ifndef _ReorderBuffer_H_
+#define _ReorderBuffer_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+
+/**
+ * Gives back in sequence order the items completed out of order by concurrent workers
+ */
+template<typename T>
+class ReorderBuffer {
+public:
+    /**
+     * Constructor
+     * @param t_capacity maximum number of sequence numbers reserved and not popped yet
+     */
+    explicit ReorderBuffer(size_t t_capacity) : m_capacity(t_capacity > 0 ? t_capacity : 1), m_closed(false),
+                                                m_nextReserved(0), m_nextPopped(0), m_reordered(0) {}
+
+    /**
+     * Reserve the next sequence number, blocking while capacity items are in flight.
+     * Every reserved sequence number must be pushed, otherwise pop waits for it forever
+     * @param t_sequence
+     * @return false if the buffer has been closed
+     */
+    bool reserve(uint64_t &t_sequence) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_nextReserved - m_nextPopped < m_capacity; });
+        if (m_closed) {
+            return false;
+        }
+
+        t_sequence = m_nextReserved++;
+        return true;
+    }
+
+    /**
+     * Hand over the item of a reserved sequence number, in any order
+     * @param t_sequence
+     * @param t_item
+     */
+    void push(uint64_t t_sequence, T t_item) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return;
+        }
+
+        if (t_sequence != m_nextPopped) {
+            ++m_reordered;
+        }
+
+        m_items[t_sequence] = std::move(t_item);
+        m_notEmpty.notify_all();
+    }
+
+    /**
+     * Pop the item of the next sequence number, blocking until it has been pushed
+     * @param t_item
+     * @return false if the buffer has been closed
+     */
+    bool pop(T &t_item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || m_items.find(m_nextPopped) != m_items.end(); });
+        if (m_closed) {
+            return false;
+        }
+
+        auto it = m_items.find(m_nextPopped);
+        t_item = std::move(it->second);
+        m_items.erase(it);
+        ++m_nextPopped;
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Wake up every blocked caller, following calls fail
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_items.clear();
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    /**
+     * @return number of sequence numbers reserved and not popped yet
+     */
+    size_t inFlight() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<size_t>(m_nextReserved - m_nextPopped);
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    /**
+     * @return number of items pushed before the item of a previous sequence number
+     */
+    size_t reordered() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reordered;
+    }
+
+private:
+    const size_t m_capacity;
+    bool m_closed;
+    uint64_t m_nextReserved;
+    uint64_t m_nextPopped;
+    size_t m_reordered;
+
+    std::map<uint64_t, T> m_items;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+#endif  //_ReorderBuffer_H_
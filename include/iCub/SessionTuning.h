@@ -0,0 +1,99 @@
+#ifndef OBJECTRECOGNITIONINFER_SessionTuning_H
+#define OBJECTRECOGNITIONINFER_SessionTuning_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tensorflow/core/public/session.h>
+
+
+/**
+ * Thread pools of a session, 0 lets TensorFlow pick the number of threads
+ */
+struct ThreadingConfig {
+    int intraOpThreads;         // threads running the kernels of one op
+    int interOpThreads;         // ops of the graph run concurrently
+    bool perSessionThreads;     // pools owned by the session instead of shared by the process
+};
+
+/**
+ * What the threading tuner optimises
+ */
+enum class TuningObjective {
+    None,
+    Latency,                    // lowest median time of one run
+    Throughput                  // most runs per second with all the workers busy
+};
+
+/**
+ * Measure of one threading configuration
+ */
+struct TuningResult {
+    ThreadingConfig config;
+    double p50LatencyMs;
+    double framesPerSecond;
+};
+
+/**
+ * @param t_objective name as given in the configuration file : off, latency or throughput
+ * @return TuningObjective, None for an unknown name
+ */
+TuningObjective parseTuningObjective(const std::string &t_objective);
+
+/**
+ * Fill the options of a session with a threading configuration. Without explicit thread counts the cores
+ * are split between the sessions
+ * @param t_config
+ * @param t_sessionCount sessions created with these options
+ * @param t_options
+ */
+void applyThreadingConfig(const ThreadingConfig &t_config, int t_sessionCount, tensorflow::SessionOptions *t_options);
+
+/**
+ * Configurations tried by the tuner : intra op threads in powers of two up to the cores of one session,
+ * a few inter op threads, shared and per session pools
+ * @param t_cores cores available to the process
+ * @param t_sessionCount
+ * @return grid of configurations
+ */
+std::vector<ThreadingConfig> buildThreadingGrid(int t_cores, int t_sessionCount);
+
+/**
+ * @param t_results one per configuration tried
+ * @param t_objective
+ * @return index of the best configuration
+ */
+size_t selectBestThreading(const std::vector<TuningResult> &t_results, TuningObjective t_objective);
+
+/**
+ * Key of a tuned configuration, only valid on the same host for the same graph and input
+ * @param t_graphHash hash of the serialized graph
+ * @param t_inputShape input tensor the graph is tuned for
+ * @param t_sessionCount
+ * @param t_concurrency runs in flight during the measure
+ * @param t_objective
+ * @return key without spaces
+ */
+std::string threadingCacheKey(uint64_t t_graphHash, const tensorflow::TensorShape &t_inputShape, int t_sessionCount,
+                              int t_concurrency, TuningObjective t_objective);
+
+/**
+ * Look for a tuned configuration in the cache file, one "key intra inter perSession" line per configuration
+ * @param t_cachePath
+ * @param t_key
+ * @param t_config
+ * @return false if the file or the key does not exist
+ */
+bool readThreadingCache(const std::string &t_cachePath, const std::string &t_key, ThreadingConfig *t_config);
+
+/**
+ * Store a tuned configuration, replacing the line of the same key
+ * @param t_cachePath
+ * @param t_key
+ * @param t_config
+ * @return false if the file can not be written
+ */
+bool writeThreadingCache(const std::string &t_cachePath, const std::string &t_key, const ThreadingConfig &t_config);
+
+#endif //OBJECTRECOGNITIONINFER_SessionTuning_H
@@ -0,0 +1,148 @@
+#ifndef _StageStatistics_H_
+#define _StageStatistics_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * Timed stages of the processing of a frame
+ */
+enum class Stage {
+    PortRead,               // read on the input port, including the wait for the frame
+    ColourConversion,       // resize and channel swap of the images into the tensor
+    MatToTensor,            // whole conversion, tensor acquisition included
+    SessionRun,
+    Postprocess,            // extraction and formatting of the detections
+    DrawBoxes,
+    PortWrite,
+    Track,                  // prediction or correction of the tracks between the inferred frames
+    MotionCheck,            // comparison of the frames of a batch with the last inferred ones
+    Count
+};
+
+/**
+ * @param t_stage
+ * @return name of the stage in the statistics
+ */
+const char *stageName(Stage t_stage);
+
+struct StageSummary {
+    std::string stageName;
+    uint64_t count;
+    double meanMs;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+/**
+ * Log-linear histogram of durations in the manner of HdrHistogram : exact below 64 ns, then 32 buckets per
+ * power of two, i.e. a relative error below 3 %, up to 68 s. Written by a single thread, read by any.
+ */
+class StageHistogram {
+public:
+    static const int SubBucketBits = 5;
+    static const int MaxExponent = 36;
+    static const size_t BucketCount = (1u << (SubBucketBits + 1)) +
+                                      (MaxExponent - SubBucketBits - 1) * (1u << SubBucketBits);
+
+    StageHistogram();
+
+    /**
+     * Record a duration, only called by the owner thread
+     * @param t_nanoseconds
+     */
+    void record(uint64_t t_nanoseconds);
+
+    /**
+     * Add the content of the histogram to merged counters, may run while the owner records
+     * @param t_counts BucketCount counters
+     * @param t_sum sum of the durations (ns)
+     * @param t_max longest duration (ns)
+     */
+    void mergeInto(std::vector<uint64_t> &t_counts, uint64_t &t_sum, uint64_t &t_max) const;
+
+    static size_t bucketIndex(uint64_t t_nanoseconds);
+
+    /**
+     * @param t_index
+     * @return middle of the durations counted in the bucket (ns)
+     */
+    static double bucketValue(size_t t_index);
+
+private:
+    std::atomic<uint64_t> m_counts[BucketCount];
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * Timing histograms of the hot path stages, recorded per thread without lock and merged on demand
+ */
+class StageStatistics {
+public:
+    StageStatistics();
+
+    /**
+     * Record the duration of a stage in the histograms of the calling thread
+     * @param t_stage
+     * @param t_nanoseconds
+     */
+    void record(Stage t_stage, uint64_t t_nanoseconds);
+
+    /**
+     * Merge the histograms of all the threads
+     * @return one summary per stage
+     */
+    std::vector<StageSummary> summarize() const;
+
+private:
+    // Histograms written by one thread, allocated the first time the thread records
+    struct ThreadHistograms {
+        StageHistogram stages[static_cast<size_t>(Stage::Count)];
+    };
+
+    ThreadHistograms &getThreadHistograms();
+
+    const uint64_t m_id;
+    std::vector<std::unique_ptr<ThreadHistograms> > m_threads;
+    mutable std::mutex m_threadsMutex;
+};
+
+/**
+ * Time the scope it is declared in as one stage
+ */
+class ScopedStageTimer {
+public:
+    /**
+     * @param t_statistics nullptr disables the timing
+     * @param t_stage
+     */
+    ScopedStageTimer(StageStatistics *t_statistics, Stage t_stage)
+            : m_statistics(t_statistics), m_stage(t_stage), m_start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedStageTimer() {
+        if (m_statistics != nullptr) {
+            m_statistics->record(m_stage, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_start).count()));
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer &) = delete;
+    ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+private:
+    StageStatistics *m_statistics;
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif  //_StageStatistics_H_
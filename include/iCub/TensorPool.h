@@ -0,0 +1,71 @@
+#ifndef OBJECTRECOGNITIONINFER_TensorPool_H
+#define OBJECTRECOGNITIONINFER_TensorPool_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <tensorflow/core/framework/tensor.h>
+
+
+struct TensorPoolStats {
+    uint64_t hits;              // acquire served by a recycled tensor
+    uint64_t misses;            // acquire that had to allocate a new tensor
+    uint64_t bytesAllocated;    // total bytes allocated by the pool since its creation
+    size_t pooledTensors;       // tensors currently waiting to be reused
+};
+
+
+/**
+ * Pool of tensors keyed by shape. The tensors given to the graph are recycled once Session::Run returned
+ * instead of being allocated for every frame. Once the shapes are reserved, acquire and release do not allocate.
+ */
+class TensorPool {
+public:
+
+    explicit TensorPool(tensorflow::DataType t_dataType);
+
+    /**
+     * Preallocate tensors of a shape so that the first frames do not allocate, with room in the free list for the
+     * tensors released
+     * @param t_shape
+     * @param t_count number of tensors to allocate
+     */
+    void reserve(const tensorflow::TensorShape &t_shape, size_t t_count);
+
+    /**
+     * Get a tensor of the given shape, allocated only if none is available. Its content is undefined
+     * @param t_shape
+     * @return Tensor Object
+     */
+    tensorflow::Tensor acquire(const tensorflow::TensorShape &t_shape);
+
+    /**
+     * Give back a tensor to the pool, the tensor is left empty
+     * @param t_tensor
+     */
+    void release(tensorflow::Tensor &t_tensor);
+
+    TensorPoolStats getStats() const;
+
+private:
+    // Hash of the dimensions, the shape of a pooled tensor is still checked before it is reused
+    typedef uint64_t ShapeKey;
+
+    const tensorflow::DataType m_dataType;
+
+    mutable std::mutex m_mutex;
+    std::map<ShapeKey, std::vector<tensorflow::Tensor> > m_freeTensors;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_bytesAllocated;
+
+    static ShapeKey shapeToKey(const tensorflow::TensorShape &t_shape);
+
+    tensorflow::Tensor allocate(const tensorflow::TensorShape &t_shape);
+};
+
+
+#endif //OBJECTRECOGNITIONINFER_TensorPool_H
@@ -0,0 +1,145 @@
+#ifndef OBJECTRECOGNITIONINFER_TiledDetection_H
+#define OBJECTRECOGNITIONINFER_TiledDetection_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "DetectionBuffer.h"
+#include "ImageKernels.h"
+
+/**
+ * Split of the frames into overlapping tiles inferred in one batch, for the objects too small for a single pass
+ * over the whole frame at the input resolution of the model
+ */
+struct TilingConfig {
+    int columns;                // 1 x 1 disables the tiling
+    int rows;
+    double overlap;             // fraction of a tile shared with its neighbour
+    float mergeIoU;             // detections of a class from different tiles overlapping by more are merged
+    double changeThreshold;     // mean grey difference (0-255) under which a tile is not inferred again, 0 to disable
+    int refreshFrames;          // frames after which a skipped tile is inferred anyway
+
+    bool enabled() const {
+        return columns * rows > 1;
+    }
+};
+
+struct ImageTile {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+/**
+ * Tiles of the same size covering an image, the first and last ones of each row and column are on its borders
+ * @param t_width
+ * @param t_height
+ * @param t_columns
+ * @param t_rows
+ * @param t_overlap minimum fraction of a tile shared with its neighbour
+ * @return tiles row by row
+ */
+std::vector<ImageTile> computeTiles(int t_width, int t_height, int t_columns, int t_rows, double t_overlap);
+
+/**
+ * Tiles of a frame converted into a batched input tensor
+ */
+struct TiledFrame {
+    size_t source = 0;                  // camera of the frame, each one has its own tile state
+    int imageWidth = 0;
+    int imageHeight = 0;
+    std::vector<ImageTile> tiles;       // layout of the frame
+    std::vector<int> inferredTiles;     // tiles converted in the batch, the others reuse their last detections
+    int firstBatchIndex = 0;            // batch index of the first converted tile
+    uint64_t sequence = 0;              // order of the selection of the tiles, a later frame has a greater one
+    ResizeGeometry geometry = {};       // placement of a tile in the input tensor
+};
+
+struct TileStats {
+    uint64_t frames;
+    uint64_t tilesInferred;
+    uint64_t tilesSkipped;              // unchanged since their last inference
+};
+
+/**
+ * State of the tiles of each source between the frames : thumbnail of the content they were last inferred on,
+ * to skip the unchanged ones, and their last detections, reused while they are skipped. Thread safe
+ */
+class TileCache {
+public:
+
+    TileCache();
+
+    /**
+     * Change the tiling, the state of the sources is dropped
+     * @param t_config
+     */
+    void configure(const TilingConfig &t_config);
+
+    TilingConfig getConfig() const;
+
+    /**
+     * Lay out the tiles of a frame and choose the ones to infer : all of them without change threshold, otherwise
+     * those whose content changed, that were skipped for refreshFrames or that have no detections yet
+     * @param t_source camera of the frame
+     * @param t_pixels first pixel of the frame, 3 channels
+     * @param t_stride bytes between two rows
+     * @param t_width
+     * @param t_height
+     * @param t_frame filled with the layout and the tiles to infer, the batch placement is left to the caller
+     */
+    void selectTiles(size_t t_source, const uint8_t *t_pixels, size_t t_stride, int t_width, int t_height,
+                     TiledFrame *t_frame);
+
+    /**
+     * Merge the detections of the tiles of a frame : the inferred tiles replace their cached detections, the
+     * skipped ones contribute their cached detections, the duplicates across the tile borders are suppressed.
+     * The frames may complete out of order, the detections of a tile are only replaced by those of a frame
+     * selected after the one they come from, an older frame still uses its own ones
+     * @param t_frame
+     * @param t_tileDetections detections of each inferred tile in the frame coordinates, empty if the inference
+     * failed so that only the cached detections are used
+     * @param t_maxDetections
+     * @param t_objectsDetected
+     */
+    void mergeTiles(const TiledFrame &t_frame, const std::vector<std::vector<Detection> > &t_tileDetections,
+                    size_t t_maxDetections, DetectionBuffer *t_objectsDetected);
+
+    TileStats getStats() const;
+
+private:
+    struct SourceTiles {
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<uint8_t> > thumbnails;      // grey content of each tile when last inferred
+        std::vector<int> skippedFrames;
+        std::vector<std::vector<Detection> > detections;    // last detections of each tile, frame coordinates
+        std::vector<uint64_t> detectionSequences;           // sequence of the frame the detections come from
+        std::vector<bool> cached;
+    };
+
+    TilingConfig m_config;
+    mutable std::mutex m_mutex;
+    std::map<size_t, SourceTiles> m_sources;
+    uint64_t m_nextSequence;            // not reset by configure, the frames in flight stay older
+
+    uint64_t m_frames;
+    uint64_t m_tilesInferred;
+    uint64_t m_tilesSkipped;
+
+    /**
+     * State of a source for a frame size, reset when the size changes
+     * @param t_source
+     * @param t_width
+     * @param t_height
+     * @param t_tileCount
+     * @return SourceTiles
+     */
+    SourceTiles &sourceTiles(size_t t_source, int t_width, int t_height, size_t t_tileCount);
+};
+
+#endif //OBJECTRECOGNITIONINFER_TiledDetection_H
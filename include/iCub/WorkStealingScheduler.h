@@ -0,0 +1,103 @@
+#ifndef _WorkStealingScheduler_H_
+#define _WorkStealingScheduler_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PipelineStage.h"
+
+
+struct SchedulerStats {
+    size_t workers;             // threads executing the tasks
+    uint64_t executed;          // tasks run to completion
+    uint64_t stolen;            // tasks taken from the queue of another worker
+};
+
+/**
+ * Pool of worker threads, each with its own task queue, the idle workers steal from the busy ones
+ */
+class WorkStealingScheduler {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * Constructor, the workers are started by start
+     * @param t_workerCount number of worker threads, at least one
+     */
+    explicit WorkStealingScheduler(size_t t_workerCount);
+
+    /**
+     * Stop the workers, the tasks not started yet run on the calling thread
+     */
+    ~WorkStealingScheduler();
+
+    /**
+     * Start one thread per worker
+     * @return flag for the success
+     */
+    bool start();
+
+    /**
+     * Wake up and join the workers, then run on the calling thread the tasks accepted and not started yet, so that
+     * every task for which submit returned true runs once
+     */
+    void stop();
+
+    /**
+     * Queue a task. It goes to the queue of the calling worker, or to the next queue in turn when called from
+     * another thread, and runs on whichever worker reaches it first
+     * @param t_task
+     * @return false if the scheduler is stopped, the task is not run then
+     */
+    bool submit(Task t_task);
+
+    size_t getWorkerCount() const;
+
+    SchedulerStats getStats() const;
+
+private:
+    // Tasks owned by one worker : it pops the front, the thieves take the back
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /**
+     * Wait for a task and run it
+     * @param t_workerIndex
+     * @return false once the scheduler is stopped
+     */
+    bool workerStep(size_t t_workerIndex);
+
+    /**
+     * Take a task from the queue of the worker, or steal one from the other queues
+     * @param t_workerIndex
+     * @param t_task
+     * @return false if all the queues are empty
+     */
+    bool takeTask(size_t t_workerIndex, Task &t_task);
+
+    std::vector<std::unique_ptr<WorkerQueue> > m_queues;
+    std::vector<std::unique_ptr<PipelineStage> > m_workers;
+
+    // Tasks queued and not taken yet, the idle workers sleep while it is zero
+    size_t m_pendingTasks;
+    bool m_stopped;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeUp;
+
+    std::atomic<size_t> m_nextQueue;
+    std::atomic<uint64_t> m_executed;
+    std::atomic<uint64_t> m_stolen;
+};
+
+#endif  //_WorkStealingScheduler_H_
+
+//----- end-of-file --- ( next line intentionally left blank ) ------------------
@@ -10,6 +10,7 @@
 #include <utility>
 #include <vector>
 #include <iostream>
+#include <mutex>
 
 // Tensorflow import
 #include <tensorflow/cc/ops/const_op.h>
@@ -24,40 +25,61 @@
 #include <tensorflow/core/lib/core/threadpool.h>
 #include <tensorflow/core/lib/io/path.h>
 #include <tensorflow/core/lib/strings/stringprintf.h>
+#include <tensorflow/core/platform/cpu_info.h>
 #include <tensorflow/core/platform/env.h>
 #include <tensorflow/core/platform/init_main.h>
 #include <tensorflow/core/platform/logging.h>
 #include <tensorflow/core/platform/types.h>
 #include <tensorflow/core/public/session.h>
 #include <tensorflow/core/util/command_line_flags.h>
+#include <tensorflow/core/util/memmapped_file_system.h>
+
+#include "DetectionBuffer.h"
+#include "DetectionKernels.h"
+#include "GraphOptimization.h"
+#include "LabelTable.h"
+#include "TensorPool.h"
+#include "ImageKernels.h"
+#include "SessionTuning.h"
+#include "StageStatistics.h"
+#include "TiledDetection.h"
 
 // OpenCV import
 #include <opencv2/core/mat.hpp>
 #include <opencv/cv.hpp>
 
-struct Box {
-    int coordinate[4];
-    double probabilityDetection;
-    std::string className;
+struct PreprocessStats {
+    uint64_t frames;            // frames converted into an input tensor
+    uint64_t bytesSaved;        // bytes of camera image not copied thanks to the resize
+    double totalTimeMs;         // time spent converting the frames
 };
 
+/**
+ * Format of the file given as graph_path
+ */
+enum class GraphFormat {
+    Frozen,                     // frozen GraphDef, parsed with its weights into the heap of the process
+    Memmapped                   // memmapped package written by objectDetectionConvertGraph, weights mapped read only
+};
 
-inline std::string boxToString(Box b) {
-    std::string boxToString;
-    boxToString.append(std::to_string(b.coordinate[0]) + " ");
-    boxToString.append(std::to_string(b.coordinate[1]) + " ");
-    boxToString.append(std::to_string(b.coordinate[2]) + " ");
-    boxToString.append(std::to_string(b.coordinate[3]) + " ");
-    boxToString.append(std::to_string(b.probabilityDetection));
-
-    return boxToString;
-}
+/**
+ * @param t_format name as given in the configuration file : frozen or memmapped
+ * @return GraphFormat, Frozen for an unknown name
+ */
+GraphFormat parseGraphFormat(const std::string &t_format);
+
+struct GraphLoadStats {
+    double loadTimeMs;          // reading and parsing of the graph
+    double sessionTimeMs;       // creation of the sessions
+    long residentAnonymousKb;   // private memory of the process once the sessions are created
+    long residentFileKb;        // mapped file pages, shared with the other processes mapping the same model
+};
 
 class tensorflowObjectDetection {
 public:
 
-    // Output Map of the detected object convention coordinate boxes [x1, y1, x2, y2]
-    std::map<std::string, Box> m_objectsDetected;
+    // Detections of the last inferObject, convention coordinate boxes [x1, y1, x2, y2]
+    DetectionBuffer m_objectsDetected;
 
     /**
      * Defautls constructor
@@ -68,11 +90,117 @@ public:
 
     /**
      * Execute forward pass on the load graph
-     * @param t_inputImage
+     * @param t_inputImage image as read on the input port, its red and blue channels are swapped for the graph
      * @return
      */
     std::string inferObject(cv::Mat t_inputImage);
 
+    /**
+     * Execute forward pass on the load graph, thread safe version filling a buffer owned by the caller
+     * @param t_inputImage image as read on the input port, it is not modified
+     * @param t_objectsDetected filled with the objects detected above the threshold, reused between the calls
+     * @return Format String of detected objects
+     */
+    std::string inferObject(cv::Mat t_inputImage, DetectionBuffer *t_objectsDetected);
+
+    /**
+     * Preprocessing step of inferObject, convert an image into the input tensor of the graph
+     * @param t_inputImage image as read on the input port, it is not modified
+     * @param t_geometry placement of the image in the tensor, needed to map back the boxes
+     * @return Tensor Object
+     */
+    tensorflow::Tensor imageToTensor(cv::Mat t_inputImage, ResizeGeometry *t_geometry);
+
+    /**
+     * Preprocessing of several images stacked in one batched input tensor, e.g. one per camera.
+     * The images must have the same resolution unless they are resized to the input resolution of the model
+     * @param t_inputImages images as read on the input ports, they are not modified
+     * @param t_inputTensor batched input of the graph, one image per batch index
+     * @param t_geometries placement of each image in the tensor, needed to map back the boxes
+     * @return Tensorflow::Status
+     */
+    tensorflow::Status imagesToTensor(const std::vector<cv::Mat> &t_inputImages, tensorflow::Tensor *t_inputTensor,
+                                      std::vector<ResizeGeometry> *t_geometries);
+
+    /**
+     * Inference step of inferObject, execute the forward pass on an already converted input.
+     * Thread safe, several frames can be in flight at the same time on the pool of sessions
+     * @param t_inputTensor tensor returned by imageToTensor, given back to the tensor pool once the run is over
+     * @param t_outputs raw output tensors of the graph
+     * @return Tensorflow::Status
+     */
+    tensorflow::Status runGraph(tensorflow::Tensor &t_inputTensor, std::vector<tensorflow::Tensor> *t_outputs);
+
+    /**
+     * Forward pass on an input converted by another detector with the same input resolution, several models
+     * inferring the same frames share its conversion. Thread safe like runGraph
+     * @param t_inputTensor tensor converted by the other detector, left to its tensor pool
+     * @param t_outputs raw output tensors of the graph
+     * @return Tensorflow::Status
+     */
+    tensorflow::Status runGraphOnSharedInput(const tensorflow::Tensor &t_inputTensor,
+                                             std::vector<tensorflow::Tensor> *t_outputs);
+
+    /**
+     * Postprocessing step of inferObject, fill the buffer of the detected objects from the graph outputs
+     * @param t_outputs raw output tensors of the graph
+     * @param t_batchIndex index of the image in the batched input
+     * @param t_geometry returned by imageToTensor, the boxes are given in the source image coordinates
+     * @param t_objectsDetected emptied then filled with at most getMaxDetections() objects
+     */
+    void extractDetections(std::vector<tensorflow::Tensor> &t_outputs, int t_batchIndex,
+                           const ResizeGeometry &t_geometry, DetectionBuffer *t_objectsDetected);
+
+    /**
+     * Preprocessing of the tiled mode : the tiles of each image to infer, see setTiling, are stacked in one
+     * batched input tensor
+     * @param t_inputImages images as read on the input ports, they are not modified
+     * @param t_sources camera of each image, the unchanged tiles are tracked per camera
+     * @param t_inputTensor batched input of the graph, left empty if no tile has to be inferred
+     * @param t_tiledFrames layout and inferred tiles of each image, needed to merge their detections
+     * @return Tensorflow::Status
+     */
+    tensorflow::Status tilesToTensor(const std::vector<cv::Mat> &t_inputImages, const std::vector<size_t> &t_sources,
+                                     tensorflow::Tensor *t_inputTensor, std::vector<TiledFrame> *t_tiledFrames);
+
+    /**
+     * Postprocessing of the tiled mode : the detections of the inferred tiles are mapped to the frame, merged
+     * with those of the skipped tiles and the duplicates across the tile borders are suppressed
+     * @param t_outputs raw output tensors of the graph, empty if no tile was inferred
+     * @param t_tiledFrame returned by tilesToTensor, possibly by another detector of the same input resolution
+     * @param t_objectsDetected emptied then filled with at most getMaxDetections() objects
+     */
+    void extractTiledDetections(std::vector<tensorflow::Tensor> &t_outputs, const TiledFrame &t_tiledFrame,
+                                DetectionBuffer *t_objectsDetected);
+
+    /**
+     * Format the detected objects as sent on the label port : "label : x1 y1 x2 y2 score ; ...",
+     * the label of the second object of a class is numbered label1, then label2...
+     * @param t_objectsDetected
+     * @param t_labels labels of the model, see getLabels
+     * @return Format String of detected objects
+     */
+    static std::string detectionsToString(const DetectionBuffer &t_objectsDetected, const LabelTable &t_labels);
+
+    /**
+     * @param t_labels
+     * @param t_detection
+     * @return label of the detection followed by its instance number if it is not the first of its class
+     */
+    static std::string detectionName(const LabelTable &t_labels, const Detection &t_detection);
+
+    /**
+     * @return labels of the model by class id, loaded by initGraph
+     */
+    const LabelTable &getLabels() const;
+
+    /**
+     * Binary cache of the labels, mapped by initGraph instead of parsing the label file if it was built from
+     * the same file content, written otherwise
+     * @param t_cachePath empty to always parse the label file
+     */
+    void setLabelsCache(std::string t_cachePath);
+
 
     /**
      * Initialize the networks by loading the graph and labels
@@ -80,6 +208,27 @@ public:
      */
     tensorflow::Status initGraph();
 
+    /**
+     * Run every session on a synthetic input of the expected resolution, so that the first frames do not pay
+     * the allocations of the sessions
+     * @param t_runs runs per session
+     * @return Tensorflow::Status
+     */
+    tensorflow::Status warmUp(int t_runs);
+
+    /**
+     * Detector of another model configured like this one : threshold, limits, input size, sessions, threading,
+     * graph format, precision and optimisation. The per class thresholds and the class mask are not copied, they
+     * refer to the class ids of this model : the new one keeps every class above the detection threshold. Its
+     * graph is not loaded and its labels are not cached
+     * @param t_pathGraph
+     * @param t_pathLabels
+     * @param t_modelName
+     * @return detector to initialize with initGraph
+     */
+    std::unique_ptr<tensorflowObjectDetection> createForModel(std::string t_pathGraph, std::string t_pathLabels,
+                                                              std::string t_modelName) const;
+
 
 
     /**
@@ -94,13 +243,169 @@ public:
      */
     void setM_detectionThreshold(double m_inferencethreshold);
 
+    /**
+     * Maximum number of objects kept per image, the best scored ones
+     * @param t_maxDetections
+     */
+    void setMaxDetections(size_t t_maxDetections);
+
+    size_t getMaxDetections() const;
+
+    /**
+     * Per class thresholds and mask of the classes output, applied with the detection threshold in one pass
+     * over the scores. The threshold of the filter replaces the detection threshold
+     * @param t_filter
+     */
+    void setClassFilter(const ClassFilter &t_filter);
+
+    ClassFilter getClassFilter() const;
+
+    /**
+     * Class-wise non maximum suppression of the graph outputs, for the graphs that output raw candidates
+     * @param t_iouThreshold candidates of a class overlapping a better one by more are dropped, 0 to disable
+     */
+    void setNmsIoU(float t_iouThreshold);
+
+    float getNmsIoU() const;
+
+    /**
+     * Infer the frames as overlapping tiles at the input resolution of the model instead of a single downscaled
+     * pass, for the small objects. All the tiles of a frame run in one batch
+     * @param t_config
+     */
+    void setTiling(const TilingConfig &t_config);
+
+    TilingConfig getTiling() const;
+
+    /**
+     * Tiles inferred and skipped because unchanged
+     * @return TileStats
+     */
+    TileStats getTileStats() const;
+
+    /**
+     * Set the resolution of the images that will be given to the graph, the input tensors are preallocated
+     * for it by initGraph
+     * @param t_width
+     * @param t_height
+     * @param t_batchSize number of images stacked in one input tensor
+     * @param t_inFlightFrames number of input tensors that can be converted or inferred at the same time
+     */
+    void setExpectedInputSize(int t_width, int t_height, int t_batchSize, size_t t_inFlightFrames);
+
+    /**
+     * Number of sessions created by initGraph, the concurrent runs are spread over them.
+     * A single session is shared by all the runs
+     * @param t_sessionCount
+     */
+    void setSessionCount(int t_sessionCount);
+
+    int getSessionCount() const;
+
+    /**
+     * Thread pools of the sessions created by initGraph, replaced by the tuned configuration if tuning is enabled
+     * @param t_threadingConfig
+     */
+    void setThreadingConfig(const ThreadingConfig &t_threadingConfig);
+
+    /**
+     * Tune the thread pools of the sessions when initGraph is called : a grid of configurations is measured on
+     * a synthetic input of the expected resolution and the best one is stored in a cache file, keyed by host,
+     * graph and input, that is read instead on the next start
+     * @param t_objective None disables the tuning
+     * @param t_cachePath
+     * @param t_runs runs measured per configuration and per concurrent caller
+     */
+    void setThreadingTuning(TuningObjective t_objective, std::string t_cachePath, int t_runs);
+
+    /**
+     * @return thread pools of the sessions, the tuned ones once initGraph is over
+     */
+    ThreadingConfig getThreadingConfig() const;
+
+    /**
+     * Record the duration of the conversion and of the runs of the graph
+     * @param t_stageStatistics nullptr disables the timing
+     */
+    void setStageStatistics(StageStatistics *t_stageStatistics);
+
+    /**
+     * Counters of the pool of input tensors
+     * @return TensorPoolStats
+     */
+    TensorPoolStats getInputTensorPoolStats() const;
+
+    /**
+     * Resize the images to the native input resolution of the model before giving them to the graph
+     * @param t_width width of the input tensor, 0 to keep the resolution of the images
+     * @param t_height height of the input tensor, 0 to keep the resolution of the images
+     * @param t_letterbox keep the aspect ratio of the images, the borders are filled with black
+     */
+    void setInputResize(int t_width, int t_height, bool t_letterbox);
+
+    /**
+     * Time spent and bytes saved by the preprocessing
+     * @return PreprocessStats
+     */
+    PreprocessStats getPreprocessStats() const;
+
+    /**
+     * Format of the graph file, a memmapped package lets the processes running the same model share its weights
+     * @param t_graphFormat
+     */
+    void setGraphFormat(GraphFormat t_graphFormat);
+
+    /**
+     * Startup time and resident memory measured by initGraph
+     * @return GraphLoadStats
+     */
+    GraphLoadStats getGraphLoadStats() const;
+
+    /**
+     * Optimise the frozen graph at startup for the fetched outputs. The optimised graph is cached next to the
+     * exported one, keyed by the hash of the exported graph and the transforms
+     * @param t_enabled
+     * @param t_transforms transforms in the syntax of transform_graph, DefaultGraphTransforms if empty
+     */
+    void setGraphOptimization(bool t_enabled, std::string t_transforms);
+
+    /**
+     * Precision of the graph, Int8 loads the graph quantised by objectDetectionQuantizeGraph next to graph_path
+     * @param t_precision
+     */
+    void setPrecision(Precision t_precision);
+
+    Precision getPrecision() const;
+
+    /**
+     * Node count and run time reduction of the graph optimisation done by initGraph
+     * @return GraphOptimizationStats
+     */
+    GraphOptimizationStats getGraphOptimizationStats() const;
+
     
     void clearSetOfObject();
 
 private:
     // Parameters of the Deepnetworks graph
-    std::unique_ptr<tensorflow::Session> m_session;
+    std::vector<std::unique_ptr<tensorflow::Session> > m_sessions;   // created from the same graph
+    std::vector<int> m_sessionRuns;                                   // runs in progress on each session
+    std::mutex m_sessionMutex;
+    int m_sessionCount;
+
+    // Thread pools of the sessions, tuned at startup if the objective is not None
+    ThreadingConfig m_threadingConfig;
+    TuningObjective m_tuningObjective;
+    std::string m_tuningCachePath;
+    int m_tuningRuns;
     std::string m_pathToGraph;
+    GraphFormat m_graphFormat;
+    std::unique_ptr<tensorflow::MemmappedEnv> m_memmappedEnv;    // file system of the memmapped package
+    GraphLoadStats m_graphLoadStats;
+    Precision m_precision;
+    bool m_optimizeGraph;
+    std::string m_graphTransforms;
+    GraphOptimizationStats m_graphOptimizationStats;
     std::string m_pathToLabels;
     std::string m_input_layer;
     std::string m_model_name;
@@ -108,7 +413,8 @@ private:
 
     // Parameters for the output
     std::vector<std::string> m_output_layer;
-    std::map<int,std::string> m_labels;
+    LabelTable m_labels;
+    std::string m_labelsCachePath;
 
     // Parameters for the Image input and Output
     cv::Mat m_inputImage;
@@ -116,8 +422,32 @@ private:
     int m_widthInputImage;
     int m_heightInputImage;
 
-    // Parameters for the Inference
-    double m_detectionThreshold;
+    // Input tensors recycled between the frames
+    TensorPool m_inputTensorPool;
+    int m_expectedInputWidth;
+    int m_expectedInputHeight;
+    int m_expectedBatchSize;
+    size_t m_inFlightFrames;
+
+    // Resize to the native resolution of the model, 0 to disable
+    int m_targetInputWidth;
+    int m_targetInputHeight;
+    bool m_letterbox;
+    std::vector<std::shared_ptr<const ResizePlan> > m_resizePlans;    // one per source resolution
+    mutable std::mutex m_resizePlanMutex;
+
+    PreprocessStats m_preprocessStats;
+    StageStatistics *m_stageStatistics;
+    mutable std::mutex m_preprocessStatsMutex;
+
+    // Parameters for the Inference, the filter is replaced as a whole so that a frame never sees it half updated
+    std::shared_ptr<const ClassFilter> m_classFilter;
+    mutable std::mutex m_classFilterMutex;
+    float m_nmsIoU;
+    size_t m_maxDetections;
+
+    // Tiled mode, its state follows the frames of each camera
+    TileCache m_tileCache;
 
 
     /**
@@ -145,36 +475,114 @@ private:
                                           size_t *found_label_count);
 
     /**
-     * Convert a Mat OpenCV object into a Tensor
-     * @param inputHeight
-     * @param inputWidth
-     * @param inputImage
-     * @return Tensor Object
+     * Fill the label table from the binary cache if it matches the label file, from the label file otherwise
+     * @param t_openImagesFormat the label file is in the Open Images format instead of the COCO one
+     * @return Tensor status of the success of the process
      */
-    tensorflow::Tensor MatToTensor(cv::Mat inputImage);
+    tensorflow::Status LoadLabels(bool t_openImagesFormat);
+
+    /**
+     * Convert Mat OpenCV objects into a batched Tensor taken from the input tensor pool, swapping their red and
+     * blue channels and resizing them to the input resolution of the model
+     * @param inputImages 8 bits 3 channels images, rows may be padded
+     * @param t_tensor
+     * @param t_geometries placement of each image in the tensor
+     * @return Tensor status of the success of the process
+     */
+    tensorflow::Status MatToTensor(const std::vector<cv::Mat> &inputImages, tensorflow::Tensor *t_tensor,
+                                   std::vector<ResizeGeometry> *t_geometries);
+
+    /**
+     * Resize plan for a source resolution, built the first time the resolution is seen
+     * @param t_sourceWidth
+     * @param t_sourceHeight
+     * @return ResizePlan
+     */
+    std::shared_ptr<const ResizePlan> getResizePlan(int t_sourceWidth, int t_sourceHeight);
 
 
 
     /**
-     * Reads a model graph definition from disk, and creates a session object you can use to run it.
+     * Reads a model graph definition from disk, a frozen graph or the graph of a memmapped package whose constants
+     * stay in the mapped file
      * @param graph_file_name
-     * @param session
+     * @param t_graphDef
+     * @param t_graphHash hash of the file content, or the key of the optimised graph, identifies the graph in the
+     * threading cache
      * @return Tensor status of the success of the process
      */
-    tensorflow::Status LoadGraph(const std::string &graph_file_name,
-                                 std::unique_ptr<tensorflow::Session> *session);
+    tensorflow::Status LoadGraph(const std::string &graph_file_name, tensorflow::GraphDef *t_graphDef,
+                                 uint64_t *t_graphHash);
 
+    /**
+     * Optimise the exported graph and measure the run time of both graphs when the input resolution is known
+     * @param t_graphDef exported graph
+     * @param t_optimized
+     * @return Tensor status of the success of the process
+     */
+    tensorflow::Status OptimizeGraph(const tensorflow::GraphDef &t_graphDef, tensorflow::GraphDef *t_optimized);
 
+    /**
+     * Creates the session objects you can use to run a graph
+     * @param t_graphDef
+     * @param t_sessionCount
+     * @param t_threadingConfig thread pools of the sessions
+     * @param t_sessions
+     * @return Tensor status of the success of the process
+     */
+    tensorflow::Status CreateSessions(const tensorflow::GraphDef &t_graphDef, int t_sessionCount,
+                                      const ThreadingConfig &t_threadingConfig,
+                                      std::vector<std::unique_ptr<tensorflow::Session> > *t_sessions);
 
     /**
-     * Given the output of a model run, and the name of a file containing the labels
-     * this prints out the top five highest-scoring values.
+     * Shape of the input tensors given to the graph, batch of the expected or resized resolution
+     * @return empty shape if the resolution is not known
+     */
+    tensorflow::TensorShape getExpectedInputShape() const;
+
+    /**
+     * Measure every configuration of the threading grid and keep the best one for the objective, the
+     * configurations whose runs fail are left out
+     * @param t_graphDef
+     * @param t_inputShape shape of the synthetic input
+     * @param t_bestConfig
+     * @return Tensor status of the success of the process, an error if no configuration could run
+     */
+    tensorflow::Status TuneThreading(const tensorflow::GraphDef &t_graphDef, const tensorflow::TensorShape &t_inputShape,
+                                     ThreadingConfig *t_bestConfig);
+
+    /**
+     * Run the graph with one threading configuration, from as many concurrent callers as frames in flight
+     * @param t_graphDef
+     * @param t_config
+     * @param t_input synthetic input
+     * @param t_result median run time and runs per second
+     * @return Tensor status of the success of the process, the first failed run of a caller
+     */
+    tensorflow::Status MeasureThreading(const tensorflow::GraphDef &t_graphDef, const ThreadingConfig &t_config,
+                                        const tensorflow::Tensor &t_input, TuningResult *t_result);
+
+    /**
+     * Pick the session with the fewest runs in progress
+     * @return index of the session, to give back to releaseSession
+     */
+    size_t acquireSession();
+
+    void releaseSession(size_t t_sessionIndex);
+
+
+
+    /**
+     * Given the output of a model run, fill the buffer of the best objects detected above the threshold of their
+     * class, see setClassFilter and setNmsIoU, and number the objects of the same class
      * @param outputs
-     * @param labels_file_name
+     * @param t_batchIndex index of the image in the batched input
+     * @param t_geometry placement of the source image in the input tensor, used to map back the boxes
+     * @param t_objectsDetected
      * @return Tensor status of the success of the process
      */
-    tensorflow::Status PrintTopLabels(std::vector<tensorflow::Tensor> &outputs,
-                          const std::string &labels_file_name);
+    tensorflow::Status PrintTopLabels(std::vector<tensorflow::Tensor> &outputs, int t_batchIndex,
+                                      const ResizeGeometry &t_geometry, DetectionBuffer *t_objectsDetected);
 
     /**
      * Given the output of a model run, and the name of a file containing the labels
@@ -0,0 +1,571 @@
+#include "iCub/DetectionKernels.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DETECTION_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+
+void DetectionBoxes::assign(const Detection *t_detections, size_t t_count) {
+    x1.resize(t_count);
+    y1.resize(t_count);
+    x2.resize(t_count);
+    y2.resize(t_count);
+    area.resize(t_count);
+    classId.resize(t_count);
+
+    for (size_t i = 0; i < t_count; ++i) {
+        const Detection &detection = t_detections[i];
+        x1[i] = static_cast<float>(detection.box[0]);
+        y1[i] = static_cast<float>(detection.box[1]);
+        x2[i] = static_cast<float>(detection.box[2]);
+        y2[i] = static_cast<float>(detection.box[3]);
+        area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+        classId[i] = detection.classId;
+    }
+}
+
+void DetectionBoxes::clear() {
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+    area.clear();
+    classId.clear();
+}
+
+void DetectionBoxes::push(float t_x1, float t_y1, float t_x2, float t_y2, int32_t t_classId) {
+    x1.push_back(t_x1);
+    y1.push_back(t_y1);
+    x2.push_back(t_x2);
+    y2.push_back(t_y2);
+    area.push_back((t_x2 - t_x1) * (t_y2 - t_y1));
+    classId.push_back(t_classId);
+}
+
+
+/************************************* CLASS FILTER  *************************************/
+
+ClassFilter::ClassFilter(float t_threshold) : m_threshold(t_threshold), m_keepOtherClasses(true) {
+    updateThresholds();
+}
+
+void ClassFilter::setThreshold(float t_threshold) {
+    m_threshold = t_threshold;
+    updateThresholds();
+}
+
+float ClassFilter::getThreshold() const {
+    return m_threshold;
+}
+
+void ClassFilter::setClassThreshold(int32_t t_classId, float t_threshold) {
+    if (t_classId < 0) {
+        return;
+    }
+
+    if (t_classId >= static_cast<int32_t>(m_classThresholds.size())) {
+        m_classThresholds.resize(t_classId + 1, -1.0f);
+    }
+    m_classThresholds[t_classId] = t_threshold;
+    updateThresholds();
+}
+
+void ClassFilter::allowClasses(const std::vector<int32_t> &t_classIds) {
+    m_classMask.clear();
+    m_keepOtherClasses = t_classIds.empty();
+    for (const int32_t classId : t_classIds) {
+        setMaskBit(classId, true);
+    }
+    updateThresholds();
+}
+
+void ClassFilter::denyClasses(const std::vector<int32_t> &t_classIds) {
+    m_classMask.clear();
+    m_keepOtherClasses = true;
+    for (const int32_t classId : t_classIds) {
+        setMaskBit(classId, false);
+    }
+    updateThresholds();
+}
+
+bool ClassFilter::allowed(int32_t t_classId) const {
+    const size_t word = static_cast<size_t>(t_classId) / 64;
+    if (t_classId < 0 || word >= m_classMask.size()) {
+        return m_keepOtherClasses;
+    }
+
+    return (m_classMask[word] >> (t_classId % 64)) & 1u;
+}
+
+float ClassFilter::threshold(int32_t t_classId) const {
+    if (!allowed(t_classId)) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    if (t_classId >= 0 && t_classId < static_cast<int32_t>(m_classThresholds.size()) &&
+        m_classThresholds[t_classId] >= 0.0f) {
+        return m_classThresholds[t_classId];
+    }
+
+    return m_threshold;
+}
+
+void ClassFilter::setMaskBit(int32_t t_classId, bool t_keep) {
+    if (t_classId < 0) {
+        return;
+    }
+
+    const size_t word = static_cast<size_t>(t_classId) / 64;
+    if (word >= m_classMask.size()) {
+        m_classMask.resize(word + 1, m_keepOtherClasses ? ~uint64_t(0) : uint64_t(0));
+    }
+
+    const uint64_t bit = uint64_t(1) << (t_classId % 64);
+    m_classMask[word] = t_keep ? (m_classMask[word] | bit) : (m_classMask[word] & ~bit);
+}
+
+void ClassFilter::updateThresholds() {
+    // the last entry is beyond the per class thresholds and the mask, it applies to all the larger ids
+    const size_t lastClassId = std::max(m_classThresholds.size(), 64 * m_classMask.size());
+
+    m_thresholds.resize(lastClassId + 1);
+    for (size_t classId = 0; classId <= lastClassId; ++classId) {
+        m_thresholds[classId] = threshold(static_cast<int32_t>(classId));
+    }
+}
+
+
+/************************************* COMPACTION KERNELS  *************************************/
+
+// Entry of the threshold table of a class id output by the graph, the negative ids are read as 0 like the boxes
+static inline int32_t thresholdIndex(float t_class, int32_t t_lastClassId) {
+    return std::min(std::max(static_cast<int32_t>(t_class), 0), t_lastClassId);
+}
+
+static size_t compactCandidatesScalar(const float *t_scores, const float *t_classes, size_t t_first, size_t t_count,
+                                      const ClassFilter &t_filter, int32_t *t_indices, size_t t_kept) {
+    const float *thresholds = t_filter.thresholds();
+    const int32_t lastClassId = t_filter.lastClassId();
+
+    // written unconditionally, the index is only kept by moving past it
+    for (size_t i = t_first; i < t_count; ++i) {
+        t_indices[t_kept] = static_cast<int32_t>(i);
+        t_kept += t_scores[i] > thresholds[thresholdIndex(t_classes[i], lastClassId)];
+    }
+
+    return t_kept;
+}
+
+#ifdef DETECTION_KERNELS_X86
+
+// 4 scores per register, SSE2 has no gather nor 32 bits min/max so the thresholds are looked up per lane
+__attribute__((target("sse2")))
+static size_t compactCandidatesSse2(const float *t_scores, const float *t_classes, size_t t_count,
+                                    const ClassFilter &t_filter, int32_t *t_indices) {
+    const float *thresholds = t_filter.thresholds();
+    const int32_t lastClassId = t_filter.lastClassId();
+
+    size_t kept = 0;
+    size_t i = 0;
+    for (; i + 4 <= t_count; i += 4) {
+        const __m128 classThresholds = _mm_setr_ps(thresholds[thresholdIndex(t_classes[i], lastClassId)],
+                                                   thresholds[thresholdIndex(t_classes[i + 1], lastClassId)],
+                                                   thresholds[thresholdIndex(t_classes[i + 2], lastClassId)],
+                                                   thresholds[thresholdIndex(t_classes[i + 3], lastClassId)]);
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(t_scores + i),
+                                                                           classThresholds)));
+        while (mask) {
+            t_indices[kept++] = static_cast<int32_t>(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    return compactCandidatesScalar(t_scores, t_classes, i, t_count, t_filter, t_indices, kept);
+}
+
+// 8 scores per register, the threshold of each class is gathered from the table
+__attribute__((target("avx2")))
+static size_t compactCandidatesAvx2(const float *t_scores, const float *t_classes, size_t t_count,
+                                    const ClassFilter &t_filter, int32_t *t_indices) {
+    const float *thresholds = t_filter.thresholds();
+    const __m256i firstClassId = _mm256_setzero_si256();
+    const __m256i lastClassId = _mm256_set1_epi32(t_filter.lastClassId());
+
+    size_t kept = 0;
+    size_t i = 0;
+    for (; i + 8 <= t_count; i += 8) {
+        const __m256i classIds = _mm256_min_epi32(
+                _mm256_max_epi32(_mm256_cvttps_epi32(_mm256_loadu_ps(t_classes + i)), firstClassId), lastClassId);
+        const __m256 classThresholds = _mm256_i32gather_ps(thresholds, classIds, 4);
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(
+                _mm256_cmp_ps(_mm256_loadu_ps(t_scores + i), classThresholds, _CMP_GT_OQ)));
+        while (mask) {
+            t_indices[kept++] = static_cast<int32_t>(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    // the scalar tail is compiled without VEX, dirty upper halves would stall each of its instructions
+    _mm256_zeroupper();
+    return compactCandidatesScalar(t_scores, t_classes, i, t_count, t_filter, t_indices, kept);
+}
+
+#endif
+
+
+
+/************************************* OVERLAP KERNELS  *************************************/
+
+// The overlap is tested as intersection > threshold * union, without division, like detectionIoU otherwise
+
+static void suppressRowScalar(const DetectionBoxes &t_boxes, size_t t_kept, size_t t_first, float t_iouThreshold,
+                              int32_t *t_keep) {
+    const float keptX1 = t_boxes.x1[t_kept];
+    const float keptY1 = t_boxes.y1[t_kept];
+    const float keptX2 = t_boxes.x2[t_kept];
+    const float keptY2 = t_boxes.y2[t_kept];
+    const float keptArea = t_boxes.area[t_kept];
+    const int32_t keptClass = t_boxes.classId[t_kept];
+
+    for (size_t j = t_first; j < t_boxes.size(); ++j) {
+        const float width = std::max(0.0f, std::min(keptX2, t_boxes.x2[j]) - std::max(keptX1, t_boxes.x1[j]));
+        const float height = std::max(0.0f, std::min(keptY2, t_boxes.y2[j]) - std::max(keptY1, t_boxes.y1[j]));
+        const float intersection = width * height;
+        const float unionArea = keptArea + t_boxes.area[j] - intersection;
+        if (t_boxes.classId[j] == keptClass && intersection > t_iouThreshold * unionArea) {
+            t_keep[j] = 0;
+        }
+    }
+}
+
+#ifdef DETECTION_KERNELS_X86
+
+// 4 boxes per register, SSE2 is part of every x86-64 CPU
+__attribute__((target("sse2")))
+static void suppressRowSse2(const DetectionBoxes &t_boxes, size_t t_kept, size_t t_first, float t_iouThreshold,
+                            int32_t *t_keep) {
+    const __m128 keptX1 = _mm_set1_ps(t_boxes.x1[t_kept]);
+    const __m128 keptY1 = _mm_set1_ps(t_boxes.y1[t_kept]);
+    const __m128 keptX2 = _mm_set1_ps(t_boxes.x2[t_kept]);
+    const __m128 keptY2 = _mm_set1_ps(t_boxes.y2[t_kept]);
+    const __m128 keptArea = _mm_set1_ps(t_boxes.area[t_kept]);
+    const __m128i keptClass = _mm_set1_epi32(t_boxes.classId[t_kept]);
+    const __m128 threshold = _mm_set1_ps(t_iouThreshold);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t j = t_first;
+    for (; j + 4 <= t_boxes.size(); j += 4) {
+        const __m128 width = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(keptX2, _mm_loadu_ps(&t_boxes.x2[j])),
+                                                         _mm_max_ps(keptX1, _mm_loadu_ps(&t_boxes.x1[j]))));
+        const __m128 height = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(keptY2, _mm_loadu_ps(&t_boxes.y2[j])),
+                                                          _mm_max_ps(keptY1, _mm_loadu_ps(&t_boxes.y1[j]))));
+        const __m128 intersection = _mm_mul_ps(width, height);
+        const __m128 unionArea = _mm_sub_ps(_mm_add_ps(keptArea, _mm_loadu_ps(&t_boxes.area[j])), intersection);
+
+        const __m128i overlapping = _mm_castps_si128(_mm_cmpgt_ps(intersection, _mm_mul_ps(threshold, unionArea)));
+        const __m128i sameClass = _mm_cmpeq_epi32(
+                keptClass, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&t_boxes.classId[j])));
+
+        __m128i *keep = reinterpret_cast<__m128i *>(t_keep + j);
+        _mm_storeu_si128(keep, _mm_andnot_si128(_mm_and_si128(overlapping, sameClass), _mm_loadu_si128(keep)));
+    }
+
+    suppressRowScalar(t_boxes, t_kept, j, t_iouThreshold, t_keep);
+}
+
+// 8 boxes per register
+__attribute__((target("avx2")))
+static void suppressRowAvx2(const DetectionBoxes &t_boxes, size_t t_kept, size_t t_first, float t_iouThreshold,
+                            int32_t *t_keep) {
+    const __m256 keptX1 = _mm256_set1_ps(t_boxes.x1[t_kept]);
+    const __m256 keptY1 = _mm256_set1_ps(t_boxes.y1[t_kept]);
+    const __m256 keptX2 = _mm256_set1_ps(t_boxes.x2[t_kept]);
+    const __m256 keptY2 = _mm256_set1_ps(t_boxes.y2[t_kept]);
+    const __m256 keptArea = _mm256_set1_ps(t_boxes.area[t_kept]);
+    const __m256i keptClass = _mm256_set1_epi32(t_boxes.classId[t_kept]);
+    const __m256 threshold = _mm256_set1_ps(t_iouThreshold);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t j = t_first;
+    for (; j + 8 <= t_boxes.size(); j += 8) {
+        const __m256 width = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(keptX2, _mm256_loadu_ps(&t_boxes.x2[j])),
+                                                               _mm256_max_ps(keptX1, _mm256_loadu_ps(&t_boxes.x1[j]))));
+        const __m256 height = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(keptY2, _mm256_loadu_ps(&t_boxes.y2[j])),
+                                                                _mm256_max_ps(keptY1, _mm256_loadu_ps(&t_boxes.y1[j]))));
+        const __m256 intersection = _mm256_mul_ps(width, height);
+        const __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(keptArea, _mm256_loadu_ps(&t_boxes.area[j])),
+                                               intersection);
+
+        const __m256i overlapping = _mm256_castps_si256(
+                _mm256_cmp_ps(intersection, _mm256_mul_ps(threshold, unionArea), _CMP_GT_OQ));
+        const __m256i sameClass = _mm256_cmpeq_epi32(
+                keptClass, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&t_boxes.classId[j])));
+
+        __m256i *keep = reinterpret_cast<__m256i *>(t_keep + j);
+        _mm256_storeu_si256(keep, _mm256_andnot_si256(_mm256_and_si256(overlapping, sameClass),
+                                                      _mm256_loadu_si256(keep)));
+    }
+
+    _mm256_zeroupper();
+    suppressRowScalar(t_boxes, t_kept, j, t_iouThreshold, t_keep);
+}
+
+#endif
+
+
+// Overlap of a candidate, ymin xmin ymax xmax, with any of the kept boxes of its class
+
+static bool overlapsKeptScalar(const DetectionBoxes &t_kept, size_t t_first, const float *t_box, int32_t t_classId,
+                               float t_iouThreshold) {
+    const float area = (t_box[3] - t_box[1]) * (t_box[2] - t_box[0]);
+
+    for (size_t j = t_first; j < t_kept.size(); ++j) {
+        const float width = std::max(0.0f, std::min(t_box[3], t_kept.x2[j]) - std::max(t_box[1], t_kept.x1[j]));
+        const float height = std::max(0.0f, std::min(t_box[2], t_kept.y2[j]) - std::max(t_box[0], t_kept.y1[j]));
+        const float intersection = width * height;
+        if (t_kept.classId[j] == t_classId && intersection > t_iouThreshold * (area + t_kept.area[j] - intersection)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef DETECTION_KERNELS_X86
+
+__attribute__((target("sse2")))
+static bool overlapsKeptSse2(const DetectionBoxes &t_kept, size_t t_first, const float *t_box, int32_t t_classId,
+                             float t_iouThreshold) {
+    const __m128 boxX1 = _mm_set1_ps(t_box[1]);
+    const __m128 boxY1 = _mm_set1_ps(t_box[0]);
+    const __m128 boxX2 = _mm_set1_ps(t_box[3]);
+    const __m128 boxY2 = _mm_set1_ps(t_box[2]);
+    const __m128 boxArea = _mm_set1_ps((t_box[3] - t_box[1]) * (t_box[2] - t_box[0]));
+    const __m128i boxClass = _mm_set1_epi32(t_classId);
+    const __m128 threshold = _mm_set1_ps(t_iouThreshold);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t j = t_first;
+    for (; j + 4 <= t_kept.size(); j += 4) {
+        const __m128 width = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(boxX2, _mm_loadu_ps(&t_kept.x2[j])),
+                                                         _mm_max_ps(boxX1, _mm_loadu_ps(&t_kept.x1[j]))));
+        const __m128 height = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(boxY2, _mm_loadu_ps(&t_kept.y2[j])),
+                                                          _mm_max_ps(boxY1, _mm_loadu_ps(&t_kept.y1[j]))));
+        const __m128 intersection = _mm_mul_ps(width, height);
+        const __m128 unionArea = _mm_sub_ps(_mm_add_ps(boxArea, _mm_loadu_ps(&t_kept.area[j])), intersection);
+
+        const __m128i overlapping = _mm_castps_si128(_mm_cmpgt_ps(intersection, _mm_mul_ps(threshold, unionArea)));
+        const __m128i sameClass = _mm_cmpeq_epi32(
+                boxClass, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&t_kept.classId[j])));
+        if (_mm_movemask_epi8(_mm_and_si128(overlapping, sameClass))) {
+            return true;
+        }
+    }
+
+    return overlapsKeptScalar(t_kept, j, t_box, t_classId, t_iouThreshold);
+}
+
+__attribute__((target("avx2")))
+static bool overlapsKeptAvx2(const DetectionBoxes &t_kept, size_t t_first, const float *t_box, int32_t t_classId,
+                             float t_iouThreshold) {
+    const __m256 boxX1 = _mm256_set1_ps(t_box[1]);
+    const __m256 boxY1 = _mm256_set1_ps(t_box[0]);
+    const __m256 boxX2 = _mm256_set1_ps(t_box[3]);
+    const __m256 boxY2 = _mm256_set1_ps(t_box[2]);
+    const __m256 boxArea = _mm256_set1_ps((t_box[3] - t_box[1]) * (t_box[2] - t_box[0]));
+    const __m256i boxClass = _mm256_set1_epi32(t_classId);
+    const __m256 threshold = _mm256_set1_ps(t_iouThreshold);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t j = t_first;
+    for (; j + 8 <= t_kept.size(); j += 8) {
+        const __m256 width = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(boxX2, _mm256_loadu_ps(&t_kept.x2[j])),
+                                                               _mm256_max_ps(boxX1, _mm256_loadu_ps(&t_kept.x1[j]))));
+        const __m256 height = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(boxY2, _mm256_loadu_ps(&t_kept.y2[j])),
+                                                                _mm256_max_ps(boxY1, _mm256_loadu_ps(&t_kept.y1[j]))));
+        const __m256 intersection = _mm256_mul_ps(width, height);
+        const __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(boxArea, _mm256_loadu_ps(&t_kept.area[j])),
+                                               intersection);
+
+        const __m256i overlapping = _mm256_castps_si256(
+                _mm256_cmp_ps(intersection, _mm256_mul_ps(threshold, unionArea), _CMP_GT_OQ));
+        const __m256i sameClass = _mm256_cmpeq_epi32(
+                boxClass, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&t_kept.classId[j])));
+        if (_mm256_movemask_epi8(_mm256_and_si256(overlapping, sameClass))) {
+            return true;
+        }
+    }
+
+    _mm256_zeroupper();
+    return overlapsKeptScalar(t_kept, j, t_box, t_classId, t_iouThreshold);
+}
+
+#endif
+
+
+/************************************* SUPPRESSION  *************************************/
+
+size_t suppressOverlaps(KernelIsa t_isa, const DetectionBoxes &t_boxes, float t_iouThreshold, size_t t_maxKept,
+                        std::vector<int32_t> *t_keep) {
+    void (*suppressRow)(const DetectionBoxes &, size_t, size_t, float, int32_t *) = suppressRowScalar;
+
+#ifdef DETECTION_KERNELS_X86
+    if (t_isa == KernelIsa::AVX2) {
+        suppressRow = suppressRowAvx2;
+    }
+    else if (t_isa == KernelIsa::SSSE3) {
+        suppressRow = suppressRowSse2;
+    }
+#endif
+
+    t_keep->assign(t_boxes.size(), -1);
+    int32_t *keep = t_keep->data();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < t_boxes.size(); ++i) {
+        if (keep[i] == 0) {
+            continue;
+        }
+
+        // the boxes after the last kept one are dropped without being compared
+        if (kept == t_maxKept) {
+            std::fill(keep + i, keep + t_boxes.size(), 0);
+            break;
+        }
+
+        ++kept;
+        suppressRow(t_boxes, i, i + 1, t_iouThreshold, keep);
+    }
+
+    return kept;
+}
+
+size_t suppressOverlaps(const DetectionBoxes &t_boxes, float t_iouThreshold, size_t t_maxKept,
+                        std::vector<int32_t> *t_keep) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    return suppressOverlaps(cpuIsa, t_boxes, t_iouThreshold, t_maxKept, t_keep);
+}
+
+void nonMaxSuppression(std::vector<Detection> *t_candidates, float t_iouThreshold, size_t t_maxDetections,
+                       DetectionBuffer *t_objectsDetected) {
+    // scratch storage reused by the calls of a thread
+    static thread_local DetectionBoxes boxes;
+    static thread_local std::vector<int32_t> keep;
+    static thread_local std::vector<int32_t> instanceCounts;
+
+    std::stable_sort(t_candidates->begin(), t_candidates->end(), [](const Detection &t_a, const Detection &t_b) {
+        return t_a.score > t_b.score;
+    });
+
+    boxes.assign(t_candidates->data(), t_candidates->size());
+    suppressOverlaps(boxes, t_iouThreshold, t_maxDetections, &keep);
+
+    t_objectsDetected->reset(t_maxDetections);
+    for (size_t i = 0; i < t_candidates->size(); ++i) {
+        if (keep[i] == 0) {
+            continue;
+        }
+
+        Detection detection = (*t_candidates)[i];
+        if (detection.classId >= static_cast<int32_t>(instanceCounts.size())) {
+            instanceCounts.resize(detection.classId + 1, 0);
+        }
+        detection.instance = instanceCounts[detection.classId]++;
+        t_objectsDetected->push(detection);
+    }
+
+    for (const Detection &detection : *t_objectsDetected) {
+        instanceCounts[detection.classId] = 0;
+    }
+}
+
+
+/************************************* POSTPROCESSING  *************************************/
+
+size_t compactCandidates(KernelIsa t_isa, const float *t_scores, const float *t_classes, size_t t_count,
+                         const ClassFilter &t_filter, int32_t *t_indices) {
+#ifdef DETECTION_KERNELS_X86
+    if (t_isa == KernelIsa::AVX2) {
+        return compactCandidatesAvx2(t_scores, t_classes, t_count, t_filter, t_indices);
+    }
+    if (t_isa == KernelIsa::SSSE3) {
+        return compactCandidatesSse2(t_scores, t_classes, t_count, t_filter, t_indices);
+    }
+#endif
+
+    return compactCandidatesScalar(t_scores, t_classes, 0, t_count, t_filter, t_indices, 0);
+}
+
+size_t compactCandidates(const float *t_scores, const float *t_classes, size_t t_count, const ClassFilter &t_filter,
+                         int32_t *t_indices) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    return compactCandidates(cpuIsa, t_scores, t_classes, t_count, t_filter, t_indices);
+}
+
+void selectDetections(KernelIsa t_isa, const float *t_boxes, const float *t_scores, const float *t_classes,
+                      int32_t *t_candidates, size_t t_count, float t_iouThreshold, size_t t_topK,
+                      std::vector<int32_t> *t_selected) {
+    bool (*overlapsKept)(const DetectionBoxes &, size_t, const float *, int32_t, float) = overlapsKeptScalar;
+
+#ifdef DETECTION_KERNELS_X86
+    if (t_isa == KernelIsa::AVX2) {
+        overlapsKept = overlapsKeptAvx2;
+    }
+    else if (t_isa == KernelIsa::SSSE3) {
+        overlapsKept = overlapsKeptSse2;
+    }
+#endif
+
+    // boxes kept so far, reused by the calls of a thread
+    static thread_local DetectionBoxes kept;
+    kept.clear();
+    t_selected->clear();
+
+    // by decreasing score, the first output of the graph first on a tie
+    const auto better = [t_scores](int32_t t_a, int32_t t_b) {
+        return t_scores[t_a] > t_scores[t_b] || (t_scores[t_a] == t_scores[t_b] && t_a < t_b);
+    };
+    const auto worse = [&better](int32_t t_a, int32_t t_b) {
+        return better(t_b, t_a);
+    };
+
+    // heapified in linear time, only the candidates looked at are popped
+    const bool sorted = std::is_sorted(t_candidates, t_candidates + t_count, better);
+    if (!sorted) {
+        std::make_heap(t_candidates, t_candidates + t_count, worse);
+    }
+
+    size_t heapSize = t_count;
+    for (size_t n = 0; n < t_count && t_selected->size() < t_topK; ++n) {
+        int32_t index = t_candidates[n];
+        if (!sorted) {
+            std::pop_heap(t_candidates, t_candidates + heapSize, worse);
+            index = t_candidates[--heapSize];
+        }
+
+        const float *box = t_boxes + 4 * static_cast<size_t>(index);
+        const int32_t classId = std::max(0, static_cast<int32_t>(t_classes[index]));
+        if (t_iouThreshold > 0.0f && overlapsKept(kept, 0, box, classId, t_iouThreshold)) {
+            continue;
+        }
+
+        kept.push(box[1], box[0], box[3], box[2], classId);
+        t_selected->push_back(index);
+    }
+}
+
+void selectDetections(const float *t_boxes, const float *t_scores, const float *t_classes, int32_t *t_candidates,
+                      size_t t_count, float t_iouThreshold, size_t t_topK, std::vector<int32_t> *t_selected) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    selectDetections(cpuIsa, t_boxes, t_scores, t_classes, t_candidates, t_count, t_iouThreshold, t_topK,
+                     t_selected);
+}
@@ -0,0 +1,75 @@
+#include <cstring>
+
+#include "../include/iCub/DetectionOutput.h"
+
+
+LabelFormat parseLabelFormat(const std::string &t_format) {
+    if (t_format == "list") {
+        return LabelFormat::List;
+    }
+    if (t_format == "blob") {
+        return LabelFormat::Blob;
+    }
+
+    return LabelFormat::String;
+}
+
+const char *labelFormatName(LabelFormat t_format) {
+    switch (t_format) {
+        case LabelFormat::List:
+            return "list";
+        case LabelFormat::Blob:
+            return "blob";
+        default:
+            return "string";
+    }
+}
+
+ModelOutput parseModelOutput(const std::string &t_output) {
+    if (t_output == "merged") {
+        return ModelOutput::Merged;
+    }
+
+    return ModelOutput::Separate;
+}
+
+void writeDetections(LabelFormat t_format, const DetectionBuffer &t_objectsDetected,
+                     const LabelTable &t_labels, std::vector<char> &t_blobBuffer,
+                     yarp::os::Bottle &t_output) {
+    switch (t_format) {
+        case LabelFormat::List:
+            for (const Detection &detection : t_objectsDetected) {
+                yarp::os::Bottle &item = t_output.addList();
+                item.addInt(detection.classId);
+                item.addString(t_labels.name(detection.classId));
+                item.addDouble(detection.score);
+                for (const int32_t coordinate : detection.box) {
+                    item.addInt(coordinate);
+                }
+            }
+            break;
+
+        case LabelFormat::Blob: {
+            const DetectionBlobHeader header = {DetectionBlobVersion,
+                                                static_cast<uint32_t>(t_objectsDetected.size())};
+            t_blobBuffer.resize(sizeof(header) + header.count * sizeof(DetectionRecord));
+            memcpy(t_blobBuffer.data(), &header, sizeof(header));
+
+            char *recordData = t_blobBuffer.data() + sizeof(header);
+            for (const Detection &detection : t_objectsDetected) {
+                const DetectionRecord record = {detection.classId, detection.score,
+                                                {detection.box[0], detection.box[1], detection.box[2],
+                                                 detection.box[3]}};
+                memcpy(recordData, &record, sizeof(record));
+                recordData += sizeof(record);
+            }
+
+            t_output.addBlob(t_blobBuffer.data(), t_blobBuffer.size());
+            break;
+        }
+
+        default:
+            t_output.addString(tensorflowObjectDetection::detectionsToString(t_objectsDetected, t_labels));
+            break;
+    }
+}
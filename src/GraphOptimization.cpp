@@ -0,0 +1,128 @@
+#include "iCub/GraphOptimization.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <tensorflow/core/lib/hash/hash.h>
+#include <tensorflow/core/platform/env.h>
+#include <tensorflow/tools/graph_transforms/transform_graph.h>
+
+
+const char DefaultGraphTransforms[] =
+        "strip_unused_nodes "
+        "fold_constants(ignore_errors=true) "
+        "fold_batch_norms "
+        "fold_old_batch_norms "
+        "fuse_pad_and_conv "
+        "merge_duplicate_nodes "
+        "sort_by_execution_order";
+
+const char QuantizeGraphTransforms[] =
+        "add_default_attributes "
+        "strip_unused_nodes "
+        "remove_nodes(op=CheckNumerics) "
+        "fold_constants(ignore_errors=true) "
+        "fold_batch_norms "
+        "fold_old_batch_norms "
+        "quantize_weights "
+        "quantize_nodes "
+        "strip_unused_nodes "
+        "sort_by_execution_order";
+
+
+// Path without its extension, and the extension with its dot
+static void splitExtension(const std::string &t_path, std::string *t_stem, std::string *t_extension) {
+    // the extension of the file is split, not the dots of the directories
+    const size_t slash = t_path.rfind('/');
+    const size_t dot = t_path.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        *t_stem = t_path;
+        t_extension->clear();
+        return;
+    }
+    *t_stem = t_path.substr(0, dot);
+    *t_extension = t_path.substr(dot);
+}
+
+
+Precision parsePrecision(const std::string &t_precision) {
+    if (t_precision == "int8") {
+        return Precision::Int8;
+    }
+
+    return Precision::Float;
+}
+
+
+std::string precisionGraphPath(const std::string &t_graphPath, Precision t_precision) {
+    if (t_precision == Precision::Float) {
+        return t_graphPath;
+    }
+
+    std::string stem;
+    std::string extension;
+    splitExtension(t_graphPath, &stem, &extension);
+    return stem + ".int8" + extension;
+}
+
+
+std::string graphNodeName(const std::string &t_tensorName) {
+    const size_t separator = t_tensorName.rfind(':');
+    if (separator == std::string::npos) {
+        return t_tensorName;
+    }
+    return t_tensorName.substr(0, separator);
+}
+
+
+uint64_t optimizedGraphKey(uint64_t t_graphHash, const std::string &t_transforms) {
+    return tensorflow::Hash64(t_transforms.data(), t_transforms.size(), t_graphHash);
+}
+
+
+std::string optimizedGraphPath(const std::string &t_graphPath, uint64_t t_key) {
+    char suffix[40];
+    snprintf(suffix, sizeof(suffix), ".optimized-%016llx.pb", static_cast<unsigned long long>(t_key));
+
+    std::string stem;
+    std::string extension;
+    splitExtension(t_graphPath, &stem, &extension);
+    return stem + suffix;
+}
+
+
+tensorflow::Status optimizeGraph(const tensorflow::GraphDef &t_graphDef, const std::string &t_input,
+                                 const std::vector<std::string> &t_outputs, const std::string &t_transforms,
+                                 tensorflow::GraphDef *t_optimized) {
+    tensorflow::graph_transforms::TransformParameters transforms;
+    TF_RETURN_IF_ERROR(tensorflow::graph_transforms::ParseTransformParameters(t_transforms, &transforms));
+
+    std::vector<std::string> outputNodes;
+    for (const std::string &output : t_outputs) {
+        outputNodes.push_back(graphNodeName(output));
+    }
+
+    *t_optimized = t_graphDef;
+    return tensorflow::graph_transforms::TransformGraph({graphNodeName(t_input)}, outputNodes, transforms,
+                                                        t_optimized);
+}
+
+
+tensorflow::Status writeGraphAtomically(const std::string &t_path, const tensorflow::GraphDef &t_graphDef) {
+    tensorflow::Env *env = tensorflow::Env::Default();
+    // unique per writer : the processes or threads optimizing the same graph do not write the same file
+    static std::atomic<unsigned> writeCount(0);
+    const std::string temporaryPath = t_path + ".tmp." + std::to_string(getpid()) + "." +
+                                      std::to_string(writeCount++);
+
+    tensorflow::Status write_status = tensorflow::WriteBinaryProto(env, temporaryPath, t_graphDef);
+    if (write_status.ok()) {
+        write_status = env->RenameFile(temporaryPath, t_path);
+    }
+    if (!write_status.ok()) {
+        env->DeleteFile(temporaryPath);
+    }
+    return write_status;
+}
@@ -0,0 +1,452 @@
+#include "iCub/ImageKernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+
+/************************************* ROW KERNELS  *************************************/
+
+static void swapRedBlueRowScalar(const uint8_t *t_src, uint8_t *t_dst, int t_width) {
+    for (int x = 0; x < t_width; ++x) {
+        t_dst[0] = t_src[2];
+        t_dst[1] = t_src[1];
+        t_dst[2] = t_src[0];
+        t_src += 3;
+        t_dst += 3;
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+
+// 5 pixels per 16 bytes register, the 16th byte is rewritten by the next iteration
+__attribute__((target("ssse3")))
+static void swapRedBlueRowSsse3(const uint8_t *t_src, uint8_t *t_dst, int t_width) {
+    const __m128i swapMask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1);
+
+    const size_t rowBytes = 3 * static_cast<size_t>(t_width);
+    size_t x = 0;
+    for (; x + 16 <= rowBytes; x += 15) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t_src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(t_dst + x), _mm_shuffle_epi8(pixels, swapMask));
+    }
+
+    swapRedBlueRowScalar(t_src + x, t_dst + x, static_cast<int>((rowBytes - x) / 3));
+}
+
+// 8 pixels per 32 bytes register : pixels 0-3 are shuffled in the low lane and pixels 4-7 in the high lane,
+// then packed back together, the last 8 bytes are rewritten by the next iteration
+__attribute__((target("avx2")))
+static void swapRedBlueRowAvx2(const uint8_t *t_src, uint8_t *t_dst, int t_width) {
+    const __m256i spreadLanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i swapMask = _mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -1, -1, -1, -1,
+                                              -1, -1, -1, -1, 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9);
+    const __m256i packLanes = _mm256_setr_epi32(0, 1, 2, 5, 6, 7, 7, 7);
+
+    const size_t rowBytes = 3 * static_cast<size_t>(t_width);
+    size_t x = 0;
+    for (; x + 32 <= rowBytes; x += 24) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t_src + x));
+        pixels = _mm256_permutevar8x32_epi32(pixels, spreadLanes);
+        pixels = _mm256_shuffle_epi8(pixels, swapMask);
+        pixels = _mm256_permutevar8x32_epi32(pixels, packLanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(t_dst + x), pixels);
+    }
+
+    swapRedBlueRowScalar(t_src + x, t_dst + x, static_cast<int>((rowBytes - x) / 3));
+}
+
+#endif
+
+
+// Bilinear weights are 8 bits fixed point : a*(256-w) + b*w fits in 16 bits
+static const int kWeightBits = 8;
+static const int kWeightOne = 1 << kWeightBits;
+
+// Blend two source rows, the result is the vertically interpolated row
+static void blendRowsScalar(const uint8_t *t_row0, const uint8_t *t_row1, int t_weight1, uint8_t *t_dst,
+                            size_t t_bytes) {
+    const int weight0 = kWeightOne - t_weight1;
+    for (size_t i = 0; i < t_bytes; ++i) {
+        t_dst[i] = static_cast<uint8_t>((t_row0[i] * weight0 + t_row1[i] * t_weight1 + kWeightOne / 2) >> kWeightBits);
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+
+// SSE2 is part of every x86-64 CPU, no runtime dispatch needed
+__attribute__((target("sse2")))
+static void blendRowsSse2(const uint8_t *t_row0, const uint8_t *t_row1, int t_weight1, uint8_t *t_dst,
+                          size_t t_bytes) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight0 = _mm_set1_epi16(static_cast<short>(kWeightOne - t_weight1));
+    const __m128i weight1 = _mm_set1_epi16(static_cast<short>(t_weight1));
+    const __m128i rounding = _mm_set1_epi16(kWeightOne / 2);
+
+    size_t i = 0;
+    for (; i + 16 <= t_bytes; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t_row0 + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t_row1 + i));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weight0),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weight1));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weight0),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weight1));
+        low = _mm_srli_epi16(_mm_add_epi16(low, rounding), kWeightBits);
+        high = _mm_srli_epi16(_mm_add_epi16(high, rounding), kWeightBits);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(t_dst + i), _mm_packus_epi16(low, high));
+    }
+
+    blendRowsScalar(t_row0 + i, t_row1 + i, t_weight1, t_dst + i, t_bytes - i);
+}
+
+#endif
+
+// Sums of one row of blocks : 8 rows of the images, one sum per 8 columns
+static void blockRowDifferencesScalar(const uint8_t *t_first, const uint8_t *t_second, size_t t_stride,
+                                      int t_firstColumn, int t_width, uint32_t *t_blockSums) {
+    for (int x = t_firstColumn; x < t_width; x += kDifferenceBlockSize) {
+        uint32_t sum = 0;
+        for (int r = 0; r < kDifferenceBlockSize; ++r) {
+            const uint8_t *first = t_first + r * t_stride + x;
+            const uint8_t *second = t_second + r * t_stride + x;
+            for (int i = 0; i < kDifferenceBlockSize; ++i) {
+                sum += static_cast<uint32_t>(std::abs(first[i] - second[i]));
+            }
+        }
+        t_blockSums[x / kDifferenceBlockSize] = sum;
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+
+// psadbw sums the absolute differences of each half of the register : two blocks per 16 bytes
+__attribute__((target("sse2")))
+static void blockRowDifferencesSse2(const uint8_t *t_first, const uint8_t *t_second, size_t t_stride,
+                                    int t_firstColumn, int t_width, uint32_t *t_blockSums) {
+    int x = t_firstColumn;
+    for (; x + 16 <= t_width; x += 16) {
+        __m128i sums = _mm_setzero_si128();
+        for (int r = 0; r < kDifferenceBlockSize; ++r) {
+            const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t_first + r * t_stride + x));
+            const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t_second + r * t_stride + x));
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(first, second));
+        }
+        t_blockSums[x / kDifferenceBlockSize] = static_cast<uint32_t>(_mm_cvtsi128_si32(sums));
+        t_blockSums[x / kDifferenceBlockSize + 1] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+
+    blockRowDifferencesScalar(t_first, t_second, t_stride, x, t_width, t_blockSums);
+}
+
+// Four blocks per 32 bytes
+__attribute__((target("avx2")))
+static void blockRowDifferencesAvx2(const uint8_t *t_first, const uint8_t *t_second, size_t t_stride,
+                                    int t_firstColumn, int t_width, uint32_t *t_blockSums) {
+    int x = t_firstColumn;
+    for (; x + 32 <= t_width; x += 32) {
+        __m256i sums = _mm256_setzero_si256();
+        for (int r = 0; r < kDifferenceBlockSize; ++r) {
+            const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t_first + r * t_stride + x));
+            const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t_second + r * t_stride + x));
+            sums = _mm256_add_epi64(sums, _mm256_sad_epu8(first, second));
+        }
+
+        // the four 64 bits sums fit in 32 bits, gathered in the low half
+        const __m256i packed = _mm256_permutevar8x32_epi32(sums, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(t_blockSums + x / kDifferenceBlockSize),
+                         _mm256_castsi256_si128(packed));
+    }
+
+    // the remaining columns are not VEX encoded, avoid the transition penalty
+    _mm256_zeroupper();
+    blockRowDifferencesSse2(t_first, t_second, t_stride, x, t_width, t_blockSums);
+}
+
+#endif
+
+static void blendRows(const uint8_t *t_row0, const uint8_t *t_row1, int t_weight1, uint8_t *t_dst,
+                      size_t t_bytes) {
+#ifdef IMAGE_KERNELS_X86
+    blendRowsSse2(t_row0, t_row1, t_weight1, t_dst, t_bytes);
+#else
+    blendRowsScalar(t_row0, t_row1, t_weight1, t_dst, t_bytes);
+#endif
+}
+
+// Horizontal pass of a blended row fused with the channel swap, for the target columns [t_first, t_last)
+static void resizeRowSwapScalar(const uint8_t *t_row, const int *t_firstColumn, const int *t_columnWeight,
+                                int t_first, int t_last, uint8_t *t_dst) {
+    for (int x = t_first; x < t_last; ++x) {
+        const uint8_t *left = t_row + 3 * t_firstColumn[x];
+        const int weight1 = t_columnWeight[x];
+        const int weight0 = kWeightOne - weight1;
+        const uint8_t *right = weight1 != 0 ? left + 3 : left;
+
+        uint8_t *dstPixel = t_dst + 3 * x;
+        dstPixel[0] = static_cast<uint8_t>((left[2] * weight0 + right[2] * weight1 + kWeightOne / 2) >> kWeightBits);
+        dstPixel[1] = static_cast<uint8_t>((left[1] * weight0 + right[1] * weight1 + kWeightOne / 2) >> kWeightBits);
+        dstPixel[2] = static_cast<uint8_t>((left[0] * weight0 + right[0] * weight1 + kWeightOne / 2) >> kWeightBits);
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+
+// 4 target pixels per iteration : the 8 bytes holding the left and right source pixels of each are gathered two
+// by two, swizzled into 16 bits lanes and blended as blendRowsSse2, the 12 result bytes packed together.
+// The gather reads 2 bytes past the right pixel, the columns too close to the end of the row are left to the
+// scalar pass.
+__attribute__((target("ssse3")))
+static void resizeRowSwapSsse3(const uint8_t *t_row, size_t t_rowBytes, const int *t_firstColumn,
+                               const int *t_columnWeight, int t_width, uint8_t *t_dst) {
+    const __m128i leftMask = _mm_setr_epi8(2, -1, 1, -1, 0, -1, 10, -1, 9, -1, 8, -1, -1, -1, -1, -1);
+    const __m128i rightMask = _mm_setr_epi8(5, -1, 4, -1, 3, -1, 13, -1, 12, -1, 11, -1, -1, -1, -1, -1);
+    const __m128i packMask = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+    const __m128i one = _mm_set1_epi16(kWeightOne);
+    const __m128i rounding = _mm_set1_epi16(kWeightOne / 2);
+
+    int x = 0;
+    // the source columns grow with x, checking the last pixel of the group bounds the whole group
+    for (; x + 4 <= t_width && 3 * static_cast<size_t>(t_firstColumn[x + 3]) + 8 <= t_rowBytes; x += 4) {
+        __m128i blended[2];
+        for (int half = 0; half < 2; ++half) {
+            const int x0 = x + 2 * half;
+            const __m128i pixels = _mm_unpacklo_epi64(
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t_row + 3 * t_firstColumn[x0])),
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t_row + 3 * t_firstColumn[x0 + 1])));
+
+            const short weight0 = static_cast<short>(t_columnWeight[x0]);
+            const short weight1 = static_cast<short>(t_columnWeight[x0 + 1]);
+            const __m128i rightWeight = _mm_setr_epi16(weight0, weight0, weight0, weight1, weight1, weight1, 0, 0);
+            const __m128i leftWeight = _mm_sub_epi16(one, rightWeight);
+
+            const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(pixels, leftMask), leftWeight),
+                                              _mm_mullo_epi16(_mm_shuffle_epi8(pixels, rightMask), rightWeight));
+            blended[half] = _mm_srli_epi16(_mm_add_epi16(sum, rounding), kWeightBits);
+        }
+
+        const __m128i packed = _mm_shuffle_epi8(_mm_packus_epi16(blended[0], blended[1]), packMask);
+        uint8_t *dstPixel = t_dst + 3 * x;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dstPixel), packed);
+        const int last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(dstPixel + 8, &last, 4);
+    }
+
+    resizeRowSwapScalar(t_row, t_firstColumn, t_columnWeight, x, t_width, t_dst);
+}
+
+#endif
+
+// Source sample and weight of the next sample for each target coordinate, pixel centres aligned
+static void computeBilinearTaps(int t_sourceSize, int t_targetSize, std::vector<int> *t_first,
+                                std::vector<int> *t_weight) {
+    t_first->resize(t_targetSize);
+    t_weight->resize(t_targetSize);
+
+    const double scale = static_cast<double>(t_sourceSize) / t_targetSize;
+    for (int i = 0; i < t_targetSize; ++i) {
+        double position = (i + 0.5) * scale - 0.5;
+        position = std::max(0.0, std::min(position, static_cast<double>(t_sourceSize - 1)));
+
+        const int first = std::min(static_cast<int>(position), t_sourceSize - 1);
+        (*t_first)[i] = first;
+        (*t_weight)[i] = first + 1 < t_sourceSize ? static_cast<int>((position - first) * kWeightOne + 0.5) : 0;
+    }
+}
+
+
+/************************************* RESIZE  *************************************/
+
+ResizeGeometry computeResizeGeometry(int t_sourceWidth, int t_sourceHeight, int t_targetWidth, int t_targetHeight,
+                                     bool t_letterbox) {
+    ResizeGeometry geometry = {t_sourceWidth, t_sourceHeight, t_targetWidth, t_targetHeight,
+                               t_targetWidth, t_targetHeight, 0, 0};
+
+    if (t_letterbox && t_sourceWidth > 0 && t_sourceHeight > 0) {
+        const double scale = std::min(static_cast<double>(t_targetWidth) / t_sourceWidth,
+                                      static_cast<double>(t_targetHeight) / t_sourceHeight);
+        geometry.contentWidth = std::max(1, std::min(t_targetWidth, static_cast<int>(t_sourceWidth * scale + 0.5)));
+        geometry.contentHeight = std::max(1, std::min(t_targetHeight, static_cast<int>(t_sourceHeight * scale + 0.5)));
+        geometry.offsetX = (t_targetWidth - geometry.contentWidth) / 2;
+        geometry.offsetY = (t_targetHeight - geometry.contentHeight) / 2;
+    }
+
+    return geometry;
+}
+
+ResizePlan buildResizePlan(const ResizeGeometry &t_geometry) {
+    ResizePlan plan;
+    plan.geometry = t_geometry;
+    computeBilinearTaps(t_geometry.sourceWidth, t_geometry.contentWidth, &plan.firstColumn, &plan.columnWeight);
+    computeBilinearTaps(t_geometry.sourceHeight, t_geometry.contentHeight, &plan.firstRow, &plan.rowWeight);
+
+    return plan;
+}
+
+void resizeSwapRedBlue(KernelIsa t_isa, const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst,
+                       size_t t_dstStride, const ResizePlan &t_plan, uint8_t t_fill) {
+    const ResizeGeometry &g = t_plan.geometry;
+
+    if (g.contentWidth == g.sourceWidth && g.contentHeight == g.sourceHeight &&
+        g.contentWidth == g.targetWidth && g.contentHeight == g.targetHeight) {
+        swapRedBlueCopy(t_isa, t_src, t_srcStride, t_dst, t_dstStride, g.sourceWidth, g.sourceHeight);
+        return;
+    }
+
+    const std::vector<int> &firstColumn = t_plan.firstColumn;
+    const std::vector<int> &columnWeight = t_plan.columnWeight;
+    const std::vector<int> &firstRow = t_plan.firstRow;
+    const std::vector<int> &rowWeight = t_plan.rowWeight;
+
+    const size_t sourceRowBytes = 3 * static_cast<size_t>(g.sourceWidth);
+    const size_t targetRowBytes = 3 * static_cast<size_t>(g.targetWidth);
+
+    // scratch row reused by the calls of a thread, allocated only when the source grows
+    static thread_local std::vector<uint8_t> blendedRow;
+    if (blendedRow.size() < sourceRowBytes) {
+        blendedRow.resize(sourceRowBytes);
+    }
+
+    for (int y = 0; y < g.targetHeight; ++y) {
+        uint8_t *dstRow = t_dst + y * t_dstStride;
+
+        const int contentY = y - g.offsetY;
+        if (contentY < 0 || contentY >= g.contentHeight) {
+            memset(dstRow, t_fill, targetRowBytes);
+            continue;
+        }
+
+        // vertical pass : interpolate the two source rows once for the whole target row
+        const uint8_t *row0 = t_src + firstRow[contentY] * t_srcStride;
+        const uint8_t *row = row0;
+        if (rowWeight[contentY] != 0) {
+            blendRows(row0, row0 + t_srcStride, rowWeight[contentY], blendedRow.data(), sourceRowBytes);
+            row = blendedRow.data();
+        }
+
+        // horizontal pass fused with the channel swap
+        memset(dstRow, t_fill, 3 * static_cast<size_t>(g.offsetX));
+        uint8_t *dstPixel = dstRow + 3 * g.offsetX;
+#ifdef IMAGE_KERNELS_X86
+        if (t_isa != KernelIsa::Scalar) {
+            resizeRowSwapSsse3(row, sourceRowBytes, firstColumn.data(), columnWeight.data(), g.contentWidth,
+                               dstPixel);
+        }
+        else
+#endif
+        {
+            resizeRowSwapScalar(row, firstColumn.data(), columnWeight.data(), 0, g.contentWidth, dstPixel);
+        }
+        dstPixel += 3 * static_cast<size_t>(g.contentWidth);
+        memset(dstPixel, t_fill, 3 * static_cast<size_t>(g.targetWidth - g.offsetX - g.contentWidth));
+    }
+}
+
+void resizeSwapRedBlue(const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst, size_t t_dstStride,
+                       const ResizePlan &t_plan, uint8_t t_fill) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    resizeSwapRedBlue(cpuIsa, t_src, t_srcStride, t_dst, t_dstStride, t_plan, t_fill);
+}
+
+
+/************************************* THUMBNAILS  *************************************/
+
+void sampleGreyThumbnail(const uint8_t *t_src, size_t t_srcStride, int t_width, int t_height, uint8_t *t_thumbnail,
+                         int t_thumbnailWidth, int t_thumbnailHeight) {
+    for (int i = 0; i < t_thumbnailHeight; ++i) {
+        const int y = (2 * i + 1) * t_height / (2 * t_thumbnailHeight);
+        const uint8_t *row = t_src + y * t_srcStride;
+        for (int j = 0; j < t_thumbnailWidth; ++j) {
+            const uint8_t *pixel = row + 3 * ((2 * j + 1) * t_width / (2 * t_thumbnailWidth));
+            t_thumbnail[i * t_thumbnailWidth + j] = static_cast<uint8_t>((pixel[0] + 2 * pixel[1] + pixel[2]) >> 2);
+        }
+    }
+}
+
+
+/************************************* DISPATCH  *************************************/
+
+KernelIsa detectKernelIsa() {
+#ifdef IMAGE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelIsa::AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return KernelIsa::SSSE3;
+    }
+#endif
+    return KernelIsa::Scalar;
+}
+
+const char *kernelIsaName(KernelIsa t_isa) {
+    switch (t_isa) {
+        case KernelIsa::AVX2:
+            return "avx2";
+        case KernelIsa::SSSE3:
+            return "ssse3";
+        default:
+            return "scalar";
+    }
+}
+
+void swapRedBlueCopy(KernelIsa t_isa, const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst,
+                     size_t t_dstStride, int t_width, int t_height) {
+    void (*swapRow)(const uint8_t *, uint8_t *, int) = swapRedBlueRowScalar;
+
+#ifdef IMAGE_KERNELS_X86
+    if (t_isa == KernelIsa::AVX2) {
+        swapRow = swapRedBlueRowAvx2;
+    }
+    else if (t_isa == KernelIsa::SSSE3) {
+        swapRow = swapRedBlueRowSsse3;
+    }
+#endif
+
+    for (int y = 0; y < t_height; ++y) {
+        swapRow(t_src + y * t_srcStride, t_dst + y * t_dstStride, t_width);
+    }
+}
+
+void swapRedBlueCopy(const uint8_t *t_src, size_t t_srcStride, uint8_t *t_dst, size_t t_dstStride,
+                     int t_width, int t_height) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    swapRedBlueCopy(cpuIsa, t_src, t_srcStride, t_dst, t_dstStride, t_width, t_height);
+}
+
+void blockAbsoluteDifferences(KernelIsa t_isa, const uint8_t *t_first, const uint8_t *t_second, int t_width,
+                              int t_height, uint32_t *t_blockSums) {
+    void (*blockRow)(const uint8_t *, const uint8_t *, size_t, int, int, uint32_t *) = blockRowDifferencesScalar;
+
+#ifdef IMAGE_KERNELS_X86
+    if (t_isa == KernelIsa::AVX2) {
+        blockRow = blockRowDifferencesAvx2;
+    }
+    else if (t_isa == KernelIsa::SSSE3) {
+        blockRow = blockRowDifferencesSse2;
+    }
+#endif
+
+    const size_t stride = static_cast<size_t>(t_width);
+    const int blockColumns = t_width / kDifferenceBlockSize;
+    for (int y = 0; y + kDifferenceBlockSize <= t_height; y += kDifferenceBlockSize) {
+        blockRow(t_first + y * stride, t_second + y * stride, stride, 0, t_width,
+                 t_blockSums + (y / kDifferenceBlockSize) * blockColumns);
+    }
+}
+
+void blockAbsoluteDifferences(const uint8_t *t_first, const uint8_t *t_second, int t_width, int t_height,
+                              uint32_t *t_blockSums) {
+    static const KernelIsa cpuIsa = detectKernelIsa();
+
+    blockAbsoluteDifferences(cpuIsa, t_first, t_second, t_width, t_height, t_blockSums);
+}
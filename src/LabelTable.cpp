@@ -0,0 +1,192 @@
+#include "iCub/LabelTable.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    const char CacheMagic[8] = {'O', 'D', 'L', 'A', 'B', 'E', 'L', '2'};
+
+    // Start of the cache file, followed by the offsets of the ids then the names
+    struct LabelCacheHeader {
+        char magic[8];
+        uint64_t sourceHash;        // hash of the label file the table was parsed from
+        uint64_t payloadHash;       // hash of the offsets and the names
+        uint32_t idCount;
+        uint32_t namesSize;
+        uint32_t uniqueNames;
+        uint32_t reserved;
+    };
+
+    // FNV-1a over the bytes, the table stays free of Tensorflow
+    uint64_t payloadHash(const char *t_payload, size_t t_size) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < t_size; ++i) {
+            hash = (hash ^ static_cast<uint8_t>(t_payload[i])) * 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+
+const uint32_t LabelTable::UnknownOffset;
+
+
+LabelTable::LabelTable() : m_offsets(nullptr), m_names(nullptr), m_idCount(0), m_namesSize(0), m_uniqueNames(0),
+                           m_mapping(nullptr), m_mappingSize(0) {}
+
+LabelTable::~LabelTable() {
+    unmap();
+}
+
+
+void LabelTable::assign(const std::map<int, std::string> &t_labels) {
+    unmap();
+
+    const int largestId = t_labels.empty() ? -1 : t_labels.rbegin()->first;
+    m_ownedOffsets.assign(static_cast<size_t>(largestId + 1), UnknownOffset);
+    m_ownedNames.clear();
+
+    // the same name given to several ids is stored once
+    std::unordered_map<std::string, uint32_t> internedNames;
+    for (const auto &label : t_labels) {
+        if (label.first < 0) {
+            continue;
+        }
+
+        auto interned = internedNames.find(label.second);
+        if (interned == internedNames.end()) {
+            interned = internedNames.insert(std::make_pair(label.second,
+                                                           static_cast<uint32_t>(m_ownedNames.size()))).first;
+            const char *name = label.second.c_str();
+            m_ownedNames.insert(m_ownedNames.end(), name, name + label.second.size() + 1);
+        }
+        m_ownedOffsets[label.first] = interned->second;
+    }
+
+    m_offsets = m_ownedOffsets.data();
+    m_names = m_ownedNames.data();
+    m_idCount = static_cast<uint32_t>(m_ownedOffsets.size());
+    m_namesSize = static_cast<uint32_t>(m_ownedNames.size());
+    m_uniqueNames = static_cast<uint32_t>(internedNames.size());
+}
+
+
+bool LabelTable::mapCache(const std::string &t_cachePath, uint64_t t_sourceHash) {
+    const int file = open(t_cachePath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(LabelCacheHeader)) {
+        close(file);
+        return false;
+    }
+
+    const size_t mappingSize = static_cast<size_t>(fileStat.st_size);
+    void *mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    LabelCacheHeader header;
+    memcpy(&header, mapping, sizeof(header));
+
+    const char *payload = static_cast<const char *>(mapping) + sizeof(header);
+    const size_t payloadSize = static_cast<size_t>(header.idCount) * sizeof(uint32_t) + header.namesSize;
+
+    const bool valid = memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0 &&
+                       header.sourceHash == t_sourceHash &&
+                       mappingSize == sizeof(header) + payloadSize &&
+                       (header.namesSize == 0 || payload[payloadSize - 1] == '\0') &&
+                       payloadHash(payload, payloadSize) == header.payloadHash;
+    if (!valid) {
+        munmap(mapping, mappingSize);
+        return false;
+    }
+
+    unmap();
+    m_ownedOffsets.clear();
+    m_ownedNames.clear();
+
+    m_mapping = mapping;
+    m_mappingSize = mappingSize;
+    m_offsets = reinterpret_cast<const uint32_t *>(payload);
+    m_names = payload + static_cast<size_t>(header.idCount) * sizeof(uint32_t);
+    m_idCount = header.idCount;
+    m_namesSize = header.namesSize;
+    m_uniqueNames = header.uniqueNames;
+
+    // an offset outside of the names would be read out of the mapping
+    for (uint32_t i = 0; i < m_idCount; ++i) {
+        if (m_offsets[i] != UnknownOffset && m_offsets[i] >= m_namesSize) {
+            unmap();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool LabelTable::writeCache(const std::string &t_cachePath, uint64_t t_sourceHash) const {
+    std::vector<char> payload(static_cast<size_t>(m_idCount) * sizeof(uint32_t) + m_namesSize);
+    if (m_idCount > 0) {
+        memcpy(payload.data(), m_offsets, static_cast<size_t>(m_idCount) * sizeof(uint32_t));
+    }
+    if (m_namesSize > 0) {
+        memcpy(payload.data() + static_cast<size_t>(m_idCount) * sizeof(uint32_t), m_names, m_namesSize);
+    }
+
+    LabelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.sourceHash = t_sourceHash;
+    header.payloadHash = payloadHash(payload.data(), payload.size());
+    header.idCount = m_idCount;
+    header.namesSize = m_namesSize;
+    header.uniqueNames = m_uniqueNames;
+
+    // a start reading the cache while it is written sees the previous file or the complete new one, the
+    // temporary name is unique to the writer so that two starts writing the cache do not share a file
+    static std::atomic<unsigned> writeCount(0);
+    const std::string temporaryPath = t_cachePath + ".tmp." + std::to_string(getpid()) + "." +
+                                      std::to_string(writeCount++);
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                         (payload.empty() || fwrite(payload.data(), payload.size(), 1, file) == 1);
+    if (fclose(file) != 0 || !written || rename(temporaryPath.c_str(), t_cachePath.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+void LabelTable::unmap() {
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappingSize);
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+        m_offsets = nullptr;
+        m_names = nullptr;
+        m_idCount = 0;
+        m_namesSize = 0;
+        m_uniqueNames = 0;
+    }
+}
@@ -0,0 +1,118 @@
+#include "iCub/MotionGate.h"
+
+#include <algorithm>
+
+
+static const int kBlockColumns = MotionGate::ThumbnailWidth / kDifferenceBlockSize;
+static const int kBlockRows = MotionGate::ThumbnailHeight / kDifferenceBlockSize;
+
+
+MotionGate::MotionGate() : m_config({0.0, 1, 30}), m_framesChecked(0), m_framesSkipped(0), m_lastChangedBlocks(0) {
+}
+
+void MotionGate::configure(const MotionGateConfig &t_config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = t_config;
+    m_config.minChangedBlocks = std::max(1, m_config.minChangedBlocks);
+    m_config.refreshFrames = std::max(1, m_config.refreshFrames);
+    m_sources.clear();
+}
+
+MotionGateConfig MotionGate::getConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+bool MotionGate::frameChanged(size_t t_source, const uint8_t *t_pixels, size_t t_stride, int t_width,
+                              int t_height) {
+    const MotionGateConfig config = getConfig();
+    if (!config.enabled()) {
+        return true;
+    }
+
+    // the thumbnail is sampled and compared outside of the lock, the other sources are not delayed
+    static thread_local std::vector<uint8_t> thumbnail;
+    static thread_local std::vector<uint8_t> reference;
+    static thread_local std::vector<uint32_t> blockSums;
+    static thread_local std::vector<uint8_t> changeMask;
+    thumbnail.resize(ThumbnailWidth * ThumbnailHeight);
+    sampleGreyThumbnail(t_pixels, t_stride, t_width, t_height, thumbnail.data(), ThumbnailWidth, ThumbnailHeight);
+
+    int skippedFrames = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SourceFrames &source = m_sources[t_source];
+        if (source.width != t_width || source.height != t_height) {
+            source.width = t_width;
+            source.height = t_height;
+            source.reference.clear();
+        }
+        reference = source.reference;
+        skippedFrames = source.skippedFrames;
+    }
+
+    // a block changed when its mean difference is above the threshold, compared on the sum to stay in integers
+    const auto sumThreshold = static_cast<uint32_t>(config.blockThreshold * kDifferenceBlockSize *
+                                                    kDifferenceBlockSize);
+    changeMask.assign(kBlockColumns * kBlockRows, 1);
+    int changedBlocks = kBlockColumns * kBlockRows;
+    if (!reference.empty()) {
+        blockSums.resize(kBlockColumns * kBlockRows);
+        blockAbsoluteDifferences(thumbnail.data(), reference.data(), ThumbnailWidth, ThumbnailHeight,
+                                 blockSums.data());
+
+        changedBlocks = 0;
+        for (size_t b = 0; b < blockSums.size(); ++b) {
+            changeMask[b] = static_cast<uint8_t>(blockSums[b] > sumThreshold);
+            changedBlocks += changeMask[b];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SourceFrames &source = m_sources[t_source];
+    source.current.swap(thumbnail);
+    source.changeMask.swap(changeMask);
+    ++m_framesChecked;
+    m_lastChangedBlocks = static_cast<uint64_t>(changedBlocks);
+
+    return reference.empty() || changedBlocks >= config.minChangedBlocks || skippedFrames >= config.refreshFrames;
+}
+
+void MotionGate::countSkipped(size_t t_source) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ++m_sources[t_source].skippedFrames;
+    ++m_framesSkipped;
+}
+
+void MotionGate::takeThumbnail(size_t t_source, std::vector<uint8_t> *t_thumbnail) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SourceFrames &source = m_sources[t_source];
+    t_thumbnail->swap(source.current);
+    source.current.swap(source.spare);
+    source.skippedFrames = 0;
+}
+
+void MotionGate::commitReference(size_t t_source, std::vector<uint8_t> *t_thumbnail) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // compared with the frame the detections come from, a slow drift is caught once it adds up
+    SourceFrames &source = m_sources[t_source];
+    source.reference.swap(*t_thumbnail);
+    if (source.spare.empty()) {
+        source.spare.swap(*t_thumbnail);
+    }
+}
+
+std::vector<uint8_t> MotionGate::getChangeMask(size_t t_source) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto source = m_sources.find(t_source);
+    return source != m_sources.end() ? source->second.changeMask : std::vector<uint8_t>();
+}
+
+MotionGateStats MotionGate::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_framesChecked, m_framesSkipped, m_lastChangedBlocks};
+}
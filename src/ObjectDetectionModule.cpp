@@ -149,9 +149,20 @@ bool ObjectDetectionModule::respond(const Bottle &command, Bottle &reply) {
             {
                 reply.addVocab(Vocab::encode("many"));
                 reply.addString(helpMessage);
-                reply.addString("get label : Perform a forward pass on the loaded graph and output on label port the detected classes and their bouding boxes");
-                reply.addString("get threshold : Get the detection threshold value ");
-                reply.addString("set threshold : Set the detection threshold to consider valid recognition");
+                reply.addString("get label : Perform a forward pass on the loaded graph and output on label port the detected classes and their bouding boxes, in realTime the last detections published");
+                reply.addString("get threshold [model] : Get the detection threshold value of the main or an additional model");
+                reply.addString("set threshold <value> [model] : Set the detection threshold of the main or an additional model");
+                reply.addString("get queue : Get the number of frames waiting between the pipeline stages");
+                reply.addString("get pool : Get the hits, misses and bytes allocated by the input tensor pool");
+                reply.addString("get prep : Get the mean preprocessing time (ms) and bytes saved per frame");
+                reply.addString("get late : Get the capture to publish latency (ms) p50, p95, p99 and max over the last frames");
+                reply.addString("get stats : Get the frames in, out and dropped and the durations (ms) of each stage of the processing");
+                reply.addString("get rate : Get the achieved rate (batches/s), the batches published, dropped as stale and replaced by a newer capture");
+                reply.addString("get tile : Get the frames inferred in the tiled mode, the tiles inferred and skipped because unchanged");
+                reply.addString("get track : Get the frames inferred, tracked and superseded, the tracks created and active");
+                reply.addString("get motion : Get the frames compared and skipped by the motion gating, the skipped ratio, the comparison time and inference time saved (ms)");
+                reply.addString("set model <name> <graph> <labels> : Load another model in the background and switch to it once warmed up");
+                reply.addString("get model : Get the serving model, whether another one loads, the load, warmup and switch times (ms) of the last swap");
                 ok = true;
             }
             break;
@@ -165,9 +176,37 @@ bool ObjectDetectionModule::respond(const Bottle &command, Bottle &reply) {
                     case COMMAND_VOCAB_THRESHOLD:
                     {
                         const double t_detectionThreshold = command.get(2).asDouble();
-                        this->inferThread->setDetectionThreshold(t_detectionThreshold);
-                        reply.addString("Set the detection threshold success");
-                        ok = true;
+                        if (command.size() > 3) {
+                            ok = this->inferThread->setModelThreshold(command.get(3).asString(),
+                                                                      t_detectionThreshold);
+                        }
+                        else {
+                            this->inferThread->setDetectionThreshold(t_detectionThreshold);
+                            ok = true;
+                        }
+                        reply.addString(ok ? "Set the detection threshold success" : "Unknown model");
+
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_MODEL:
+                    {
+                        if (command.size() < 5) {
+                            reply.addString("Usage : set model <name> <graph> <labels>");
+                            ok = false;
+                            break;
+                        }
+
+                        const string modelName = command.get(2).asString();
+                        if (this->inferThread->requestModelSwap(modelName, command.get(3).asString(),
+                                                                command.get(4).asString())) {
+                            reply.addString("Loading model " + modelName);
+                            ok = true;
+                        }
+                        else {
+                            reply.addString("A model is already loading");
+                            ok = false;
+                        }
 
                         break;
                     }
@@ -187,13 +226,13 @@ bool ObjectDetectionModule::respond(const Bottle &command, Bottle &reply) {
 
                     case COMMAND_VOCAB_LABEL:
                     {
-                        const string predictedClass = inferThread->predictTopClass();
-                        if(!predictedClass.empty()){
-                            inferThread->writeToLabelPort(predictedClass);
-                            inferThread->sendImageBoxesDetected();
-
+                        // in realTime the pipeline alone reads and publishes, the last published detections are
+                        // answered. Otherwise one batch is inferred and published now
+                        Bottle detections;
+                        if (inferThread->getLabels(detections)) {
                             reply.addVocab(Vocab::encode("many"));
                             reply.addString("Run graph success");
+                            reply.append(detections);
                         }
 
                         else{
@@ -206,12 +245,137 @@ bool ObjectDetectionModule::respond(const Bottle &command, Bottle &reply) {
 
                     case COMMAND_VOCAB_THRESHOLD :
                     {
-                        const double t_thresholdCurrentValue = this->inferThread->getDetectionThreshold();
+                        double t_thresholdCurrentValue = 0.0;
+                        if (command.size() > 2) {
+                            ok = this->inferThread->getModelThreshold(command.get(2).asString(),
+                                                                      &t_thresholdCurrentValue);
+                        }
+                        else {
+                            t_thresholdCurrentValue = this->inferThread->getDetectionThreshold();
+                            ok = true;
+                        }
                         reply.addDouble(t_thresholdCurrentValue);
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_QUEUE :
+                    {
+                        const std::vector<PipelineQueueDepth> queueDepths = this->inferThread->getPipelineQueueDepths();
+                        if (queueDepths.empty()) {
+                            reply.addString("Pipeline not running");
+                        }
+
+                        for (const PipelineQueueDepth &queue : queueDepths) {
+                            Bottle &queueReply = reply.addList();
+                            queueReply.addString(queue.queueName);
+                            queueReply.addInt(static_cast<int>(queue.depth));
+                            queueReply.addInt(static_cast<int>(queue.capacity));
+                            queueReply.addInt(static_cast<int>(queue.dropped));
+                        }
+
+                        ok = true;
+                        break;
+                    }
+
+
+                    case COMMAND_VOCAB_POOL :
+                    {
+                        const TensorPoolStats poolStats = this->inferThread->getInputTensorPoolStats();
+                        reply.addInt(static_cast<int>(poolStats.hits));
+                        reply.addInt(static_cast<int>(poolStats.misses));
+                        reply.addInt(static_cast<int>(poolStats.bytesAllocated));
+                        reply.addInt(static_cast<int>(poolStats.pooledTensors));
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_PREPROCESS :
+                    {
+                        const PreprocessStats preprocessStats = this->inferThread->getPreprocessStats();
+                        const double frames = preprocessStats.frames > 0 ? preprocessStats.frames : 1;
+                        reply.addDouble(preprocessStats.totalTimeMs / frames);
+                        reply.addDouble(preprocessStats.bytesSaved / frames);
                         ok = true;
                         break;
                     }
 
+                    case COMMAND_VOCAB_LATENCY :
+                    {
+                        const LatencyPercentiles latency = this->inferThread->getPublishLatency();
+                        reply.addDouble(latency.p50 * 1000.0);
+                        reply.addDouble(latency.p95 * 1000.0);
+                        reply.addDouble(latency.p99 * 1000.0);
+                        reply.addDouble(latency.max * 1000.0);
+                        reply.addInt(static_cast<int>(latency.samples));
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_STATS :
+                    {
+                        this->inferThread->writeStats(reply);
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_MODEL :
+                    {
+                        const ModelSwapStats swapStats = this->inferThread->getModelSwapStats();
+                        reply.addString(swapStats.modelName);
+                        reply.addInt(swapStats.loading ? 1 : 0);
+                        reply.addDouble(swapStats.loadTimeMs);
+                        reply.addDouble(swapStats.warmupTimeMs);
+                        reply.addDouble(swapStats.switchLatencyMs);
+                        reply.addInt(static_cast<int>(swapStats.framesServedDuringLoad));
+                        reply.addString(swapStats.lastError);
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_TILE :
+                    {
+                        const TileStats tileStats = this->inferThread->getTileStats();
+                        reply.addInt(static_cast<int>(tileStats.frames));
+                        reply.addInt(static_cast<int>(tileStats.tilesInferred));
+                        reply.addInt(static_cast<int>(tileStats.tilesSkipped));
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_TRACK :
+                    {
+                        const TrackerStats trackerStats = this->inferThread->getTrackerStats();
+                        reply.addInt(static_cast<int>(trackerStats.framesInferred));
+                        reply.addInt(static_cast<int>(trackerStats.framesTracked));
+                        reply.addInt(static_cast<int>(trackerStats.framesSuperseded));
+                        reply.addInt(static_cast<int>(trackerStats.tracksCreated));
+                        reply.addInt(static_cast<int>(trackerStats.activeTracks));
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_MOTION :
+                    {
+                        const MotionStats motionStats = this->inferThread->getMotionStats();
+                        reply.addInt(static_cast<int>(motionStats.framesChecked));
+                        reply.addInt(static_cast<int>(motionStats.framesSkipped));
+                        reply.addDouble(motionStats.skippedRatio);
+                        reply.addDouble(motionStats.checkTimeMs);
+                        reply.addDouble(motionStats.inferenceTimeSavedMs);
+                        ok = true;
+                        break;
+                    }
+
+                    case COMMAND_VOCAB_RATE :
+                    {
+                        const SchedulingStats schedulingStats = this->inferThread->getSchedulingStats();
+                        reply.addDouble(schedulingStats.achievedRate);
+                        reply.addInt(static_cast<int>(schedulingStats.batchesPublished));
+                        reply.addInt(static_cast<int>(schedulingStats.staleBatchesDropped));
+                        reply.addInt(static_cast<int>(schedulingStats.replacedBatches));
+                        ok = true;
+                        break;
+                    }
 
                     default:
                         cout << "received an unknown request after a GET" << endl;
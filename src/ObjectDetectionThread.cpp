@@ -22,7 +22,12 @@
  * @brief Implementation of the eventDriven thread (see ObjectDetectionThread.h).
  */
 
+#include <chrono>
+#include <cstdlib>
+#include <condition_variable>
+#include <mutex>
 #include <utility>
+#include <opencv2/imgcodecs.hpp>
 
 #include "../include/iCub/ObjectDetectionThread.h"
 
@@ -31,7 +36,7 @@ using namespace yarp::os;
 using namespace yarp::sig;
 using namespace std;
 
-#define THRATE 400 //ms
+#define THRATE 400 //ms, period of the monitoring, the frames are processed as soon as they arrive
 
 //********************interactionEngineRatethread******************************************************
 
@@ -45,54 +50,284 @@ ObjectDetectionThread::ObjectDetectionThread(yarp::os::ResourceFinder &rf) : Rat
     modelName = rf.find("model_name").asString().c_str();
 
 
-    tfObjectDetection = std::unique_ptr<tensorflowObjectDetection>(
+    tfObjectDetection = std::shared_ptr<tensorflowObjectDetection>(
             new tensorflowObjectDetection(graphPath, labelsPath, modelName));
+    tfObjectDetection->setLabelsCache(rf.check("labels_cache",
+                                               Value(""),
+                                               "Binary cache of the labels, empty to parse the label file (string)").asString());
+    tfObjectDetection->setGraphFormat(parseGraphFormat(rf.check("graph_format",
+            Value("frozen"),
+            "Format of graph_path : frozen or memmapped, converted by objectDetectionConvertGraph (string)").asString()));
+    tfObjectDetection->setPrecision(parsePrecision(rf.check("precision",
+            Value("float"),
+            "Precision of the graph : float or int8, quantised by objectDetectionQuantizeGraph (string)").asString()));
+    tfObjectDetection->setGraphOptimization(
+            rf.check("optimize_graph",
+                     Value("false"),
+                     "Prune and fold the frozen graph at startup, cached next to it (boolean)").asBool(),
+            rf.check("graph_transforms",
+                     Value(""),
+                     "Transforms applied by optimize_graph, the default ones if empty (string)").asString());
 
     runRealTime = rf.check("realTime",
                            Value("false"),
                            "Run the module in realTime (boolean)").asBool();
-}
-
 
+    runPipeline = rf.check("pipeline",
+                           Value("true"),
+                           "Process the realTime stream with one thread per stage (boolean)").asBool();
+
+    pipelineQueueSize = rf.check("queue_size",
+                                 Value(2),
+                                 "Capacity of the queues between the pipeline stages (int)").asInt();
+
+    inferenceWorkers = std::max(1, rf.check("workers",
+                                            Value(2),
+                                            "Batches converted and inferred concurrently (int)").asInt());
+
+    tfObjectDetection->setSessionCount(rf.check("sessions",
+                                                Value(1),
+                                                "Sessions created from the graph, shared by the workers (int)").asInt());
+
+    // 0 lets TensorFlow pick the size of its thread pools
+    const ThreadingConfig threadingConfig = {
+            rf.check("intra_op_threads", Value(0), "Threads running the kernels of one op (int)").asInt(),
+            rf.check("inter_op_threads", Value(0), "Ops of the graph run concurrently (int)").asInt(),
+            rf.check("per_session_threads", Value("false"), "Thread pools owned by each session (boolean)").asBool()};
+    tfObjectDetection->setThreadingConfig(threadingConfig);
+
+    const char *home = std::getenv("HOME");
+    const std::string defaultTuningCache = std::string(home != nullptr ? home : ".") + "/.objectDetectionThreading.cache";
+    tfObjectDetection->setThreadingTuning(
+            parseTuningObjective(rf.check("tune_threads",
+                                          Value("off"),
+                                          "Tune the thread pools at startup : off, latency or throughput (string)").asString()),
+            rf.check("tune_cache",
+                     Value(defaultTuningCache),
+                     "File storing the tuned thread pools per host and graph (string)").asString(),
+            rf.check("tune_runs",
+                     Value(10),
+                     "Runs measured per thread pool configuration (int)").asInt());
+
+    latencyBudget = rf.check("latency_budget",
+                             Value(0.0),
+                             "Maximum age of a frame when its inference starts, 0 to disable (double, s)").asDouble();
+
+    labelFormat = parseLabelFormat(rf.check("label_format",
+                                            Value("string"),
+                                            "Detections on the label port : string, list or blob (string)").asString());
+
+    // tracking : one frame out of inference_period is inferred, the other ones are published from the tracks
+    tracking = rf.check("tracking",
+                        Value("false"),
+                        "Publish every frame, the frames not inferred from the tracks of the objects (boolean)").asBool();
+    objectTracker.configure({
+            std::max(1, rf.check("inference_period", Value(5), "Frames per inferred frame when tracking (int)").asInt()),
+            static_cast<float>(rf.check("track_match_iou",
+                                        Value(0.3),
+                                        "Overlap of a detection with a predicted track to update it (double)").asDouble()),
+            static_cast<float>(rf.check("track_min_confidence",
+                                        Value(0.5),
+                                        "Overlap of the last prediction of a track with its detection under which the next frame is inferred (double)").asDouble()),
+            rf.check("track_max_missed", Value(2), "Inferences a track survives without detection (int)").asInt(),
+            rf.check("track_process_noise", Value(500.0), "Acceleration of the objects (double, px/s^2)").asDouble(),
+            rf.check("track_measurement_noise", Value(4.0), "Error of the detected boxes (double, px)").asDouble()});
+
+    // motion gating : the frames whose scene did not change are published with the last detections
+    motionGate.configure({
+            rf.check("motion_threshold",
+                     Value(0.0),
+                     "Mean grey difference of a block of the downsampled frame above which it changed, 0 to disable (double)").asDouble(),
+            std::max(1, rf.check("motion_min_blocks", Value(1), "Changed blocks from which a frame is inferred (int)").asInt()),
+            std::max(1, rf.check("motion_refresh", Value(30), "Frames after which an unchanged scene is inferred again, at least 1 (int)").asInt())});
+    unchangedBatches = 0;
+
+    swapWarmupRuns = rf.check("swap_warmup_runs",
+                              Value(2),
+                              "Runs per session warming up a swapped model before it serves (int)").asInt();
+    modelSwapStats = {modelName, false, "", 0.0, 0.0, 0.0, 0};
+    awaitingSwappedModel = false;
+    swappedDetector = nullptr;
+    switchTime = 0.0;
+
+    batchesPublished = 0;
+    staleBatchesDropped = 0;
+    achievedRate = 0.0;
+    lastBatchesPublished = 0;
+    lastMonitorTime = yarp::os::Time::now();
+    monitorLogPeriod = rf.check("monitor_log_period",
+                                Value(0.0),
+                                "Period of the pipeline summary in the log, 0 to disable (double, s)").asDouble();
+    lastMonitorLogTime = lastMonitorTime;
+
+    framesIn = 0;
+    framesOut = 0;
+    framesDropped = 0;
+    statsPeriod = rf.check("stats_period",
+                           Value(1.0),
+                           "Period of the statistics written on the stats port (double, s)").asDouble();
+    lastStatsTime = 0.0;
+    tfObjectDetection->setStageStatistics(&stageStatistics);
+
+    publishLatency = std::unique_ptr<LatencyWindow>(new LatencyWindow(static_cast<size_t>(
+            rf.check("latency_window",
+                     Value(500),
+                     "Number of frames over which the latency percentiles are computed (int)").asInt())));
+
+    // one input port per camera, stacked in the same batch
+    if (rf.check("cameras") && rf.find("cameras").isList()) {
+        const Bottle *cameraNames = rf.find("cameras").asList();
+        for (int i = 0; i < cameraNames->size(); ++i) {
+            cameras.emplace_back(new CameraPorts);
+            cameras.back()->cameraName = cameraNames->get(i).asString();
+        }
+    }
+    if (cameras.empty()) {
+        cameras.emplace_back(new CameraPorts);
+    }
 
-ObjectDetectionThread::ObjectDetectionThread(yarp::os::ResourceFinder &rf, string _robot)
-        : RateThread(THRATE) {
-    robot = std::move(_robot);
-   
+    syncWindow = rf.check("sync_window",
+                          Value(0.03),
+                          "Maximum time between the frames of the cameras inferred together (double, s)").asDouble();
+    unalignedFramesDropped = 0;
+
+    cameraWidth = rf.check("camera_width",
+                           Value(640),
+                           "Expected width of the input images (int)").asInt();
+    cameraHeight = rf.check("camera_height",
+                            Value(480),
+                            "Expected height of the input images (int)").asInt();
+
+    // tiled mode : the frames are inferred as overlapping tiles, all those of a batch in one run
+    const TilingConfig tilingConfig = {
+            std::max(1, rf.check("tile_columns", Value(1), "Columns of tiles inferred per frame (int)").asInt()),
+            std::max(1, rf.check("tile_rows", Value(1), "Rows of tiles inferred per frame (int)").asInt()),
+            rf.check("tile_overlap", Value(0.2), "Fraction of a tile shared with its neighbour (double)").asDouble(),
+            static_cast<float>(rf.check("tile_merge_iou",
+                                        Value(0.5),
+                                        "Overlap merging the detections of two tiles (double)").asDouble()),
+            rf.check("tile_change_threshold",
+                     Value(0.0),
+                     "Mean grey difference under which a tile is not inferred again, 0 to disable (double)").asDouble(),
+            rf.check("tile_refresh", Value(30), "Frames after which an unchanged tile is inferred again (int)").asInt()};
+    tfObjectDetection->setTiling(tilingConfig);
+
+    // one input tensor per worker, a tensor goes back to the pool as soon as its batch is inferred
+    const size_t inFlightFrames = (runRealTime && runPipeline) ? static_cast<size_t>(inferenceWorkers) : 1;
+    if (tilingConfig.enabled()) {
+        const ImageTile tile = computeTiles(cameraWidth, cameraHeight, tilingConfig.columns, tilingConfig.rows,
+                                            tilingConfig.overlap).front();
+        tfObjectDetection->setExpectedInputSize(tile.width, tile.height, static_cast<int>(cameras.size()) *
+                                                tilingConfig.columns * tilingConfig.rows, inFlightFrames);
+    }
+    else {
+        tfObjectDetection->setExpectedInputSize(cameraWidth, cameraHeight, static_cast<int>(cameras.size()),
+                                                inFlightFrames);
+    }
 
-    const string graphPath = rf.find("graph_path").asString().c_str();
-    const string labelsPath = rf.find("labels_path").asString().c_str();
-    const string modelName = rf.find("model_name").asString().c_str();
+    const int inputWidth = rf.check("input_width",
+                                    Value(0),
+                                    "Width of the images given to the graph, 0 for the camera resolution (int)").asInt();
+    const int inputHeight = rf.check("input_height",
+                                     Value(0),
+                                     "Height of the images given to the graph, 0 for the camera resolution (int)").asInt();
+    const bool letterbox = rf.check("letterbox",
+                                    Value("false"),
+                                    "Keep the aspect ratio when resizing the images (boolean)").asBool();
+    tfObjectDetection->setInputResize(inputWidth, inputHeight, letterbox);
+
+    tfObjectDetection->setMaxDetections(static_cast<size_t>(std::max(0, rf.check("max_detections",
+            Value(20),
+            "Maximum number of objects kept per image, the best scored ones (int)").asInt())));
+    configureClassFilter(tfObjectDetection.get(), rf);
+
+    // the additional models are configured like the main one, they infer the input tensors it converts
+    modelOutput = parseModelOutput(rf.check("model_output",
+                                            Value("separate"),
+                                            "Ports of the additional models : separate or merged (string)").asString());
+    if (rf.check("additional_models") && rf.find("additional_models").isList()) {
+        const Bottle *additionalNames = rf.find("additional_models").asList();
+        for (int i = 0; i < additionalNames->size(); ++i) {
+            const string additionalName = additionalNames->get(i).asString();
+            const Bottle group = rf.findGroup(additionalName);
+            if (group.isNull() || !group.check("graph_path") || !group.check("labels_path")) {
+                yError("The additional model %s needs a group [%s] with graph_path and labels_path",
+                       additionalName.c_str(), additionalName.c_str());
+                continue;
+            }
+
+            AdditionalModel additionalModel;
+            additionalModel.name = additionalName;
+            additionalModel.detector = std::shared_ptr<tensorflowObjectDetection>(tfObjectDetection->createForModel(
+                    group.find("graph_path").asString(), group.find("labels_path").asString(),
+                    group.check("model_name") ? group.find("model_name").asString() : modelName));
+            if (group.check("threshold")) {
+                additionalModel.detector->setM_detectionThreshold(group.find("threshold").asDouble());
+            }
+            if (group.check("labels_cache")) {
+                additionalModel.detector->setLabelsCache(group.find("labels_cache").asString());
+            }
+            configureClassFilter(additionalModel.detector.get(), group);
+            additionalModels.push_back(std::move(additionalModel));
+        }
+    }
 
-    tfObjectDetection = std::unique_ptr<tensorflowObjectDetection>(
-            new tensorflowObjectDetection(graphPath, labelsPath, modelName));
+    // a camera holds frames in the captured queue, on the workers, in the reorder buffer and on its image port
+    const size_t framesPerCamera = static_cast<size_t>(std::max(1, pipelineQueueSize) + 2 * inferenceWorkers + 2);
+    for (auto &camera : cameras) {
+        camera->detectionPool.reserve(framesPerCamera * (1 + additionalModels.size()),
+                                      tfObjectDetection->getMaxDetections());
+    }
+}
 
-    runRealTime = rf.check("realTime",
-                           Value("false"),
-                           "Run the module in realTime (boolean)").asBool();
 
 
+ObjectDetectionThread::ObjectDetectionThread(yarp::os::ResourceFinder &rf, string _robot)
+        : ObjectDetectionThread(rf) {
+    robot = std::move(_robot);
 }
 
 ObjectDetectionThread::~ObjectDetectionThread() {
-    // do nothing
+    if (modelLoader.joinable()) {
+        modelLoader.join();
+    }
 }
 
 bool ObjectDetectionThread::threadInit() {
 
-    if (!inputImagePort.open(getName("/imageRGB:i").c_str())) {
-        std::cout << ": unable to open port /imageRGB:i " << std::endl;
-        return false;  // unable to open; let RFModule know so that it won't run
-    }
+    for (auto &camera : cameras) {
+        // a single unnamed camera keeps the historical port names
+        const string cameraPrefix = camera->cameraName.empty() ? "" : "/" + camera->cameraName;
+
+        if (!camera->inputImagePort.open(getName((cameraPrefix + "/imageRGB:i").c_str()).c_str())) {
+            std::cout << ": unable to open port " << cameraPrefix << "/imageRGB:i " << std::endl;
+            return false;  // unable to open; let RFModule know so that it won't run
+        }
+
+        if (!camera->outputImageBoxesPort.open(getName((cameraPrefix + "/imageBoxes:o").c_str()).c_str())) {
+            std::cout << ": unable to open port " << cameraPrefix << "/imageBoxes:o " << std::endl;
+            return false;  // unable to open; let RFModule know so that it won't run
+        }
 
-    if (!outputImageBoxesPort.open(getName("/imageBoxes:o").c_str())) {
-        std::cout << ": unable to open port /imageBoxes:o " << std::endl;
-        return false;  // unable to open; let RFModule know so that it won't run
-    }
 
+        if (!camera->outputLabelPort.open(getName((cameraPrefix + "/label:o").c_str()).c_str())) {
+            std::cout << ": unable to open port " << cameraPrefix << "/label:o " << std::endl;
+            return false;  // unable to open; let RFModule know so that it won't run
+        }
 
-    if (!outputLabelPort.open(getName("/label:o").c_str())) {
-        std::cout << ": unable to open port /label:o " << std::endl;
+        camera->modelLabelBlobs.resize(additionalModels.size());
+        for (size_t m = 0; modelOutput == ModelOutput::Separate && m < additionalModels.size(); ++m) {
+            const string modelPortName = cameraPrefix + "/" + additionalModels[m].name + "/label:o";
+            camera->modelLabelPorts.emplace_back(new BufferedPort<Bottle>);
+            if (!camera->modelLabelPorts.back()->open(getName(modelPortName.c_str()).c_str())) {
+                std::cout << ": unable to open port " << modelPortName << std::endl;
+                return false;  // unable to open; let RFModule know so that it won't run
+            }
+        }
+    }
+
+    if (!statsPort.open(getName("/stats:o").c_str())) {
+        std::cout << ": unable to open port /stats:o " << std::endl;
         return false;  // unable to open; let RFModule know so that it won't run
     }
 
@@ -103,8 +338,34 @@ bool ObjectDetectionThread::threadInit() {
         return false;
     }
 
+    for (const AdditionalModel &additionalModel : additionalModels) {
+        initGraphStatus = additionalModel.detector->initGraph();
+        if (initGraphStatus != tensorflow::Status::OK()) {
+            yError("Additional model %s : %s", additionalModel.name.c_str(), initGraphStatus.ToString().c_str());
+            return false;
+        }
+        yInfo("Additional model %s infers the frames converted for %s, %s output", additionalModel.name.c_str(),
+              modelName.c_str(), modelOutput == ModelOutput::Merged ? "merged" : "separate");
+    }
+
+    // one persistent thread per additional model and batch inferred concurrently
+    if (!additionalModels.empty()) {
+        const size_t concurrentBatches = (runRealTime && runPipeline) ? static_cast<size_t>(inferenceWorkers) : 1;
+        additionalScheduler = std::unique_ptr<WorkStealingScheduler>(
+                new WorkStealingScheduler(additionalModels.size() * concurrentBatches));
+        if (!additionalScheduler->start()) {
+            yError("Unable to start the workers of the additional models");
+            return false;
+        }
+    }
+
     outputBoxesImage = new ImageOf<PixelRgb>;
 
+    if (runRealTime && !startPipeline()) {
+        yError("Unable to start the detection pipeline");
+        return false;
+    }
+
 
     yInfo("Initialization of the processing thread correctly ended");
 
@@ -125,88 +386,602 @@ std::string ObjectDetectionThread::getName(const char *p) {
 
 
 void ObjectDetectionThread::run() {
-    
 
-    if (runRealTime && this->isRunning()) {
-        const string predictedClass = predictTopClass();
+    const double now = yarp::os::Time::now();
+    if (statsPort.getOutputCount() > 0 && now - lastStatsTime >= statsPeriod) {
+        Bottle &stats = statsPort.prepare();
+        stats.clear();
+        writeStats(stats);
+        statsPort.write();
+        lastStatsTime = now;
+    }
+
+    // The frames are processed by the stage threads as they arrive, this thread only monitors them
+    if (pipelineStages.empty()) {
+        return;
+    }
+
+    const uint64_t published = batchesPublished.load();
+    if (now > lastMonitorTime) {
+        achievedRate = (published - lastBatchesPublished) / (now - lastMonitorTime);
+    }
+    lastBatchesPublished = published;
+    lastMonitorTime = now;
+
+    // the same figures are on the stats port and get stats, the log only gets a summary once in a while
+    if (monitorLogPeriod <= 0.0 || now - lastMonitorLogTime < monitorLogPeriod) {
+        return;
+    }
+    lastMonitorLogTime = now;
+
+    const SchedulingStats schedulingStats = getSchedulingStats();
+    yDebug("Scheduling : %.2f batches/s, %llu stale dropped, %llu replaced by a newer capture",
+           schedulingStats.achievedRate, (unsigned long long) schedulingStats.staleBatchesDropped,
+           (unsigned long long) schedulingStats.replacedBatches);
+
+    const LatencyPercentiles latency = getPublishLatency();
+    yDebug("Capture to publish latency : p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms over %zu frames",
+           latency.p50 * 1000.0, latency.p95 * 1000.0, latency.p99 * 1000.0, latency.max * 1000.0, latency.samples);
+
+    if (tracking) {
+        const TrackerStats trackerStats = getTrackerStats();
+        yDebug("Tracking : %llu frames inferred, %llu tracked, %llu superseded, %llu active tracks",
+               (unsigned long long) trackerStats.framesInferred, (unsigned long long) trackerStats.framesTracked,
+               (unsigned long long) trackerStats.framesSuperseded, (unsigned long long) trackerStats.activeTracks);
+    }
+
+    if (motionGate.getConfig().enabled()) {
+        const MotionStats motionStats = getMotionStats();
+        yDebug("Motion gating : %.1f %% of %llu frames skipped, %.0f ms of inference saved",
+               motionStats.skippedRatio * 100.0, (unsigned long long) motionStats.framesChecked,
+               motionStats.inferenceTimeSavedMs);
+    }
+
+    if (!runPipeline) {
+        return;
+    }
+
+    for (const PipelineQueueDepth &queue : getPipelineQueueDepths()) {
+        yDebug("Pipeline queue %s : %zu/%zu frames, %zu dropped", queue.queueName.c_str(), queue.depth,
+               queue.capacity, queue.dropped);
+    }
 
-        this->writeToLabelPort(predictedClass);
-        this->sendImageBoxesDetected();
+    const PreprocessStats preprocessStats = getPreprocessStats();
+    if (preprocessStats.frames > 0) {
+        yDebug("Preprocessing : %.3f ms and %llu bytes saved per frame",
+               preprocessStats.totalTimeMs / preprocessStats.frames,
+               (unsigned long long) (preprocessStats.bytesSaved / preprocessStats.frames));
+    }
 
-        yInfo("Run graph success");
-        
+    const SchedulerStats schedulerStats = getSchedulerStats();
+    yDebug("Inference workers : %zu workers, %llu batches inferred, %llu stolen, %zu published out of order",
+           schedulerStats.workers, (unsigned long long) schedulerStats.executed,
+           (unsigned long long) schedulerStats.stolen, reorderBuffer->reordered());
 
-       
+    if (cameras.size() > 1) {
+        yDebug("Camera synchronisation : %zu unaligned frames dropped", unalignedFramesDropped);
     }
-    
+
+    const TileStats tileStats = getTileStats();
+    if (tileStats.frames > 0) {
+        yDebug("Tiles : %.2f inferred and %.2f skipped unchanged per frame",
+               static_cast<double>(tileStats.tilesInferred) / tileStats.frames,
+               static_cast<double>(tileStats.tilesSkipped) / tileStats.frames);
+    }
+
+    const TensorPoolStats poolStats = getInputTensorPoolStats();
+    yDebug("Input tensor pool : %llu hits, %llu misses, %llu bytes allocated",
+           (unsigned long long) poolStats.hits, (unsigned long long) poolStats.misses,
+           (unsigned long long) poolStats.bytesAllocated);
+
+    uint64_t bufferHits = 0;
+    uint64_t bufferMisses = 0;
+    for (const auto &camera : cameras) {
+        bufferHits += camera->detectionPool.hits();
+        bufferMisses += camera->detectionPool.misses();
+    }
+    yDebug("Detection buffer pools : %llu hits, %llu misses", (unsigned long long) bufferHits,
+           (unsigned long long) bufferMisses);
 }
 
 
 
 
 void ObjectDetectionThread::threadRelease() {
-    outputImageBoxesPort.interrupt();
-    outputImageBoxesPort.close();
+    // a model being loaded can not be interrupted, it is switched in before the pipeline stops
+    if (modelLoader.joinable()) {
+        modelLoader.join();
+    }
+
+    stopPipeline();
+
+    // after the pipeline, no batch runs the additional models anymore
+    if (additionalScheduler != nullptr) {
+        additionalScheduler->stop();
+        additionalScheduler.reset();
+    }
 
-    inputImagePort.interrupt();
-    inputImagePort.close();
+    statsPort.interrupt();
+    statsPort.close();
 
+    for (auto &camera : cameras) {
+        camera->outputImageBoxesPort.interrupt();
+        camera->outputImageBoxesPort.close();
+
+        camera->inputImagePort.interrupt();
+        camera->inputImagePort.close();
+
+        camera->outputLabelPort.interrupt();
+        camera->outputLabelPort.close();
+
+        for (auto &modelLabelPort : camera->modelLabelPorts) {
+            modelLabelPort->interrupt();
+            modelLabelPort->close();
+        }
+
+        camera->publishedFrame.reset();
+    }
 
 }
 
-std::string ObjectDetectionThread::predictTopClass() {
+BatchPtr ObjectDetectionThread::predictTopClass() {
 
-    yarp::sig::ImageOf<yarp::sig::PixelRgb> *inputImage = inputImagePort.read();
+    const BatchPtr batch = acquireBatch();
 
-    if (inputImage != nullptr) {
-        cv::Mat inputImageMat = cv::cvarrToMat(inputImage->getIplImage());
-        cv::cvtColor(inputImageMat, inputImageMat, CV_BGR2RGB);
+    if (batch != nullptr) {
+        inferBatch(batch);
+    }
 
-        return tfObjectDetection->inferObject(inputImageMat);
 
+    return batch;
+}
+
+bool ObjectDetectionThread::getLabels(yarp::os::Bottle &t_detections) {
+    // without realTime nothing else reads the input ports, the batch is published like those of the pipeline
+    if (pipelineStages.empty()) {
+        const BatchPtr batch = predictTopClass();
+        if (batch == nullptr || !batch->inferred) {
+            return false;
+        }
+
+        bool detectionFound = false;
+        for (const FramePtr &frame : batch->frames) {
+            detectionFound = detectionFound || !frame->objectsDetected.empty();
+        }
+        if (!detectionFound) {
+            return false;
+        }
+
+        publishBatch(batch);
+        ++batchesPublished;
     }
 
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::vector<char> blobBuffer;
+    bool detectionFound = false;
+    for (const auto &camera : cameras) {
+        if (camera->publishedDetections.empty() || camera->publishedLabels == nullptr) {
+            continue;
+        }
+
+        Bottle &cameraDetections = t_detections.addList();
+        cameraDetections.addString(camera->cameraName);
+        writeDetections(labelFormat, camera->publishedDetections, *camera->publishedLabels, blobBuffer,
+                        cameraDetections);
+        detectionFound = true;
+    }
 
-    return std::__cxx11::string();
+    return detectionFound;
 }
 
-void ObjectDetectionThread::writeToLabelPort(string label) {
+bool ObjectDetectionThread::inferBatch(const BatchPtr &t_batch) {
+    // the whole batch goes through the same model, even if another one is swapped in meanwhile
+    t_batch->detector = currentDetector();
+
+    if (!preprocessBatch(t_batch)) {
+        return false;
+    }
+
+    // no tile changed in any frame : the detections are those of the previous runs
+    t_batch->additionalOutputs.resize(additionalModels.size());
+    if (!t_batch->inputTensor.IsInitialized()) {
+        postprocessBatch(t_batch);
+        t_batch->inferred = true;
+        return true;
+    }
+
+    // The additional models run on the persistent workers of additionalScheduler while this thread runs the main
+    // model. Each holds a reference to the converted input, the tensor pool reuses it only once all of them are done
+    std::vector<tensorflow::Status> additionalStatuses(additionalModels.size());
+    std::mutex additionalMutex;
+    std::condition_variable additionalDone;
+    size_t pendingRuns = 0;
+    for (size_t m = 0; m < additionalModels.size(); ++m) {
+        const tensorflow::Tensor sharedInput = t_batch->inputTensor;
+        std::vector<tensorflow::Tensor> *additionalOutputs = &t_batch->additionalOutputs[m];
+        tensorflowObjectDetection *additionalDetector = additionalModels[m].detector.get();
+        tensorflow::Status *additionalStatus = &additionalStatuses[m];
+
+        {
+            std::lock_guard<std::mutex> lock(additionalMutex);
+            ++pendingRuns;
+        }
+        const bool submitted = additionalScheduler != nullptr && additionalScheduler->submit(
+                [&additionalMutex, &additionalDone, &pendingRuns, additionalDetector, sharedInput,
+                 additionalOutputs, additionalStatus] {
+                    *additionalStatus = additionalDetector->runGraphOnSharedInput(sharedInput, additionalOutputs);
+
+                    // notified under the lock, the waiting thread can not leave inferBatch meanwhile
+                    std::lock_guard<std::mutex> lock(additionalMutex);
+                    --pendingRuns;
+                    additionalDone.notify_one();
+                });
+
+        // without workers, e.g. once they are stopped, the model runs on this thread
+        if (!submitted) {
+            *additionalStatus = additionalDetector->runGraphOnSharedInput(sharedInput, additionalOutputs);
+            std::lock_guard<std::mutex> lock(additionalMutex);
+            --pendingRuns;
+        }
+    }
+
+    // one Session::Run for the frames of all the cameras
+    const tensorflow::Status runStatus = t_batch->detector->runGraph(t_batch->inputTensor, &t_batch->outputs);
+
+    {
+        std::unique_lock<std::mutex> lock(additionalMutex);
+        additionalDone.wait(lock, [&pendingRuns] { return pendingRuns == 0; });
+    }
+
+    // a failed additional model only leaves its detections empty
+    for (size_t m = 0; m < additionalStatuses.size(); ++m) {
+        const tensorflow::Status &additionalStatus = additionalStatuses[m];
+        if (!additionalStatus.ok()) {
+            yError("Running the additional model %s failed: %s", additionalModels[m].name.c_str(),
+                   additionalStatus.error_message().c_str());
+            t_batch->additionalOutputs[m].clear();
+        }
+    }
+
+    if (!runStatus.ok()) {
+        yError("Running model failed: %s", runStatus.error_message().c_str());
+        return false;
+    }
+
+    postprocessBatch(t_batch);
+    t_batch->inferred = true;
+
+    return true;
+}
+
+FramePtr ObjectDetectionThread::acquireFrame(size_t t_cameraIndex) {
+    CameraPorts &camera = *cameras[t_cameraIndex];
+    yarp::sig::ImageOf<yarp::sig::PixelRgb> *inputImage = nullptr;
+    {
+        ScopedStageTimer portReadTimer(&stageStatistics, Stage::PortRead);
+        inputImage = camera.inputImagePort.read();
+    }
+
+    if (inputImage == nullptr) {
+        return FramePtr();
+    }
+    ++framesIn;
+
+    FramePtr frame = std::make_shared<DetectionFrame>(camera.inputImagePort, *inputImage, t_cameraIndex,
+                                                      camera.detectionPool);
+
+    // the outputs carry the envelope of their frame, a sender without envelopes gets a local one
+    if (!frame->stamp.isValid()) {
+        camera.localStamp.update(frame->receivedTime);
+        frame->stamp = camera.localStamp;
+    }
+
+    return frame;
+}
+
+BatchPtr ObjectDetectionThread::acquireBatch() {
+    BatchPtr batch = std::make_shared<DetectionBatch>();
+    batch->frames.resize(cameras.size());
+
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        batch->frames[i] = acquireFrame(i);
+        if (batch->frames[i] == nullptr) {
+            return BatchPtr();
+        }
+    }
+
+    // Time alignment : replace the oldest frame until the capture times fit in the window
+    while (batch->frames.size() > 1) {
+        size_t oldest = 0;
+        size_t newest = 0;
+        bool stampsValid = true;
+        for (size_t i = 0; i < batch->frames.size(); ++i) {
+            const yarp::os::Stamp &stamp = batch->frames[i]->stamp;
+            stampsValid = stampsValid && stamp.isValid();
+            if (stamp.getTime() < batch->frames[oldest]->stamp.getTime()) {
+                oldest = i;
+            }
+            if (stamp.getTime() > batch->frames[newest]->stamp.getTime()) {
+                newest = i;
+            }
+        }
+
+        // without envelopes the frames can not be aligned, they are inferred as read
+        if (!stampsValid ||
+            batch->frames[newest]->stamp.getTime() - batch->frames[oldest]->stamp.getTime() <= syncWindow) {
+            break;
+        }
+
+        ++unalignedFramesDropped;
+        ++framesDropped;
+        batch->frames[oldest] = acquireFrame(oldest);
+        if (batch->frames[oldest] == nullptr) {
+            return BatchPtr();
+        }
+    }
+
+    return batch;
+}
+
+bool ObjectDetectionThread::preprocessBatch(const BatchPtr &t_batch) {
+    // the colour conversion is fused with the copy in the tensor, the frame images stay as received
+    std::vector<cv::Mat> inputImages;
+    for (const FramePtr &frame : t_batch->frames) {
+        inputImages.push_back(cv::cvarrToMat(frame->image.getIplImage()));
+    }
+
+    if (t_batch->detector->getTiling().enabled()) {
+        // the tiles of all the frames in one batch, the unchanged ones are left out
+        std::vector<size_t> sources;
+        for (const FramePtr &frame : t_batch->frames) {
+            sources.push_back(frame->cameraIndex);
+        }
+
+        std::vector<TiledFrame> tiledFrames;
+        const tensorflow::Status tileStatus = t_batch->detector->tilesToTensor(inputImages, sources,
+                                                                               &t_batch->inputTensor, &tiledFrames);
+        if (!tileStatus.ok()) {
+            yError("Converting the tiles failed: %s", tileStatus.error_message().c_str());
+            return false;
+        }
+
+        for (size_t i = 0; i < t_batch->frames.size(); ++i) {
+            t_batch->frames[i]->tiles = std::move(tiledFrames[i]);
+            t_batch->frames[i]->geometry = t_batch->frames[i]->tiles.geometry;
+        }
+        return true;
+    }
+
+    std::vector<ResizeGeometry> geometries;
+    const tensorflow::Status convertStatus = t_batch->detector->imagesToTensor(inputImages, &t_batch->inputTensor,
+                                                                               &geometries);
+    if (!convertStatus.ok()) {
+        yError("Converting the frames failed: %s", convertStatus.error_message().c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < t_batch->frames.size(); ++i) {
+        t_batch->frames[i]->geometry = geometries[i];
+    }
+
+    return true;
+}
+
+void ObjectDetectionThread::postprocessBatch(const BatchPtr &t_batch) {
+    ScopedStageTimer postprocessTimer(&stageStatistics, Stage::Postprocess);
+    const std::shared_ptr<const LabelTable> labels(t_batch->detector, &t_batch->detector->getLabels());
+    const bool tiled = t_batch->detector->getTiling().enabled();
+    for (size_t i = 0; i < t_batch->frames.size(); ++i) {
+        DetectionFrame &frame = *t_batch->frames[i];
+        if (tiled) {
+            t_batch->detector->extractTiledDetections(t_batch->outputs, frame.tiles, &frame.objectsDetected);
+        }
+        else {
+            t_batch->detector->extractDetections(t_batch->outputs, static_cast<int>(i), frame.geometry,
+                                                 &frame.objectsDetected);
+        }
+        frame.labels = labels;
+        if (labelFormat == LabelFormat::String) {
+            frame.detectedLabels = tensorflowObjectDetection::detectionsToString(frame.objectsDetected, *labels);
+        }
+
+        frame.additionalDetections.resize(additionalModels.size());
+        for (size_t m = 0; m < additionalModels.size(); ++m) {
+            const std::shared_ptr<tensorflowObjectDetection> &additionalDetector = additionalModels[m].detector;
+            ModelDetections &additional = frame.additionalDetections[m];
+            if (additional.objectsDetected.capacity() == 0) {
+                additional.objectsDetected = frame.acquireDetectionBuffer();
+            }
+            additional.labels = std::shared_ptr<const LabelTable>(additionalDetector,
+                                                                  &additionalDetector->getLabels());
+            if (tiled) {
+                additionalDetector->extractTiledDetections(t_batch->additionalOutputs[m], frame.tiles,
+                                                           &additional.objectsDetected);
+            }
+            else if (t_batch->additionalOutputs[m].empty()) {
+                additional.objectsDetected.clear();
+            }
+            else {
+                additionalDetector->extractDetections(t_batch->additionalOutputs[m], static_cast<int>(i),
+                                                      frame.geometry, &additional.objectsDetected);
+            }
+            if (labelFormat == LabelFormat::String) {
+                additional.detectedLabels = tensorflowObjectDetection::detectionsToString(additional.objectsDetected,
+                                                                                          *additional.labels);
+            }
+        }
+    }
+}
+
+void ObjectDetectionThread::publishBatch(const BatchPtr &t_batch) {
+    // with tracking, the dispatch stage publishes the tracked batches while this stage publishes the inferred ones
+    std::lock_guard<std::mutex> lock(publishMutex);
+    if (tracking) {
+        trackBatch(t_batch);
+    }
+
+    for (const FramePtr &frame : t_batch->frames) {
+        // the inference succeeded, the next frames are compared with this one
+        if (t_batch->inferred && !frame->motionThumbnail.empty()) {
+            motionGate.commitReference(frame->cameraIndex, &frame->motionThumbnail);
+        }
+
+        // inferred while later frames were published from the tracks, it only corrected the tracks
+        CameraPorts &camera = *cameras[frame->cameraIndex];
+        if (frame->stamp.getTime() < camera.publishedTime) {
+            objectTracker.countSuperseded();
+            continue;
+        }
+
+        // nothing to publish again until a frame of the camera was inferred
+        if (t_batch->unchanged && camera.inferredDetections.labels == nullptr) {
+            continue;
+        }
+        camera.publishedTime = frame->stamp.getTime();
+
+        // same scene as the last inferred frame of the camera : its detections are lent to the frame while it is
+        // published. An inferred frame leaves its detections to the camera once published
+        const bool keptDetections = t_batch->inferred && motionGate.getConfig().enabled();
+        if (t_batch->unchanged) {
+            exchangeInferredDetections(camera, *frame);
+        }
+
+        // copied within the storage of the camera, for get label
+        camera.publishedDetections.reset(frame->objectsDetected.capacity());
+        for (const Detection &detection : frame->objectsDetected) {
+            camera.publishedDetections.push(detection);
+        }
+        camera.publishedLabels = frame->labels;
+
+        writeToLabelPort(frame);
+        sendImageBoxesDetected(frame);
+
+        if (t_batch->unchanged || keptDetections) {
+            exchangeInferredDetections(camera, *frame);
+        }
+
+        publishLatency->add(yarp::os::Time::now() - frame->stamp.getTime());
+        ++framesOut;
+    }
+
+    // the batches in flight at the switch are still published with the previous model
+    if (awaitingSwappedModel && t_batch->detector.get() == swappedDetector) {
+        std::lock_guard<std::mutex> lock(modelSwapMutex);
+        if (awaitingSwappedModel) {
+            modelSwapStats.switchLatencyMs = (yarp::os::Time::now() - switchTime) * 1000.0;
+            awaitingSwappedModel = false;
+            yInfo("First frame of the model %s published %.1f ms after the switch", modelSwapStats.modelName.c_str(),
+                  modelSwapStats.switchLatencyMs);
+        }
+    }
+}
+
+void ObjectDetectionThread::exchangeInferredDetections(CameraPorts &t_camera, DetectionFrame &t_frame) {
+    t_camera.inferredDetections.objectsDetected.swap(t_frame.objectsDetected);
+    t_camera.inferredDetections.detectedLabels.swap(t_frame.detectedLabels);
+    t_camera.inferredDetections.labels.swap(t_frame.labels);
+    t_camera.inferredAdditionalDetections.swap(t_frame.additionalDetections);
+}
+
+void ObjectDetectionThread::writeToLabelPort(const FramePtr &t_frame) {
+    CameraPorts &camera = *cameras[t_frame->cameraIndex];
+    yarp::os::BufferedPort<yarp::os::Bottle> &outputLabelPort = camera.outputLabelPort;
+
     Bottle &labelOutput = outputLabelPort.prepare();
     labelOutput.clear();
 
-    labelOutput.addString(label);
+    if (labelFormat == LabelFormat::String) {
+        labelOutput.addString(t_frame->detectedLabels);
+    }
+    else {
+        // the typed formats are written straight into the prepared Bottle, without intermediate strings
+        ScopedStageTimer postprocessTimer(&stageStatistics, Stage::Postprocess);
+        writeDetections(labelFormat, t_frame->objectsDetected, *t_frame->labels, camera.labelBlob, labelOutput);
+    }
+
+    // merged : one more element per additional model, separate : the same content on the port of the model
+    for (size_t m = 0; m < t_frame->additionalDetections.size(); ++m) {
+        const ModelDetections &additional = t_frame->additionalDetections[m];
+        Bottle *additionalOutput = &labelOutput;
+        if (modelOutput == ModelOutput::Separate) {
+            additionalOutput = &camera.modelLabelPorts[m]->prepare();
+            additionalOutput->clear();
+        }
+
+        if (labelFormat == LabelFormat::String) {
+            additionalOutput->addString(additional.detectedLabels);
+        }
+        else {
+            ScopedStageTimer postprocessTimer(&stageStatistics, Stage::Postprocess);
+            writeDetections(labelFormat, additional.objectsDetected, *additional.labels, camera.modelLabelBlobs[m],
+                            *additionalOutput);
+        }
+
+        if (modelOutput == ModelOutput::Separate) {
+            camera.modelLabelPorts[m]->setEnvelope(t_frame->stamp);
+            ScopedStageTimer portWriteTimer(&stageStatistics, Stage::PortWrite);
+            camera.modelLabelPorts[m]->write();
+        }
+    }
+    outputLabelPort.setEnvelope(t_frame->stamp);
+
+    ScopedStageTimer portWriteTimer(&stageStatistics, Stage::PortWrite);
     outputLabelPort.write();
 
 
 }
 
 void ObjectDetectionThread::setDetectionThreshold(const double t_thresholdInference) {
-    this->tfObjectDetection->setM_detectionThreshold(t_thresholdInference);
+    currentDetector()->setM_detectionThreshold(t_thresholdInference);
 }
 
 double ObjectDetectionThread::getDetectionThreshold() {
-    this->tfObjectDetection->getM_detecttionThreshold();
+    return currentDetector()->getM_detecttionThreshold();
 }
 
-void ObjectDetectionThread::drawDetectedBoxes(IplImage *t_imageToDraw) {
+bool ObjectDetectionThread::setModelThreshold(const std::string &t_modelName, const double t_thresholdInference) {
+    for (const AdditionalModel &additionalModel : additionalModels) {
+        if (additionalModel.name == t_modelName) {
+            additionalModel.detector->setM_detectionThreshold(t_thresholdInference);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ObjectDetectionThread::getModelThreshold(const std::string &t_modelName, double *t_thresholdInference) {
+    for (const AdditionalModel &additionalModel : additionalModels) {
+        if (additionalModel.name == t_modelName) {
+            *t_thresholdInference = additionalModel.detector->getM_detecttionThreshold();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ObjectDetectionThread::drawDetectedBoxes(IplImage *t_imageToDraw, const DetectionBuffer &t_objectsDetected,
+                                              const LabelTable &t_labels) {
 
     cv::Point originBox, endBox, displayTextPos;
 
-    for (auto &it : tfObjectDetection->m_objectsDetected) {
+    for (const Detection &detection : t_objectsDetected) {
 
-        originBox = cvPoint(it.second.coordinate[0], it.second.coordinate[1]);
-        endBox = cvPoint(it.second.coordinate[2], it.second.coordinate[3]);
-        const Color objectColor = getObjectColor(it.second.className);
+        originBox = cvPoint(detection.box[0], detection.box[1]);
+        endBox = cvPoint(detection.box[2], detection.box[3]);
+        const Color objectColor = getObjectColor(t_labels.name(detection.classId));
 
         cvRectangle(t_imageToDraw, originBox, endBox, cvScalar(objectColor.red, objectColor.green, objectColor.blue), 3);
 
-        const std::string textToDisplay = it.first + " " + std::to_string(it.second.probabilityDetection);
+        const std::string textToDisplay = tensorflowObjectDetection::detectionName(t_labels, detection) + " " +
+                                          std::to_string(static_cast<double>(detection.score));
         const cv::Size textSize = cv::getTextSize(textToDisplay, fontFace, fontScale, thickness, 0);                
-        displayTextPos = cvPoint(it.second.coordinate[0] , it.second.coordinate[1] );
+        displayTextPos = cvPoint(detection.box[0] , detection.box[1] );
 
 
 
-        cvRectangle(t_imageToDraw, cvPoint(it.second.coordinate[0] , it.second.coordinate[1] - (textSize.height * 2) ), cvPoint(displayTextPos.x + textSize.width, displayTextPos.y + textSize.height * 0.8), cvScalar(objectColor.red, objectColor.green, objectColor.blue), -1);
+        cvRectangle(t_imageToDraw, cvPoint(detection.box[0] , detection.box[1] - (textSize.height * 2) ), cvPoint(displayTextPos.x + textSize.width, displayTextPos.y + textSize.height * 0.8), cvScalar(objectColor.red, objectColor.green, objectColor.blue), -1);
         cv::putText(cv::cvarrToMat(t_imageToDraw), textToDisplay, displayTextPos, fontFace, fontScale, cvScalar(255, 255, 255), thickness);
     }
 
@@ -240,30 +1015,634 @@ Color ObjectDetectionThread::getRandomColor() {
     return randomColor;
 }
 
-void ObjectDetectionThread::sendImageBoxesDetected() {
+void ObjectDetectionThread::sendImageBoxesDetected(const FramePtr &t_frame) {
+
+    CameraPorts &camera = *cameras[t_frame->cameraIndex];
+
+    if (camera.outputImageBoxesPort.getOutputCount()) {
+
+        auto *outputIplBoxes = (IplImage *) t_frame->image.getIplImage();
+        {
+            ScopedStageTimer drawBoxesTimer(&stageStatistics, Stage::DrawBoxes);
+            drawDetectedBoxes(outputIplBoxes, t_frame->objectsDetected, *t_frame->labels);
+            for (const ModelDetections &additional : t_frame->additionalDetections) {
+                drawDetectedBoxes(outputIplBoxes, additional.objectsDetected, *additional.labels);
+            }
+        }
+
+        ScopedStageTimer portWriteTimer(&stageStatistics, Stage::PortWrite);
+
+        // The previous image may still be sent from the buffer of the previous frame
+        camera.outputImageBoxesPort.waitForWrite();
+
+        yarp::sig::ImageOf<yarp::sig::PixelRgb> &outputImage = camera.outputImageBoxesPort.prepare();
+        outputImage.resize(outputIplBoxes->width, outputIplBoxes->height);
 
-    if (outputImageBoxesPort.getOutputCount() && inputImagePort.getInputCount()) {
+        outputImage.wrapIplImage(outputIplBoxes);
+        camera.outputImageBoxesPort.setEnvelope(t_frame->stamp);
+        camera.outputImageBoxesPort.write();
 
-        yarp::sig::ImageOf<yarp::sig::PixelRgb> *inputImage = inputImagePort.read();
-        if (inputImage != nullptr) {
+        // The port shares the frame buffer, keep it until the next write
+        camera.publishedFrame = t_frame;
+    }
+}
 
 
-            auto *outputIplBoxes = (IplImage *) inputImage->getIplImage();
-            drawDetectedBoxes(outputIplBoxes);
 
-            inputImage = &outputImageBoxesPort.prepare();
-            inputImage->resize(outputIplBoxes->width, outputIplBoxes->height);
+/************************************* PIPELINE STAGES  *************************************/
 
-            inputImage->wrapIplImage(outputIplBoxes);
-            outputImageBoxesPort.write();
-            
-            this->tfObjectDetection->clearSetOfObject();
+bool ObjectDetectionThread::startPipeline() {
+    if (!runPipeline) {
+        // one thread reads the next frame as soon as the previous one is published
+        pipelineStages.emplace_back(new PipelineStage("serial", [this] { return serialStep(); }));
+    }
+    else {
+        // with a latency budget the captured batches go through a mailbox : the latest capture wins
+        const size_t queueSize = latencyBudget > 0.0 ? 1 : static_cast<size_t>(pipelineQueueSize);
 
+        capturedQueue = std::unique_ptr<BoundedQueue<BatchPtr> >(new BoundedQueue<BatchPtr>(queueSize));
 
+        // the batches being inferred plus the ones waiting for an earlier batch to be published
+        reorderBuffer = std::unique_ptr<ReorderBuffer<BatchPtr> >(
+                new ReorderBuffer<BatchPtr>(static_cast<size_t>(inferenceWorkers) + queueSize));
+
+        inferenceScheduler = std::unique_ptr<WorkStealingScheduler>(
+                new WorkStealingScheduler(static_cast<size_t>(inferenceWorkers)));
+        if (!inferenceScheduler->start()) {
+            yError("Unable to start the inference workers");
+            return false;
+        }
+
+        pipelineStages.emplace_back(new PipelineStage("capture", [this] { return captureStep(); }));
+        pipelineStages.emplace_back(new PipelineStage("dispatch", [this] { return dispatchStep(); }));
+        pipelineStages.emplace_back(new PipelineStage("publish", [this] { return publishStep(); }));
+    }
+
+    for (auto &stage : pipelineStages) {
+        if (!stage->start()) {
+            yError("Unable to start the pipeline stage %s", stage->getStageName().c_str());
+            stopPipeline();
+            return false;
+        }
+    }
+
+    if (runPipeline) {
+        yInfo("Detection pipeline started for %zu camera(s) with queues of %zu frames, %d workers and %d sessions",
+              cameras.size(), capturedQueue->capacity(), inferenceWorkers, currentDetector()->getSessionCount());
+    }
+    else {
+        yInfo("Serial detection started for %zu camera(s)", cameras.size());
+    }
+    if (latencyBudget > 0.0) {
+        yInfo("Frames older than %.3f s are dropped", latencyBudget);
+    }
+
+    return true;
+}
+
+void ObjectDetectionThread::stopPipeline() {
+    // Unblock the stages waiting on a queue or on the input port before joining them
+    if (capturedQueue != nullptr) {
+        capturedQueue->close();
+        reorderBuffer->close();
+    }
+    for (auto &camera : cameras) {
+        camera->inputImagePort.interrupt();
+    }
+
+    for (auto &stage : pipelineStages) {
+        stage->stop();
+    }
+    pipelineStages.clear();
+
+    // after the dispatch stage, nothing submits batches anymore
+    if (inferenceScheduler != nullptr) {
+        inferenceScheduler->stop();
+        inferenceScheduler.reset();
+    }
+}
+
+PreprocessStats ObjectDetectionThread::getPreprocessStats() {
+    return currentDetector()->getPreprocessStats();
+}
+
+TensorPoolStats ObjectDetectionThread::getInputTensorPoolStats() {
+    return currentDetector()->getInputTensorPoolStats();
+}
+
+TileStats ObjectDetectionThread::getTileStats() {
+    return currentDetector()->getTileStats();
+}
+
+std::vector<PipelineQueueDepth> ObjectDetectionThread::getPipelineQueueDepths() {
+    std::vector<PipelineQueueDepth> depths;
+
+    if (capturedQueue == nullptr || pipelineStages.empty()) {
+        return depths;
+    }
+
+    depths.push_back({"captured", capturedQueue->size(), capturedQueue->capacity(), capturedQueue->dropped()});
+    depths.push_back({"inflight", reorderBuffer->inFlight(), reorderBuffer->capacity(), 0});
+
+    return depths;
+}
+
+bool ObjectDetectionThread::isBatchStale(const BatchPtr &t_batch) const {
+    if (latencyBudget <= 0.0) {
+        return false;
+    }
+
+    const double now = yarp::os::Time::now();
+    for (const FramePtr &frame : t_batch->frames) {
+        if (now - frame->receivedTime > latencyBudget) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ObjectDetectionThread::serialStep() {
+    const BatchPtr batch = acquireBatch();
+
+    if (batch == nullptr) {
+        // read interrupted, the thread is stopping
+        return false;
+    }
+
+    // the alignment of the cameras may have kept a frame waiting too long
+    if (isBatchStale(batch)) {
+        ++staleBatchesDropped;
+        framesDropped += batch->frames.size();
+        return true;
+    }
+
+    if (!scheduleInference(batch, true)) {
+        publishBatch(batch);
+        ++batchesPublished;
+        return true;
+    }
+
+    if (inferBatch(batch)) {
+        publishBatch(batch);
+        ++batchesPublished;
+    }
+
+    return true;
+}
+
+bool ObjectDetectionThread::captureStep() {
+    BatchPtr batch = acquireBatch();
+
+    if (batch == nullptr) {
+        // read interrupted, the pipeline is stopping
+        return false;
+    }
+
+    // A live camera must not wait for the inference, the oldest waiting frames are discarded instead
+    return capturedQueue->pushDropOldest(std::move(batch));
+}
+
+bool ObjectDetectionThread::dispatchStep() {
+    BatchPtr batch;
+    if (!capturedQueue->pop(batch)) {
+        return false;
+    }
+
+    if (isBatchStale(batch)) {
+        ++staleBatchesDropped;
+        framesDropped += batch->frames.size();
+        return true;
+    }
+
+    // a tracked batch is published at once, without waiting for the batches being inferred. An unchanged batch
+    // takes the detections of the last inferred one, it is published after the batches in flight
+    if (!scheduleInference(batch, reorderBuffer->inFlight() < static_cast<size_t>(inferenceWorkers))) {
+        if (batch->tracked) {
+            publishBatch(batch);
+            ++batchesPublished;
+            return true;
+        }
+
+        if (!reorderBuffer->reserve(batch->sequence)) {
+            return false;
+        }
+        reorderBuffer->push(batch->sequence, batch);
+        return true;
+    }
+
+    // blocks while the workers and the publish stage are busy with enough batches
+    if (!reorderBuffer->reserve(batch->sequence)) {
+        return false;
+    }
+
+    // a slow batch only holds its worker, the others keep inferring the following ones.
+    // A batch that became stale while waiting for a worker still goes through the reorder buffer, unpublished
+    return inferenceScheduler->submit([this, batch] {
+        if (isBatchStale(batch)) {
+            ++staleBatchesDropped;
+            framesDropped += batch->frames.size();
+        }
+        else {
+            inferBatch(batch);
+        }
+        reorderBuffer->push(batch->sequence, batch);
+    });
+}
+
+bool ObjectDetectionThread::publishStep() {
+    BatchPtr batch;
+    if (!reorderBuffer->pop(batch)) {
+        return false;
+    }
+
+    if (batch->inferred || batch->unchanged) {
+        publishBatch(batch);
+        ++batchesPublished;
+    }
+
+    return true;
+}
+
+bool ObjectDetectionThread::scheduleInference(const BatchPtr &t_batch, bool t_workerFree) {
+    const bool motionGating = motionGate.getConfig().enabled();
+    if (!tracking && !motionGating) {
+        return true;
+    }
+
+    // the cameras of a batch are inferred together, as soon as one of them changed or needs it for its tracks
+    bool sceneChanged = true;
+    if (motionGating) {
+        ScopedStageTimer motionTimer(&stageStatistics, Stage::MotionCheck);
+        sceneChanged = false;
+        for (const FramePtr &frame : t_batch->frames) {
+            // every frame is compared, its change mask is kept
+            if (motionGate.frameChanged(frame->cameraIndex, frame->image.getRawImage(), frame->image.getRowSize(),
+                                        frame->image.width(), frame->image.height())) {
+                sceneChanged = true;
+            }
+        }
+    }
+
+    bool inferred = sceneChanged;
+    if (tracking) {
+        bool inferenceDue = false;
+        for (const FramePtr &frame : t_batch->frames) {
+            inferenceDue = inferenceDue || objectTracker.inferenceDue(frame->cameraIndex);
+        }
+
+        inferred = sceneChanged && inferenceDue && t_workerFree;
+        for (const FramePtr &frame : t_batch->frames) {
+            objectTracker.countFrame(frame->cameraIndex, inferred);
+        }
+    }
+
+    // only the frames not inferred because of the scene count as skipped, not those left to the tracks
+    if (motionGating) {
+        for (const FramePtr &frame : t_batch->frames) {
+            if (inferred) {
+                motionGate.takeThumbnail(frame->cameraIndex, &frame->motionThumbnail);
+            }
+            else if (!sceneChanged) {
+                motionGate.countSkipped(frame->cameraIndex);
+            }
+        }
+        if (!sceneChanged) {
+            ++unchangedBatches;
+        }
+    }
+
+    // with tracking, the tracks follow the objects even through a scene seen as unchanged
+    t_batch->tracked = !inferred && tracking;
+    t_batch->unchanged = !inferred && !tracking;
+
+    return inferred;
+}
+
+void ObjectDetectionThread::trackBatch(const BatchPtr &t_batch) {
+    ScopedStageTimer trackTimer(&stageStatistics, Stage::Track);
+
+    if (!t_batch->tracked) {
+        // the tracks of another model follow other classes
+        const std::shared_ptr<const LabelTable> &labels = t_batch->frames.front()->labels;
+        if (labels.get() != trackedLabels.get()) {
+            objectTracker.reset();
+            trackedLabels = labels;
+        }
+    }
+    else if (trackedLabels == nullptr) {
+        const std::shared_ptr<tensorflowObjectDetection> detector = currentDetector();
+        trackedLabels = std::shared_ptr<const LabelTable>(detector, &detector->getLabels());
+    }
+
+    const size_t maxDetections = currentDetector()->getMaxDetections();
+    for (const FramePtr &frame : t_batch->frames) {
+        if (t_batch->tracked) {
+            objectTracker.predict(frame->cameraIndex, frame->stamp.getTime(), maxDetections,
+                                  &frame->objectsDetected);
+            frame->labels = trackedLabels;
+        }
+        else {
+            objectTracker.update(frame->cameraIndex, frame->stamp.getTime(), &frame->objectsDetected);
+        }
+
+        if (labelFormat == LabelFormat::String) {
+            frame->detectedLabels = tensorflowObjectDetection::detectionsToString(frame->objectsDetected,
+                                                                                  *frame->labels);
+        }
+    }
+}
+
+TrackerStats ObjectDetectionThread::getTrackerStats() {
+    return objectTracker.getStats();
+}
+
+MotionStats ObjectDetectionThread::getMotionStats() {
+    const MotionGateStats gateStats = motionGate.getStats();
+
+    // stages a skipped batch does not go through, their mean duration is per batch
+    double skippedBatchMs = 0.0;
+    double checkTimeMs = 0.0;
+    for (const StageSummary &summary : stageStatistics.summarize()) {
+        if (summary.stageName == stageName(Stage::MatToTensor) || summary.stageName == stageName(Stage::SessionRun) ||
+            summary.stageName == stageName(Stage::Postprocess)) {
+            skippedBatchMs += summary.meanMs;
+        }
+        else if (summary.stageName == stageName(Stage::MotionCheck)) {
+            checkTimeMs = summary.meanMs * summary.count;
+        }
+    }
+
+    const double skippedRatio = gateStats.framesChecked > 0 ?
+                                static_cast<double>(gateStats.framesSkipped) / gateStats.framesChecked : 0.0;
+
+    return {gateStats.framesChecked, gateStats.framesSkipped, skippedRatio, checkTimeMs,
+            unchangedBatches.load() * skippedBatchMs - checkTimeMs};
+}
+
+SchedulingStats ObjectDetectionThread::getSchedulingStats() {
+    const uint64_t replacedBatches = capturedQueue != nullptr ? capturedQueue->dropped() : 0;
+
+    return {achievedRate.load(), batchesPublished.load(), staleBatchesDropped.load(), replacedBatches,
+            latencyBudget};
+}
+
+LatencyPercentiles ObjectDetectionThread::getPublishLatency() {
+    return publishLatency->getPercentiles();
+}
+
+std::vector<StageSummary> ObjectDetectionThread::getStageSummaries() {
+    return stageStatistics.summarize();
+}
+
+FrameCounters ObjectDetectionThread::getFrameCounters() {
+    // the batches replaced in the captured queue are counted by the queue
+    const uint64_t replacedFrames = capturedQueue != nullptr ? capturedQueue->dropped() * cameras.size() : 0;
+
+    return {framesIn.load(), framesOut.load(), framesDropped.load() + replacedFrames};
+}
+
+void ObjectDetectionThread::writeStats(yarp::os::Bottle &t_stats) {
+    const FrameCounters frameCounters = getFrameCounters();
+    Bottle &frames = t_stats.addList();
+    frames.addString("frames");
+    frames.addInt(static_cast<int>(frameCounters.framesIn));
+    frames.addInt(static_cast<int>(frameCounters.framesOut));
+    frames.addInt(static_cast<int>(frameCounters.framesDropped));
+
+    for (const StageSummary &stage : getStageSummaries()) {
+        Bottle &stageStats = t_stats.addList();
+        stageStats.addString(stage.stageName);
+        stageStats.addInt(static_cast<int>(stage.count));
+        stageStats.addDouble(stage.meanMs);
+        stageStats.addDouble(stage.p50Ms);
+        stageStats.addDouble(stage.p90Ms);
+        stageStats.addDouble(stage.p99Ms);
+        stageStats.addDouble(stage.maxMs);
+    }
+}
+
+SchedulerStats ObjectDetectionThread::getSchedulerStats() {
+    if (inferenceScheduler == nullptr) {
+        return {0, 0, 0};
+    }
+
+    return inferenceScheduler->getStats();
+}
+
+
+
+void ObjectDetectionThread::configureClassFilter(tensorflowObjectDetection *t_detector,
+                                                 const yarp::os::Searchable &t_config) {
+    ClassFilter classFilter(static_cast<float>(t_detector->getM_detecttionThreshold()));
+
+    const Value &classThresholds = t_config.find("class_thresholds");
+    if (classThresholds.isList()) {
+        const Bottle *thresholds = classThresholds.asList();
+        for (int i = 0; i < thresholds->size(); ++i) {
+            const Bottle *classThreshold = thresholds->get(i).asList();
+            if (classThreshold != nullptr && classThreshold->size() == 2) {
+                classFilter.setClassThreshold(classThreshold->get(0).asInt(),
+                                              static_cast<float>(classThreshold->get(1).asDouble()));
+            }
+        }
+    }
+
+    const auto readClassIds = [&t_config](const std::string &t_key) {
+        std::vector<int32_t> classIds;
+        const Value &value = t_config.find(t_key);
+        if (value.isList()) {
+            for (int i = 0; i < value.asList()->size(); ++i) {
+                classIds.push_back(value.asList()->get(i).asInt());
+            }
         }
+        return classIds;
+    };
 
+    // an allow list keeps only its classes, the deny list is ignored
+    const std::vector<int32_t> allowedClasses = readClassIds("allowed_classes");
+    if (!allowedClasses.empty()) {
+        classFilter.allowClasses(allowedClasses);
     }
+    else {
+        classFilter.denyClasses(readClassIds("denied_classes"));
+    }
+    t_detector->setClassFilter(classFilter);
+
+    t_detector->setNmsIoU(static_cast<float>(t_config.check("nms_iou",
+                                                            Value(static_cast<double>(t_detector->getNmsIoU())),
+                                                            "Class-wise suppression of the graph outputs, 0 to disable (double)").asDouble()));
 }
 
 
+/************************************* MODEL SWAP  *************************************/
+
+std::shared_ptr<tensorflowObjectDetection> ObjectDetectionThread::currentDetector() const {
+    return std::atomic_load(&tfObjectDetection);
+}
 
+bool ObjectDetectionThread::requestModelSwap(const std::string &t_modelName, const std::string &t_graphPath,
+                                             const std::string &t_labelsPath) {
+    std::lock_guard<std::mutex> lock(modelSwapMutex);
+    if (modelSwapStats.loading) {
+        return false;
+    }
+
+    // the previous loader is done, it only has to be joined
+    if (modelLoader.joinable()) {
+        modelLoader.join();
+    }
+
+    modelSwapStats.loading = true;
+    modelLoader = std::thread(&ObjectDetectionThread::loadModel, this, t_modelName, t_graphPath, t_labelsPath);
+    return true;
+}
+
+ModelSwapStats ObjectDetectionThread::getModelSwapStats() {
+    std::lock_guard<std::mutex> lock(modelSwapMutex);
+    return modelSwapStats;
+}
+
+void ObjectDetectionThread::loadModel(std::string t_modelName, std::string t_graphPath, std::string t_labelsPath) {
+    const double requestTime = yarp::os::Time::now();
+    const uint64_t framesBefore = framesOut.load();
+    yInfo("Loading the model %s from %s while %s keeps serving", t_modelName.c_str(), t_graphPath.c_str(),
+          getModelSwapStats().modelName.c_str());
+
+    std::shared_ptr<tensorflowObjectDetection> previousDetector = currentDetector();
+    std::shared_ptr<tensorflowObjectDetection> nextDetector(
+            previousDetector->createForModel(t_graphPath, t_labelsPath, t_modelName).release());
+
+    tensorflow::Status swapStatus = nextDetector->initGraph();
+    const double loadedTime = yarp::os::Time::now();
+    if (swapStatus.ok()) {
+        swapStatus = nextDetector->warmUp(swapWarmupRuns);
+    }
+
+    if (!swapStatus.ok()) {
+        yError("Unable to load the model %s, %s keeps serving : %s", t_modelName.c_str(),
+               getModelSwapStats().modelName.c_str(), swapStatus.ToString().c_str());
+
+        std::lock_guard<std::mutex> lock(modelSwapMutex);
+        modelSwapStats.loading = false;
+        modelSwapStats.lastError = swapStatus.error_message();
+        return;
+    }
+
+    // a threshold set while loading applies to the new model too
+    nextDetector->setM_detectionThreshold(previousDetector->getM_detecttionThreshold());
+
+    std::lock_guard<std::mutex> lock(modelSwapMutex);
+    switchTime = yarp::os::Time::now();
+    swappedDetector = nextDetector.get();
+    awaitingSwappedModel = true;
+    std::atomic_store(&tfObjectDetection, nextDetector);
+
+    modelSwapStats.modelName = t_modelName;
+    modelSwapStats.loading = false;
+    modelSwapStats.lastError.clear();
+    modelSwapStats.loadTimeMs = (loadedTime - requestTime) * 1000.0;
+    modelSwapStats.warmupTimeMs = (switchTime - loadedTime) * 1000.0;
+    modelSwapStats.switchLatencyMs = 0.0;
+    modelSwapStats.framesServedDuringLoad = framesOut.load() - framesBefore;
+
+    graphPath = t_graphPath;
+    labelsPath = t_labelsPath;
+    modelName = t_modelName;
+
+    yInfo("Switched to the model %s : loaded in %.1f ms, warmed up in %.1f ms, %llu frames served meanwhile",
+          t_modelName.c_str(), modelSwapStats.loadTimeMs, modelSwapStats.warmupTimeMs,
+          (unsigned long long) modelSwapStats.framesServedDuringLoad);
+
+    // previousDetector is released here, the model is freed with the last batch still inferred by it
+}
+
+
+
+/************************************* BENCHMARK  *************************************/
+
+bool ObjectDetectionThread::runScalingBenchmark(int t_maxWorkers, int t_frameCount, const std::string &t_imagePath) {
+    tensorflow::Status initGraphStatus = tfObjectDetection->initGraph();
+    if (!initGraphStatus.ok()) {
+        yError("%s", initGraphStatus.ToString().c_str());
+        return false;
+    }
+
+    cv::Mat benchmarkImage;
+    if (!t_imagePath.empty()) {
+        benchmarkImage = cv::imread(t_imagePath);
+    }
+    if (benchmarkImage.empty()) {
+        benchmarkImage = cv::Mat(cameraHeight, cameraWidth, CV_8UC3);
+        cv::randu(benchmarkImage, cv::Scalar::all(0), cv::Scalar::all(255));
+    }
+
+    // the graph is processed for the same image by several workers, every run gets its own tensors
+    auto inferImage = [this, &benchmarkImage]() {
+        tensorflow::Tensor inputTensor;
+        std::vector<ResizeGeometry> geometries;
+        std::vector<tensorflow::Tensor> outputs;
+        DetectionBuffer objectsDetected;
+
+        if (tfObjectDetection->imagesToTensor({benchmarkImage}, &inputTensor, &geometries).ok() &&
+            tfObjectDetection->runGraph(inputTensor, &outputs).ok()) {
+            tfObjectDetection->extractDetections(outputs, 0, geometries[0], &objectsDetected);
+        }
+    };
+
+    // the first runs of a session are slower, they are not measured
+    for (int i = 0; i < tfObjectDetection->getSessionCount(); ++i) {
+        inferImage();
+    }
+
+    yInfo("Scaling benchmark : %d frames of %dx%d per run, %d sessions", t_frameCount, benchmarkImage.cols,
+          benchmarkImage.rows, tfObjectDetection->getSessionCount());
+    yInfo("workers   frames/s   speedup   mean run time (ms)");
+
+    double singleWorkerRate = 0.0;
+    for (int workers = 1; workers <= t_maxWorkers; ++workers) {
+        WorkStealingScheduler scheduler(static_cast<size_t>(workers));
+        if (!scheduler.start()) {
+            yError("Unable to start %d workers", workers);
+            return false;
+        }
+
+        std::mutex doneMutex;
+        std::condition_variable allDone;
+        int remainingFrames = t_frameCount;
+        double totalRunTimeMs = 0.0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < t_frameCount; ++i) {
+            scheduler.submit([&] {
+                const auto runStart = std::chrono::steady_clock::now();
+                inferImage();
+                const double runTimeMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - runStart).count();
+
+                std::lock_guard<std::mutex> lock(doneMutex);
+                totalRunTimeMs += runTimeMs;
+                if (--remainingFrames == 0) {
+                    allDone.notify_one();
+                }
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            allDone.wait(lock, [&] { return remainingFrames == 0; });
+        }
+        const double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        scheduler.stop();
+
+        const double frameRate = t_frameCount / elapsedS;
+        if (workers == 1) {
+            singleWorkerRate = frameRate;
+        }
+
+        yInfo("%7d   %8.2f   %7.2f   %18.2f", workers, frameRate, frameRate / singleWorkerRate,
+              totalRunTimeMs / t_frameCount);
+    }
+
+    return true;
+}
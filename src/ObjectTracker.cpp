@@ -0,0 +1,267 @@
+#include "iCub/ObjectTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+
+// Coordinates followed by the tracks : centre x, centre y, width, height
+static void boxMeasurements(const Detection &t_detection, double *t_measurements) {
+    t_measurements[0] = (t_detection.box[0] + t_detection.box[2]) / 2.0;
+    t_measurements[1] = (t_detection.box[1] + t_detection.box[3]) / 2.0;
+    t_measurements[2] = t_detection.box[2] - t_detection.box[0];
+    t_measurements[3] = t_detection.box[3] - t_detection.box[1];
+}
+
+
+ObjectTracker::ObjectTracker() : m_config({1, 0.3f, 0.5f, 2, 500.0, 4.0}), m_nextTrackId(1), m_framesInferred(0),
+                                 m_framesTracked(0), m_framesSuperseded(0) {
+}
+
+void ObjectTracker::configure(const TrackerConfig &t_config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = t_config;
+    m_sources.clear();
+}
+
+TrackerConfig ObjectTracker::getConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+bool ObjectTracker::inferenceDue(size_t t_source) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto source = m_sources.find(t_source);
+    if (source == m_sources.end() || source->second.framesSinceInference + 1 >= m_config.inferencePeriod) {
+        return true;
+    }
+
+    for (const Track &track : source->second.tracks) {
+        if (track.missed == 0 && track.confidence < m_config.minConfidence) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ObjectTracker::countFrame(size_t t_source, bool t_inferred) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SourceTracks &source = m_sources[t_source];
+    if (t_inferred) {
+        source.framesSinceInference = 0;
+        ++m_framesInferred;
+    }
+    else {
+        ++source.framesSinceInference;
+        ++m_framesTracked;
+    }
+}
+
+void ObjectTracker::countSuperseded() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_framesSuperseded;
+}
+
+Detection ObjectTracker::predictedDetection(const Track &t_track, double t_time) const {
+    const double elapsed = std::max(0.0, t_time - t_track.time);
+
+    double box[4];
+    for (int a = 0; a < 4; ++a) {
+        box[a] = t_track.axes[a].position + t_track.axes[a].velocity * elapsed;
+    }
+    const double halfWidth = std::max(1.0, box[2]) / 2.0;
+    const double halfHeight = std::max(1.0, box[3]) / 2.0;
+
+    return {t_track.classId, t_track.id, t_track.score,
+            {static_cast<int32_t>(std::lround(box[0] - halfWidth)),
+             static_cast<int32_t>(std::lround(box[1] - halfHeight)),
+             static_cast<int32_t>(std::lround(box[0] + halfWidth)),
+             static_cast<int32_t>(std::lround(box[1] + halfHeight))}};
+}
+
+void ObjectTracker::correctAxis(AxisState *t_axis, double t_elapsed, double t_measurement) const {
+    const double dt = t_elapsed;
+    const double accelerationVariance = m_config.processNoise * m_config.processNoise;
+    const double measurementVariance = m_config.measurementNoise * m_config.measurementNoise;
+
+    // prediction, constant velocity with a random acceleration
+    t_axis->position += t_axis->velocity * dt;
+    t_axis->positionVariance += 2.0 * dt * t_axis->covariance + dt * dt * t_axis->velocityVariance +
+                                accelerationVariance * dt * dt * dt * dt / 4.0;
+    t_axis->covariance += dt * t_axis->velocityVariance + accelerationVariance * dt * dt * dt / 2.0;
+    t_axis->velocityVariance += accelerationVariance * dt * dt;
+
+    // correction by the measured position
+    const double innovationVariance = t_axis->positionVariance + measurementVariance;
+    const double positionGain = t_axis->positionVariance / innovationVariance;
+    const double velocityGain = t_axis->covariance / innovationVariance;
+    const double innovation = t_measurement - t_axis->position;
+
+    t_axis->position += positionGain * innovation;
+    t_axis->velocity += velocityGain * innovation;
+    t_axis->velocityVariance -= velocityGain * t_axis->covariance;
+    t_axis->positionVariance *= 1.0 - positionGain;
+    t_axis->covariance *= 1.0 - positionGain;
+}
+
+ObjectTracker::Track ObjectTracker::createTrack(const Detection &t_detection, double t_time) {
+    double measurements[4];
+    boxMeasurements(t_detection, measurements);
+
+    Track track;
+    track.id = m_nextTrackId++;
+    track.classId = t_detection.classId;
+    track.score = t_detection.score;
+    track.time = t_time;
+    track.confidence = 0.0f;        // the motion is unknown, the next frame is inferred to measure it
+    track.missed = 0;
+
+    // the velocity is unknown until the second detection, up to what a second of acceleration gives
+    for (int a = 0; a < 4; ++a) {
+        track.axes[a] = {measurements[a], 0.0, m_config.measurementNoise * m_config.measurementNoise, 0.0,
+                         m_config.processNoise * m_config.processNoise};
+    }
+
+    return track;
+}
+
+void ObjectTracker::update(size_t t_source, double t_time, DetectionBuffer *t_objectsDetected) {
+    // scratch storage reused by the calls of a thread
+    static thread_local std::vector<Detection> predicted;
+    static thread_local std::vector<std::tuple<float, size_t, size_t> > pairs;
+    static thread_local std::vector<bool> trackMatched;
+    static thread_local std::vector<bool> detectionMatched;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Track> &tracks = m_sources[t_source].tracks;
+    const DetectionBuffer &detections = *t_objectsDetected;
+
+    // candidate associations of each detection with the tracks of its class, the best overlaps first
+    predicted.clear();
+    pairs.clear();
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        predicted.push_back(predictedDetection(tracks[t], t_time));
+        for (size_t d = 0; d < detections.size(); ++d) {
+            if (detections[d].classId != tracks[t].classId) {
+                continue;
+            }
+
+            const float overlap = detectionIoU(predicted[t], detections[d]);
+            if (overlap > m_config.matchIoU) {
+                pairs.emplace_back(overlap, t, d);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const std::tuple<float, size_t, size_t> &t_a,
+                                             const std::tuple<float, size_t, size_t> &t_b) {
+        return std::get<0>(t_a) > std::get<0>(t_b);
+    });
+
+    trackMatched.assign(tracks.size(), false);
+    detectionMatched.assign(detections.size(), false);
+    for (const std::tuple<float, size_t, size_t> &pair : pairs) {
+        const size_t t = std::get<1>(pair);
+        const size_t d = std::get<2>(pair);
+        if (trackMatched[t] || detectionMatched[d]) {
+            continue;
+        }
+        trackMatched[t] = true;
+        detectionMatched[d] = true;
+
+        Track &track = tracks[t];
+        const Detection &detection = detections[d];
+        double measurements[4];
+        boxMeasurements(detection, measurements);
+        const double elapsed = std::max(0.0, t_time - track.time);
+        for (int a = 0; a < 4; ++a) {
+            correctAxis(&track.axes[a], elapsed, measurements[a]);
+        }
+        track.time = std::max(track.time, t_time);
+        track.score = detection.score;
+        track.confidence = std::get<0>(pair);
+        track.missed = 0;
+    }
+
+    // the tracks not detected are kept for a few inferences, an occluded object gets its id back
+    size_t kept = 0;
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        if (!trackMatched[t] && ++tracks[t].missed > m_config.maxMissed) {
+            continue;
+        }
+        tracks[kept++] = tracks[t];
+    }
+    tracks.resize(kept);
+
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (!detectionMatched[d]) {
+            tracks.push_back(createTrack(detections[d], t_time));
+        }
+    }
+
+    // output in the order of the detections, by decreasing score
+    predicted.clear();
+    for (const Track &track : tracks) {
+        if (track.missed == 0) {
+            predicted.push_back(predictedDetection(track, t_time));
+        }
+    }
+    std::stable_sort(predicted.begin(), predicted.end(), [](const Detection &t_a, const Detection &t_b) {
+        return t_a.score > t_b.score;
+    });
+
+    t_objectsDetected->reset(t_objectsDetected->capacity());
+    for (const Detection &detection : predicted) {
+        t_objectsDetected->push(detection);
+    }
+}
+
+void ObjectTracker::predict(size_t t_source, double t_time, size_t t_maxDetections,
+                            DetectionBuffer *t_objectsDetected) const {
+    static thread_local std::vector<Detection> predicted;
+    predicted.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto source = m_sources.find(t_source);
+        if (source != m_sources.end()) {
+            for (const Track &track : source->second.tracks) {
+                if (track.missed == 0) {
+                    predicted.push_back(predictedDetection(track, t_time));
+                }
+            }
+        }
+    }
+
+    std::stable_sort(predicted.begin(), predicted.end(), [](const Detection &t_a, const Detection &t_b) {
+        return t_a.score > t_b.score;
+    });
+
+    t_objectsDetected->reset(t_maxDetections);
+    for (const Detection &detection : predicted) {
+        t_objectsDetected->push(detection);
+    }
+}
+
+void ObjectTracker::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &source : m_sources) {
+        source.second.tracks.clear();
+    }
+}
+
+TrackerStats ObjectTracker::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t activeTracks = 0;
+    for (const auto &source : m_sources) {
+        for (const Track &track : source.second.tracks) {
+            activeTracks += track.missed == 0;
+        }
+    }
+
+    return {m_framesInferred, m_framesTracked, m_framesSuperseded, static_cast<uint64_t>(m_nextTrackId - 1),
+            activeTracks};
+}
@@ -0,0 +1,22 @@
+#include <utility>
+#include <yarp/os/Log.h>
+
+#include "../include/iCub/PipelineStage.h"
+
+PipelineStage::PipelineStage(std::string t_stageName, std::function<bool()> t_step)
+        : stageName(std::move(t_stageName)), step(std::move(t_step)) {
+}
+
+void PipelineStage::run() {
+    while (!isStopping()) {
+        if (!step()) {
+            break;
+        }
+    }
+
+    yInfo("Pipeline stage %s ended", stageName.c_str());
+}
+
+const std::string &PipelineStage::getStageName() const {
+    return stageName;
+}
@@ -0,0 +1,140 @@
+#include "iCub/SessionTuning.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <tensorflow/core/platform/cpu_info.h>
+#include <tensorflow/core/platform/host_info.h>
+
+
+TuningObjective parseTuningObjective(const std::string &t_objective) {
+    if (t_objective == "latency") {
+        return TuningObjective::Latency;
+    }
+    if (t_objective == "throughput") {
+        return TuningObjective::Throughput;
+    }
+
+    return TuningObjective::None;
+}
+
+
+void applyThreadingConfig(const ThreadingConfig &t_config, int t_sessionCount, tensorflow::SessionOptions *t_options) {
+    int intraOpThreads = t_config.intraOpThreads;
+    int interOpThreads = t_config.interOpThreads;
+
+    if (intraOpThreads <= 0 && t_sessionCount > 1) {
+        // each session gets its share of the cores instead of all of them competing for every core
+        intraOpThreads = std::max(1, tensorflow::port::NumSchedulableCPUs() / t_sessionCount);
+        interOpThreads = interOpThreads > 0 ? interOpThreads : 1;
+    }
+
+    if (intraOpThreads > 0) {
+        t_options->config.set_intra_op_parallelism_threads(intraOpThreads);
+    }
+    if (interOpThreads > 0) {
+        t_options->config.set_inter_op_parallelism_threads(interOpThreads);
+    }
+    t_options->config.set_use_per_session_threads(t_config.perSessionThreads);
+}
+
+
+std::vector<ThreadingConfig> buildThreadingGrid(int t_cores, int t_sessionCount) {
+    const int coresPerSession = std::max(1, t_cores / std::max(1, t_sessionCount));
+
+    std::vector<int> intraOpCandidates;
+    for (int threads = 1; threads < coresPerSession; threads *= 2) {
+        intraOpCandidates.push_back(threads);
+    }
+    intraOpCandidates.push_back(coresPerSession);
+
+    std::vector<int> interOpCandidates;
+    for (int threads = 1; threads <= std::min(4, coresPerSession); threads *= 2) {
+        interOpCandidates.push_back(threads);
+    }
+
+    std::vector<ThreadingConfig> grid;
+    for (const bool perSessionThreads : {false, true}) {
+        for (const int intraOpThreads : intraOpCandidates) {
+            for (const int interOpThreads : interOpCandidates) {
+                grid.push_back({intraOpThreads, interOpThreads, perSessionThreads});
+            }
+        }
+    }
+
+    return grid;
+}
+
+
+size_t selectBestThreading(const std::vector<TuningResult> &t_results, TuningObjective t_objective) {
+    size_t best = 0;
+    for (size_t i = 1; i < t_results.size(); ++i) {
+        const bool better = t_objective == TuningObjective::Throughput
+                            ? t_results[i].framesPerSecond > t_results[best].framesPerSecond
+                            : t_results[i].p50LatencyMs < t_results[best].p50LatencyMs;
+        if (better) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+
+std::string threadingCacheKey(uint64_t t_graphHash, const tensorflow::TensorShape &t_inputShape, int t_sessionCount,
+                              int t_concurrency, TuningObjective t_objective) {
+    std::ostringstream key;
+    key << tensorflow::port::Hostname() << ":" << std::hex << t_graphHash << std::dec << ":";
+    for (int i = 0; i < t_inputShape.dims(); ++i) {
+        key << (i > 0 ? "x" : "") << t_inputShape.dim_size(i);
+    }
+    key << ":" << t_sessionCount << ":" << t_concurrency << ":"
+        << (t_objective == TuningObjective::Throughput ? "throughput" : "latency");
+
+    return key.str();
+}
+
+
+bool readThreadingCache(const std::string &t_cachePath, const std::string &t_key, ThreadingConfig *t_config) {
+    std::ifstream file(t_cachePath);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        ThreadingConfig config;
+        if (fields >> key >> config.intraOpThreads >> config.interOpThreads >> config.perSessionThreads &&
+            key == t_key) {
+            *t_config = config;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool writeThreadingCache(const std::string &t_cachePath, const std::string &t_key, const ThreadingConfig &t_config) {
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(t_cachePath);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, t_key.size() + 1, t_key + " ") != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::ostringstream newLine;
+    newLine << t_key << " " << t_config.intraOpThreads << " " << t_config.interOpThreads << " "
+            << t_config.perSessionThreads;
+    lines.push_back(newLine.str());
+
+    std::ofstream file(t_cachePath, std::ios::trunc);
+    for (const std::string &line : lines) {
+        file << line << "\n";
+    }
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include "../include/iCub/StageStatistics.h"
+
+const size_t StageHistogram::BucketCount;
+
+// Histograms of the current thread in each statistics, found without lock once registered
+namespace {
+    struct ThreadHistogramsEntry {
+        uint64_t statisticsId;
+        void *histograms;
+    };
+
+    thread_local std::vector<ThreadHistogramsEntry> threadHistogramsEntries;
+
+    std::atomic<uint64_t> nextStatisticsId(1);
+
+    const size_t stageCount = static_cast<size_t>(Stage::Count);
+}
+
+
+const char *stageName(Stage t_stage) {
+    switch (t_stage) {
+        case Stage::PortRead:
+            return "port_read";
+        case Stage::ColourConversion:
+            return "colour_conversion";
+        case Stage::MatToTensor:
+            return "mat_to_tensor";
+        case Stage::SessionRun:
+            return "session_run";
+        case Stage::Postprocess:
+            return "postprocess";
+        case Stage::DrawBoxes:
+            return "draw_boxes";
+        case Stage::PortWrite:
+            return "port_write";
+        case Stage::Track:
+            return "track";
+        case Stage::MotionCheck:
+            return "motion";
+        default:
+            return "unknown";
+    }
+}
+
+
+/************************************* HISTOGRAM  *************************************/
+
+StageHistogram::StageHistogram() : m_sum(0), m_max(0) {
+    for (auto &count : m_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t StageHistogram::bucketIndex(uint64_t t_nanoseconds) {
+    const uint64_t linearLimit = 1u << (SubBucketBits + 1);
+    if (t_nanoseconds < linearLimit) {
+        return static_cast<size_t>(t_nanoseconds);
+    }
+
+    const int exponent = 63 - __builtin_clzll(t_nanoseconds);
+    if (exponent >= MaxExponent) {
+        return BucketCount - 1;
+    }
+
+    // the bits following the leading one select the bucket inside the power of two
+    const uint64_t subBucket = (t_nanoseconds >> (exponent - SubBucketBits)) & ((1u << SubBucketBits) - 1);
+    return static_cast<size_t>(linearLimit + (exponent - SubBucketBits - 1) * (1u << SubBucketBits) + subBucket);
+}
+
+double StageHistogram::bucketValue(size_t t_index) {
+    const size_t linearLimit = 1u << (SubBucketBits + 1);
+    if (t_index < linearLimit) {
+        return static_cast<double>(t_index);
+    }
+
+    const int exponent = SubBucketBits + 1 + static_cast<int>((t_index - linearLimit) >> SubBucketBits);
+    const uint64_t subBucket = (t_index - linearLimit) & ((1u << SubBucketBits) - 1);
+    const uint64_t width = 1ull << (exponent - SubBucketBits);
+
+    return static_cast<double>(((1ull << SubBucketBits) + subBucket) * width) + width / 2.0;
+}
+
+void StageHistogram::record(uint64_t t_nanoseconds) {
+    // single writer : plain load and store, no read-modify-write needed
+    std::atomic<uint64_t> &count = m_counts[bucketIndex(t_nanoseconds)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_sum.store(m_sum.load(std::memory_order_relaxed) + t_nanoseconds, std::memory_order_relaxed);
+    if (t_nanoseconds > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(t_nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void StageHistogram::mergeInto(std::vector<uint64_t> &t_counts, uint64_t &t_sum, uint64_t &t_max) const {
+    for (size_t i = 0; i < BucketCount; ++i) {
+        t_counts[i] += m_counts[i].load(std::memory_order_relaxed);
+    }
+    t_sum += m_sum.load(std::memory_order_relaxed);
+    t_max = std::max(t_max, m_max.load(std::memory_order_relaxed));
+}
+
+
+/************************************* STATISTICS  *************************************/
+
+StageStatistics::StageStatistics() : m_id(nextStatisticsId++) {
+}
+
+StageStatistics::ThreadHistograms &StageStatistics::getThreadHistograms() {
+    // the id and not the address identifies the statistics, a new one may reuse the address of a deleted one
+    for (const ThreadHistogramsEntry &entry : threadHistogramsEntries) {
+        if (entry.statisticsId == m_id) {
+            return *static_cast<ThreadHistograms *>(entry.histograms);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    m_threads.emplace_back(new ThreadHistograms);
+    threadHistogramsEntries.push_back({m_id, m_threads.back().get()});
+
+    return *m_threads.back();
+}
+
+void StageStatistics::record(Stage t_stage, uint64_t t_nanoseconds) {
+    getThreadHistograms().stages[static_cast<size_t>(t_stage)].record(t_nanoseconds);
+}
+
+std::vector<StageSummary> StageStatistics::summarize() const {
+    std::vector<StageSummary> summaries;
+
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    for (size_t stage = 0; stage < stageCount; ++stage) {
+        std::vector<uint64_t> counts(StageHistogram::BucketCount, 0);
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        for (const auto &thread : m_threads) {
+            thread->stages[stage].mergeInto(counts, sum, max);
+        }
+
+        uint64_t total = 0;
+        for (const uint64_t count : counts) {
+            total += count;
+        }
+
+        // walk the buckets once for the three percentiles
+        const double ranks[] = {0.50, 0.90, 0.99};
+        double percentilesNs[] = {0.0, 0.0, 0.0};
+        uint64_t seen = 0;
+        size_t rank = 0;
+        for (size_t i = 0; i < counts.size() && rank < 3 && total > 0; ++i) {
+            seen += counts[i];
+            while (rank < 3 && seen >= static_cast<uint64_t>(ranks[rank] * total + 0.5) && seen > 0) {
+                percentilesNs[rank++] = std::min(StageHistogram::bucketValue(i), static_cast<double>(max));
+            }
+        }
+
+        const double nsToMs = 1e-6;
+        summaries.push_back({stageName(static_cast<Stage>(stage)), total,
+                             total > 0 ? sum * nsToMs / total : 0.0, percentilesNs[0] * nsToMs,
+                             percentilesNs[1] * nsToMs, percentilesNs[2] * nsToMs, max * nsToMs});
+    }
+
+    return summaries;
+}
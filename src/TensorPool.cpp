@@ -0,0 +1,95 @@
+#include "iCub/TensorPool.h"
+
+#include <algorithm>
+
+using tensorflow::Tensor;
+using tensorflow::TensorShape;
+
+
+TensorPool::TensorPool(tensorflow::DataType t_dataType) : m_dataType(t_dataType), m_hits(0), m_misses(0),
+                                                          m_bytesAllocated(0) {
+}
+
+
+TensorPool::ShapeKey TensorPool::shapeToKey(const TensorShape &t_shape) {
+    // FNV-1a over the dimensions
+    ShapeKey key = 14695981039346656037ULL;
+    for (int i = 0; i < t_shape.dims(); ++i) {
+        key = (key ^ static_cast<uint64_t>(t_shape.dim_size(i))) * 1099511628211ULL;
+    }
+
+    return key;
+}
+
+
+Tensor TensorPool::allocate(const TensorShape &t_shape) {
+    Tensor tensor(m_dataType, t_shape);
+    m_bytesAllocated += tensor.TotalBytes();
+
+    return tensor;
+}
+
+
+void TensorPool::reserve(const TensorShape &t_shape, size_t t_count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Tensor> &freeTensors = m_freeTensors[shapeToKey(t_shape)];
+    freeTensors.reserve(std::max(freeTensors.capacity(), 2 * t_count));
+    while (freeTensors.size() < t_count) {
+        freeTensors.push_back(allocate(t_shape));
+    }
+}
+
+
+Tensor TensorPool::acquire(const TensorShape &t_shape) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto shapeTensors = m_freeTensors.find(shapeToKey(t_shape));
+    if (shapeTensors != m_freeTensors.end()) {
+        std::vector<Tensor> &freeTensors = shapeTensors->second;
+
+        // A tensor still referenced elsewhere (e.g. kept by a caller after release) must not be overwritten
+        for (auto it = freeTensors.begin(); it != freeTensors.end(); ++it) {
+            if (it->RefCountIsOne() && it->shape() == t_shape) {
+                Tensor tensor = *it;
+                freeTensors.erase(it);
+                ++m_hits;
+                return tensor;
+            }
+        }
+    }
+
+    ++m_misses;
+    return allocate(t_shape);
+}
+
+
+void TensorPool::release(Tensor &t_tensor) {
+    if (!t_tensor.IsInitialized() || t_tensor.dtype() != m_dataType) {
+        t_tensor = Tensor();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // a shape first seen here gets its free list, the following releases reuse it
+    const ShapeKey key = shapeToKey(t_tensor.shape());
+    auto shapeTensors = m_freeTensors.find(key);
+    if (shapeTensors == m_freeTensors.end()) {
+        shapeTensors = m_freeTensors.emplace(key, std::vector<Tensor>()).first;
+    }
+    shapeTensors->second.push_back(t_tensor);
+    t_tensor = Tensor();
+}
+
+
+TensorPoolStats TensorPool::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t pooledTensors = 0;
+    for (const auto &it : m_freeTensors) {
+        pooledTensors += it.second.size();
+    }
+
+    return {m_hits, m_misses, m_bytesAllocated, pooledTensors};
+}
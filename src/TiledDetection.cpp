@@ -0,0 +1,167 @@
+#include "iCub/TiledDetection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "iCub/DetectionKernels.h"
+
+
+// Side of the grey thumbnail sampled in each tile to detect its changes
+static const int kThumbnailSize = 16;
+
+
+std::vector<ImageTile> computeTiles(int t_width, int t_height, int t_columns, int t_rows, double t_overlap) {
+    const int columns = std::max(1, t_columns);
+    const int rows = std::max(1, t_rows);
+    const double overlap = std::max(0.0, std::min(t_overlap, 0.9));
+
+    // n tiles overlapping by o cover n - (n - 1) o tiles
+    const int tileWidth = std::min(t_width, static_cast<int>(std::ceil(t_width / (columns - (columns - 1) * overlap))));
+    const int tileHeight = std::min(t_height, static_cast<int>(std::ceil(t_height / (rows - (rows - 1) * overlap))));
+
+    std::vector<ImageTile> tiles;
+    for (int r = 0; r < rows; ++r) {
+        const int y = rows > 1 ? static_cast<int>(std::lround(r * (t_height - tileHeight) / double(rows - 1))) : 0;
+        for (int c = 0; c < columns; ++c) {
+            const int x = columns > 1 ? static_cast<int>(std::lround(c * (t_width - tileWidth) / double(columns - 1))) : 0;
+            tiles.push_back({x, y, tileWidth, tileHeight});
+        }
+    }
+
+    return tiles;
+}
+
+// Grey level of a grid of pixels of the tile
+static void sampleThumbnail(const uint8_t *t_pixels, size_t t_stride, const ImageTile &t_tile,
+                            std::vector<uint8_t> *t_thumbnail) {
+    t_thumbnail->resize(kThumbnailSize * kThumbnailSize);
+    sampleGreyThumbnail(t_pixels + t_tile.y * t_stride + 3 * t_tile.x, t_stride, t_tile.width, t_tile.height,
+                        t_thumbnail->data(), kThumbnailSize, kThumbnailSize);
+}
+
+static double meanAbsoluteDifference(const std::vector<uint8_t> &t_first, const std::vector<uint8_t> &t_second) {
+    int sum = 0;
+    for (size_t i = 0; i < t_first.size(); ++i) {
+        sum += std::abs(t_first[i] - t_second[i]);
+    }
+
+    return static_cast<double>(sum) / t_first.size();
+}
+
+
+TileCache::TileCache() : m_config({1, 1, 0.0, 0.5f, 0.0, 0}), m_nextSequence(1), m_frames(0), m_tilesInferred(0),
+                         m_tilesSkipped(0) {
+}
+
+void TileCache::configure(const TilingConfig &t_config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = t_config;
+    m_sources.clear();
+}
+
+TilingConfig TileCache::getConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+TileCache::SourceTiles &TileCache::sourceTiles(size_t t_source, int t_width, int t_height, size_t t_tileCount) {
+    SourceTiles &source = m_sources[t_source];
+    if (source.width != t_width || source.height != t_height || source.cached.size() != t_tileCount) {
+        source.width = t_width;
+        source.height = t_height;
+        source.thumbnails.assign(t_tileCount, std::vector<uint8_t>());
+        source.skippedFrames.assign(t_tileCount, 0);
+        source.detections.assign(t_tileCount, std::vector<Detection>());
+        source.detectionSequences.assign(t_tileCount, 0);
+        source.cached.assign(t_tileCount, false);
+    }
+
+    return source;
+}
+
+void TileCache::selectTiles(size_t t_source, const uint8_t *t_pixels, size_t t_stride, int t_width, int t_height,
+                            TiledFrame *t_frame) {
+    const TilingConfig config = getConfig();
+
+    t_frame->source = t_source;
+    t_frame->imageWidth = t_width;
+    t_frame->imageHeight = t_height;
+    t_frame->tiles = computeTiles(t_width, t_height, config.columns, config.rows, config.overlap);
+    t_frame->inferredTiles.clear();
+
+    // the thumbnails are sampled outside of the lock, the other sources are not delayed
+    std::vector<std::vector<uint8_t> > thumbnails(t_frame->tiles.size());
+    if (config.changeThreshold > 0.0) {
+        for (size_t t = 0; t < t_frame->tiles.size(); ++t) {
+            sampleThumbnail(t_pixels, t_stride, t_frame->tiles[t], &thumbnails[t]);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SourceTiles &source = sourceTiles(t_source, t_width, t_height, t_frame->tiles.size());
+    t_frame->sequence = m_nextSequence++;
+
+    for (size_t t = 0; t < t_frame->tiles.size(); ++t) {
+        const bool unchanged = config.changeThreshold > 0.0 && source.cached[t] &&
+                               source.skippedFrames[t] < config.refreshFrames &&
+                               meanAbsoluteDifference(thumbnails[t], source.thumbnails[t]) < config.changeThreshold;
+        if (unchanged) {
+            ++source.skippedFrames[t];
+            ++m_tilesSkipped;
+            continue;
+        }
+
+        // compared with the content the tile is inferred on, a slow drift is caught once it adds up
+        source.thumbnails[t].swap(thumbnails[t]);
+        source.skippedFrames[t] = 0;
+        t_frame->inferredTiles.push_back(static_cast<int>(t));
+        ++m_tilesInferred;
+    }
+    ++m_frames;
+}
+
+void TileCache::mergeTiles(const TiledFrame &t_frame, const std::vector<std::vector<Detection> > &t_tileDetections,
+                           size_t t_maxDetections, DetectionBuffer *t_objectsDetected) {
+    static thread_local std::vector<Detection> candidates;
+    candidates.clear();
+
+    float mergeIoU = 0.5f;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        mergeIoU = m_config.mergeIoU;
+        SourceTiles &source = sourceTiles(t_frame.source, t_frame.imageWidth, t_frame.imageHeight,
+                                          t_frame.tiles.size());
+
+        // a tile already holding the detections of a later frame keeps them, this frame uses its own
+        static thread_local std::vector<bool> ownTiles;
+        ownTiles.assign(t_frame.tiles.size(), false);
+        if (t_tileDetections.size() == t_frame.inferredTiles.size()) {
+            for (size_t k = 0; k < t_frame.inferredTiles.size(); ++k) {
+                const int t = t_frame.inferredTiles[k];
+                if (source.cached[t] && source.detectionSequences[t] > t_frame.sequence) {
+                    candidates.insert(candidates.end(), t_tileDetections[k].begin(), t_tileDetections[k].end());
+                    ownTiles[t] = true;
+                    continue;
+                }
+
+                source.detections[t] = t_tileDetections[k];
+                source.detectionSequences[t] = t_frame.sequence;
+                source.cached[t] = true;
+            }
+        }
+
+        for (size_t t = 0; t < source.detections.size(); ++t) {
+            if (!ownTiles[t]) {
+                candidates.insert(candidates.end(), source.detections[t].begin(), source.detections[t].end());
+            }
+        }
+    }
+
+    nonMaxSuppression(&candidates, mergeIoU, t_maxDetections, t_objectsDetected);
+}
+
+TileStats TileCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_frames, m_tilesInferred, m_tilesSkipped};
+}
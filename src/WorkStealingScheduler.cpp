@@ -0,0 +1,149 @@
+#include <string>
+#include <utility>
+
+#include "../include/iCub/WorkStealingScheduler.h"
+
+// Worker running on the current thread, used to keep the tasks submitted by a task on the same worker
+static thread_local const WorkStealingScheduler *currentScheduler = nullptr;
+static thread_local size_t currentWorkerIndex = 0;
+
+
+WorkStealingScheduler::WorkStealingScheduler(size_t t_workerCount) : m_pendingTasks(0), m_stopped(false),
+                                                                     m_nextQueue(0), m_executed(0), m_stolen(0) {
+    const size_t workerCount = t_workerCount > 0 ? t_workerCount : 1;
+    for (size_t i = 0; i < workerCount; ++i) {
+        m_queues.emplace_back(new WorkerQueue);
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+    stop();
+}
+
+bool WorkStealingScheduler::start() {
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        m_workers.emplace_back(new PipelineStage("worker" + std::to_string(i), [this, i] { return workerStep(i); }));
+        if (!m_workers.back()->start()) {
+            stop();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void WorkStealingScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopped = true;
+        m_wakeUp.notify_all();
+    }
+
+    for (auto &worker : m_workers) {
+        worker->stop();
+    }
+    m_workers.clear();
+
+    // a task accepted by submit always runs, the callers may wait for it. No task is queued after the stop
+    for (auto &queue : m_queues) {
+        std::deque<Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            tasks.swap(queue->tasks);
+        }
+
+        for (Task &task : tasks) {
+            task();
+            ++m_executed;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_pendingTasks = 0;
+}
+
+bool WorkStealingScheduler::submit(Task t_task) {
+    const size_t queueIndex = currentScheduler == this ? currentWorkerIndex : m_nextQueue++ % m_queues.size();
+
+    // checked and queued under the same lock, stop can not come in between and miss the task
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (m_stopped) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> queueLock(m_queues[queueIndex]->mutex);
+        m_queues[queueIndex]->tasks.push_back(std::move(t_task));
+    }
+
+    // counted once queued, a worker woken up always finds it
+    ++m_pendingTasks;
+    m_wakeUp.notify_one();
+
+    return true;
+}
+
+bool WorkStealingScheduler::workerStep(size_t t_workerIndex) {
+    currentScheduler = this;
+    currentWorkerIndex = t_workerIndex;
+
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeUp.wait(lock, [this] { return m_stopped || m_pendingTasks > 0; });
+        if (m_stopped) {
+            return false;
+        }
+
+        // reserve one of the queued tasks
+        --m_pendingTasks;
+    }
+
+    Task task;
+    while (!takeTask(t_workerIndex, task)) {
+        // the task seen by this worker was taken by another one, a task reserved later is still queued,
+        // unless the scheduler is stopping and runs them itself
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        if (m_stopped) {
+            return false;
+        }
+    }
+
+    task();
+    ++m_executed;
+
+    return true;
+}
+
+bool WorkStealingScheduler::takeTask(size_t t_workerIndex, Task &t_task) {
+    {
+        WorkerQueue &ownQueue = *m_queues[t_workerIndex];
+        std::lock_guard<std::mutex> lock(ownQueue.mutex);
+        if (!ownQueue.tasks.empty()) {
+            t_task = std::move(ownQueue.tasks.front());
+            ownQueue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // steal the most recently queued task of the next busy worker
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkerQueue &victimQueue = *m_queues[(t_workerIndex + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victimQueue.mutex);
+        if (!victimQueue.tasks.empty()) {
+            t_task = std::move(victimQueue.tasks.back());
+            victimQueue.tasks.pop_back();
+            ++m_stolen;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t WorkStealingScheduler::getWorkerCount() const {
+    return m_queues.size();
+}
+
+SchedulerStats WorkStealingScheduler::getStats() const {
+    return {m_queues.size(), m_executed.load(), m_stolen.load()};
+}
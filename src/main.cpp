@@ -1,5 +1,6 @@
 #include <iostream>
 #include "../include/iCub/ObjectDetectionModule.h"
+#include "../include/iCub/ObjectDetectionThread.h"
 
 
 using namespace yarp::os;
@@ -20,6 +21,16 @@ int main(int argc, char *argv[]) {
 
     yInfo("resourceFinder: %s", rf.toString().c_str());
 
+    // --benchmark N : measure the frame rate reached with 1 to N inference workers, then exit
+    if (rf.check("benchmark")) {
+        ObjectDetectionThread benchmarkThread(rf);
+        const bool benchmarkSuccess = benchmarkThread.runScalingBenchmark(
+                rf.find("benchmark").asInt(),
+                rf.check("benchmark_frames", Value(100), "Frames inferred per worker count (int)").asInt(),
+                rf.check("benchmark_image", Value(""), "Image inferred by the benchmark (string)").asString());
+        return benchmarkSuccess ? 0 : 1;
+    }
+
     module.runModule(rf);
     return 0;
 }
@@ -4,8 +4,17 @@
 
 #include <tiff.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <utility>
 #include "iCub/tensorflowObjectDetection.h"
+#include "iCub/ImageKernels.h"
+
+#include <tensorflow/core/lib/hash/hash.h>
 
 // These are all common classes it's handy to reference with no namespace.
 using tensorflow::Flag;
@@ -17,6 +26,56 @@ using tensorflow::TensorShape;
 
 
 
+// Map a normalized coordinate of the input tensor back to the source image
+inline int toSourceCoordinate(float normalized, int targetSize, int offset, int contentSize, int sourceSize) {
+    const float sourceCoordinate = (normalized * targetSize - offset) * sourceSize / contentSize;
+    return std::max(0, std::min(sourceSize, static_cast<int>(sourceCoordinate)));
+}
+
+
+// Resident memory of the process from /proc/self/status, anonymous pages and pages of mapped files
+static void readResidentMemory(long *t_anonymousKb, long *t_fileKb) {
+    *t_anonymousKb = 0;
+    *t_fileKb = 0;
+
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status == nullptr) {
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), status) != nullptr) {
+        if (!strncmp(line, "RssAnon:", 8)) {
+            *t_anonymousKb = strtol(line + 8, nullptr, 10);
+        }
+        else if (!strncmp(line, "RssFile:", 8)) {
+            *t_fileKb = strtol(line + 8, nullptr, 10);
+        }
+    }
+    fclose(status);
+}
+
+
+// Synthetic frames : the cost of the detection graphs barely depends on the content
+static void fillSyntheticPixels(Tensor *t_input) {
+    auto pixels = t_input->flat<uint8>();
+    uint32_t seed = 12345;
+    for (int64_t i = 0; i < pixels.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        pixels(i) = static_cast<uint8>(seed >> 24);
+    }
+}
+
+
+GraphFormat parseGraphFormat(const std::string &t_format) {
+    if (t_format == "memmapped") {
+        return GraphFormat::Memmapped;
+    }
+
+    return GraphFormat::Frozen;
+}
+
+
 inline string replaceChar(string str, char ch1, char ch2) {
     for (int i = 0; i < str.length(); ++i) {
         if (str[i] == ch1)
@@ -27,14 +86,38 @@ inline string replaceChar(string str, char ch1, char ch2) {
 }
 
 
-tensorflowObjectDetection::tensorflowObjectDetection(std::string t_pathGraph, std::string t_pathLabels,  std::string t_model_name) {
+tensorflowObjectDetection::tensorflowObjectDetection(std::string t_pathGraph, std::string t_pathLabels,  std::string t_model_name)
+        : m_inputTensorPool(tensorflow::DT_UINT8) {
 
     this->m_pathToGraph = std::move(t_pathGraph);
     this->m_pathToLabels = std::move(t_pathLabels);
 
     this->m_model_name = std::move(t_model_name);
+    this->m_graphFormat = GraphFormat::Frozen;
+    this->m_graphLoadStats = {0.0, 0.0, 0, 0};
+    this->m_precision = Precision::Float;
+    this->m_optimizeGraph = false;
+    this->m_graphTransforms = DefaultGraphTransforms;
+    this->m_graphOptimizationStats = {false, false, 0, 0, 0.0, 0.0, 0.0};
 
-    this->m_detectionThreshold = 0.5;
+    this->m_classFilter = std::make_shared<const ClassFilter>(0.5f);
+    this->m_nmsIoU = 0.0f;
+    this->m_maxDetections = 20;
+
+    this->m_expectedInputWidth = 0;
+    this->m_expectedInputHeight = 0;
+    this->m_expectedBatchSize = 1;
+    this->m_inFlightFrames = 1;
+    this->m_sessionCount = 1;
+    this->m_threadingConfig = {0, 0, false};
+    this->m_tuningObjective = TuningObjective::None;
+    this->m_tuningRuns = 10;
+
+    this->m_targetInputWidth = 0;
+    this->m_targetInputHeight = 0;
+    this->m_letterbox = false;
+    this->m_preprocessStats = {0, 0, 0.0};
+    this->m_stageStatistics = nullptr;
 
 
 
@@ -96,8 +179,9 @@ tensorflowObjectDetection::ReadOpenLabelsFile(const std::string &file_name, std:
     while (std::getline(file, line)) {
 
         std::size_t pos = line.find(',');
+        // the quotes around the names are removed, not left as null characters in the labels
         std::string className = line.substr(pos + 1);
-        className = replaceChar(className, '\'', '\0');
+        className.erase(std::remove(className.begin(), className.end(), '\''), className.end());
         result->insert(std::pair<int, string>(id, className));
 
         ++id;
@@ -108,89 +192,402 @@ tensorflowObjectDetection::ReadOpenLabelsFile(const std::string &file_name, std:
     return Status::OK();
 }
 
-tensorflow::Tensor tensorflowObjectDetection::MatToTensor(cv::Mat inputImage) {
+tensorflow::Status tensorflowObjectDetection::MatToTensor(const std::vector<cv::Mat> &inputImages,
+                                                          tensorflow::Tensor *t_tensor,
+                                                          std::vector<ResizeGeometry> *t_geometries) {
 
-    const int inputImageHeight =  inputImage.rows;
-    const int inputImageWidth =  inputImage.cols;
-    auto root = tensorflow::Scope::NewRootScope();
+    const auto start = std::chrono::steady_clock::now();
+    ScopedStageTimer matToTensorTimer(m_stageStatistics, Stage::MatToTensor);
 
-    // allocate a Tensor
-    Tensor tensorImage(tensorflow::DT_UINT8, TensorShape({1, inputImageHeight, inputImageWidth, 3}));
+    const int batchSize = static_cast<int>(inputImages.size());
+    if (batchSize == 0) {
+        return tensorflow::errors::InvalidArgument("No image to convert");
+    }
 
+    t_geometries->resize(inputImages.size());
+    std::vector<std::shared_ptr<const ResizePlan> > resizePlans(inputImages.size());
+    for (int b = 0; b < batchSize; ++b) {
+        resizePlans[b] = getResizePlan(inputImages[b].cols, inputImages[b].rows);
+        (*t_geometries)[b] = resizePlans[b]->geometry;
 
+        if ((*t_geometries)[b].targetWidth != (*t_geometries)[0].targetWidth ||
+            (*t_geometries)[b].targetHeight != (*t_geometries)[0].targetHeight) {
+            return tensorflow::errors::InvalidArgument("Images of different resolutions can only be batched ",
+                                                       "when resized to the input resolution of the model");
+        }
+    }
+
+    const int targetWidth = (*t_geometries)[0].targetWidth;
+    const int targetHeight = (*t_geometries)[0].targetHeight;
+    const size_t targetRowBytes = 3 * static_cast<size_t>(targetWidth);
+
+    // recycled Tensor, allocated only the first time a resolution is seen
+    *t_tensor = m_inputTensorPool.acquire(TensorShape({batchSize, targetHeight, targetWidth, 3}));
 
     // get pointer to memory for that Tensor
-    auto *p = tensorImage.flat<uint8>().data();
-    // create a "fake" cv::Mat from it
-    cv::Mat matToTensor(inputImageHeight, inputImageWidth, CV_8U, p);
+    auto *p = t_tensor->flat<uint8>().data();
 
+    // single pass over each image : resized and channels swapped while written straight in the tensor memory,
+    // the source images are left untouched for the drawing
+    int64_t sourceBytes = 0;
+    {
+        ScopedStageTimer colourConversionTimer(m_stageStatistics, Stage::ColourConversion);
+        for (int b = 0; b < batchSize; ++b) {
+            resizeSwapRedBlue(inputImages[b].data, inputImages[b].step, p + b * targetRowBytes * targetHeight,
+                              targetRowBytes, *resizePlans[b], 0);
+            sourceBytes += 3 * static_cast<int64_t>(inputImages[b].cols) * inputImages[b].rows;
+        }
+    }
 
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const int64_t targetBytes = static_cast<int64_t>(t_tensor->TotalBytes());
 
-    // use it here as a destination
-    inputImage.convertTo(matToTensor, CV_8U);
+    std::lock_guard<std::mutex> lock(m_preprocessStatsMutex);
+    m_preprocessStats.frames += batchSize;
+    m_preprocessStats.totalTimeMs += elapsedMs;
+    if (sourceBytes > targetBytes) {
+        m_preprocessStats.bytesSaved += static_cast<uint64_t>(sourceBytes - targetBytes);
+    }
 
-    //normalizeTensor(&tensorImage);
+    return Status::OK();
 
-    return tensorImage;
+}
+
+std::shared_ptr<const ResizePlan> tensorflowObjectDetection::getResizePlan(int t_sourceWidth, int t_sourceHeight) {
+    std::lock_guard<std::mutex> lock(m_resizePlanMutex);
+
+    for (const auto &resizePlan : m_resizePlans) {
+        if (resizePlan->geometry.sourceWidth == t_sourceWidth && resizePlan->geometry.sourceHeight == t_sourceHeight) {
+            return resizePlan;
+        }
+    }
 
+    const bool resize = m_targetInputWidth > 0 && m_targetInputHeight > 0;
+    const ResizeGeometry geometry = computeResizeGeometry(t_sourceWidth, t_sourceHeight,
+                                                          resize ? m_targetInputWidth : t_sourceWidth,
+                                                          resize ? m_targetInputHeight : t_sourceHeight,
+                                                          resize && m_letterbox);
+    m_resizePlans.push_back(std::make_shared<const ResizePlan>(buildResizePlan(geometry)));
+
+    return m_resizePlans.back();
 }
 
-tensorflow::Status tensorflowObjectDetection::LoadGraph(const std::string &graph_file_name, std::unique_ptr<tensorflow::Session> *session) {
-    tensorflow::GraphDef graph_def;
+tensorflow::Status tensorflowObjectDetection::LoadGraph(const std::string &graph_file_name,
+                                                        tensorflow::GraphDef *t_graphDef, uint64_t *t_graphHash) {
+    if (m_graphFormat == GraphFormat::Memmapped) {
+        if (m_optimizeGraph) {
+            // the transforms would copy the mapped weights in the heap, a package is converted from an optimised graph
+            LOG(INFO) << "The memmapped graph is not optimised at startup";
+        }
+
+        m_memmappedEnv.reset(new tensorflow::MemmappedEnv(tensorflow::Env::Default()));
+        Status map_status = m_memmappedEnv->InitializeFromFile(graph_file_name);
+        if (map_status.ok()) {
+            map_status = tensorflow::ReadBinaryProto(m_memmappedEnv.get(),
+                                                     tensorflow::MemmappedFileSystem::kMemmappedPackageDefaultGraphDef,
+                                                     t_graphDef);
+        }
+        if (!map_status.ok()) {
+            m_memmappedEnv.reset();
+            return tensorflow::errors::NotFound("Failed to map the memmapped graph at '", graph_file_name, "' : ",
+                                                map_status.error_message());
+        }
+
+        // the weights are not read : the graph and the size of the package identify the model
+        tensorflow::uint64 packageSize = 0;
+        TF_RETURN_IF_ERROR(tensorflow::Env::Default()->GetFileSize(graph_file_name, &packageSize));
+        string serializedGraph;
+        t_graphDef->SerializeToString(&serializedGraph);
+        *t_graphHash = tensorflow::Hash64(serializedGraph.data(), serializedGraph.size(), packageSize);
+        return Status::OK();
+    }
+
+    string serializedGraph;
     Status load_graph_status =
-            ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
+            tensorflow::ReadFileToString(tensorflow::Env::Default(), graph_file_name, &serializedGraph);
     if (!load_graph_status.ok()) {
         return tensorflow::errors::NotFound("Failed to load compute graph at '",
                                             graph_file_name, "'");
     }
-    session->reset(tensorflow::NewSession(tensorflow::SessionOptions()));
-    Status session_create_status = (*session)->Create(graph_def);
-    if (!session_create_status.ok()) {
-        return session_create_status;
+
+    *t_graphHash = tensorflow::Hash64(serializedGraph);
+    if (!m_optimizeGraph) {
+        if (!t_graphDef->ParseFromString(serializedGraph)) {
+            return tensorflow::errors::NotFound("Failed to load compute graph at '", graph_file_name, "'");
+        }
+        return Status::OK();
+    }
+
+    // the exported graph is only parsed when its optimised version is not cached yet
+    const uint64_t optimizedKey = optimizedGraphKey(*t_graphHash, m_graphTransforms);
+    const std::string optimizedPath = optimizedGraphPath(graph_file_name, optimizedKey);
+    m_graphOptimizationStats = {true, false, 0, 0, 0.0, 0.0, 0.0};
+    *t_graphHash = optimizedKey;
+
+    if (tensorflow::ReadBinaryProto(tensorflow::Env::Default(), optimizedPath, t_graphDef).ok()) {
+        m_graphOptimizationStats.fromCache = true;
+        m_graphOptimizationStats.nodesAfter = t_graphDef->node_size();
+        LOG(INFO) << "Optimised graph read from " << optimizedPath << " : " << t_graphDef->node_size() << " nodes";
+        return Status::OK();
+    }
+
+    tensorflow::GraphDef exportedGraph;
+    if (!exportedGraph.ParseFromString(serializedGraph)) {
+        return tensorflow::errors::NotFound("Failed to load compute graph at '", graph_file_name, "'");
+    }
+    serializedGraph.clear();
+
+    TF_RETURN_IF_ERROR(OptimizeGraph(exportedGraph, t_graphDef));
+
+    Status write_status = writeGraphAtomically(optimizedPath, *t_graphDef);
+    if (!write_status.ok()) {
+        LOG(ERROR) << "Unable to cache the optimised graph in " << optimizedPath << " : " << write_status;
     }
     return Status::OK();
 }
 
-tensorflow::Status tensorflowObjectDetection::PrintTopLabels(std::vector<tensorflow::Tensor> &outputs,
-                                                       const std::string &labels_file_name) {
+tensorflow::Status tensorflowObjectDetection::OptimizeGraph(const tensorflow::GraphDef &t_graphDef,
+                                                            tensorflow::GraphDef *t_optimized) {
+    const auto start = std::chrono::steady_clock::now();
+    TF_RETURN_IF_ERROR(optimizeGraph(t_graphDef, m_input_layer, m_output_layer, m_graphTransforms, t_optimized));
+    m_graphOptimizationStats.optimizeTimeMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_graphOptimizationStats.nodesBefore = t_graphDef.node_size();
+    m_graphOptimizationStats.nodesAfter = t_optimized->node_size();
+
+    LOG(INFO) << "Graph optimised in " << m_graphOptimizationStats.optimizeTimeMs << " ms : "
+              << m_graphOptimizationStats.nodesBefore << " nodes reduced to " << m_graphOptimizationStats.nodesAfter;
+
+    // only measured once, when the cache is built
+    const TensorShape inputShape = getExpectedInputShape();
+    if (inputShape.dims() == 0) {
+        return Status::OK();
+    }
 
-    int doublonDetection = 0;
+    Tensor input(tensorflow::DT_UINT8, inputShape);
+    fillSyntheticPixels(&input);
 
-    auto boxes = outputs[0].flat_outer_dims<float,3>();
-    tensorflow::TTypes<float>::Flat scores = outputs[1].flat<float>();
-    tensorflow::TTypes<float>::Flat classes = outputs[2].flat<float>();
-    tensorflow::TTypes<float>::Flat num_detections = outputs[3].flat<float>();
+    TuningResult exportedResult;
+    TuningResult optimizedResult;
+    TF_RETURN_IF_ERROR(MeasureThreading(t_graphDef, m_threadingConfig, input, &exportedResult));
+    TF_RETURN_IF_ERROR(MeasureThreading(*t_optimized, m_threadingConfig, input, &optimizedResult));
+    m_graphOptimizationStats.p50BeforeMs = exportedResult.p50LatencyMs;
+    m_graphOptimizationStats.p50AfterMs = optimizedResult.p50LatencyMs;
 
-    LOG(ERROR) << "number of detection:" << num_detections << std::endl;
+    LOG(INFO) << "Median run of the graph : " << exportedResult.p50LatencyMs << " ms exported, "
+              << optimizedResult.p50LatencyMs << " ms optimised";
+    return Status::OK();
+}
 
-    //m_objectsDetected.clear();
-    for(size_t i = 0; i < num_detections(0) && i < 20;++i)
-    {
-        if(scores(i) > m_detectionThreshold)
-        {
-            int boxRectangleX1 = m_widthInputImage*boxes(0,i,1);
-            int boxRectangleY1 = m_heightInputImage*boxes(0,i,0);
+tensorflow::Status tensorflowObjectDetection::CreateSessions(const tensorflow::GraphDef &t_graphDef, int t_sessionCount,
+                                                             const ThreadingConfig &t_threadingConfig,
+                                                             std::vector<std::unique_ptr<tensorflow::Session> > *t_sessions) {
+    tensorflow::SessionOptions options;
+    applyThreadingConfig(t_threadingConfig, t_sessionCount, &options);
+
+    if (m_memmappedEnv != nullptr) {
+        // the ImmutableConst ops read their tensors from the package, the optimizer would copy them in the heap
+        options.env = m_memmappedEnv.get();
+        options.config.mutable_graph_options()->mutable_optimizer_options()->set_opt_level(
+                tensorflow::OptimizerOptions::L0);
+    }
 
-            int boxRectangleX2 = m_widthInputImage*boxes(0,i,3);
-            int boxRectangleY2 = m_heightInputImage*boxes(0,i,2);
+    t_sessions->clear();
+    for (int i = 0; i < t_sessionCount; ++i) {
+        t_sessions->emplace_back(tensorflow::NewSession(options));
+        Status session_create_status = t_sessions->back()->Create(t_graphDef);
+        if (!session_create_status.ok()) {
+            return session_create_status;
+        }
+    }
+    return Status::OK();
+}
+
+tensorflow::Status tensorflowObjectDetection::TuneThreading(const tensorflow::GraphDef &t_graphDef,
+                                                            const tensorflow::TensorShape &t_inputShape,
+                                                            ThreadingConfig *t_bestConfig) {
+    Tensor input(tensorflow::DT_UINT8, t_inputShape);
+    fillSyntheticPixels(&input);
+
+    const std::vector<ThreadingConfig> grid = buildThreadingGrid(tensorflow::port::NumSchedulableCPUs(),
+                                                                 m_sessionCount);
+    std::vector<TuningResult> results;
+    Status measure_status;
+    for (const ThreadingConfig &config : grid) {
+        // a configuration failing to run, e.g. out of resources with many pools, can not be chosen
+        TuningResult result;
+        measure_status = MeasureThreading(t_graphDef, config, input, &result);
+        if (!measure_status.ok()) {
+            LOG(WARNING) << "Threading intra " << config.intraOpThreads << " inter " << config.interOpThreads
+                         << (config.perSessionThreads ? " per session" : " shared") << " excluded : "
+                         << measure_status;
+            continue;
+        }
+
+        LOG(INFO) << "Threading intra " << config.intraOpThreads << " inter " << config.interOpThreads
+                  << (config.perSessionThreads ? " per session" : " shared") << " : p50 " << result.p50LatencyMs
+                  << " ms, " << result.framesPerSecond << " frames/s";
+        results.push_back(result);
+    }
 
-            string labelName = m_labels[classes(i)];
-            const Box boxCoordinates = {{boxRectangleX1, boxRectangleY1, boxRectangleX2, boxRectangleY2}, scores(i), labelName};
+    if (results.empty()) {
+        return measure_status;
+    }
+
+    *t_bestConfig = results[selectBestThreading(results, m_tuningObjective)].config;
+    return Status::OK();
+}
 
-            while(m_objectsDetected.find(labelName) != m_objectsDetected.end()){
-                doublonDetection++;
-                labelName = m_labels[classes(i)];
-                labelName.append(std::to_string(doublonDetection));
+tensorflow::Status tensorflowObjectDetection::MeasureThreading(const tensorflow::GraphDef &t_graphDef,
+                                                               const ThreadingConfig &t_config,
+                                                               const tensorflow::Tensor &t_input,
+                                                               TuningResult *t_result) {
+    std::vector<std::unique_ptr<tensorflow::Session> > sessions;
+    Status create_status = CreateSessions(t_graphDef, m_sessionCount, t_config, &sessions);
+    if (!create_status.ok()) {
+        return create_status;
+    }
+
+    // the first runs allocate the buffers of the session, they are not measured
+    std::vector<Tensor> outputs;
+    for (auto &session : sessions) {
+        Status run_status = session->Run({{m_input_layer, t_input}}, {m_output_layer}, {}, &outputs);
+        if (!run_status.ok()) {
+            return run_status;
+        }
+    }
+
+    // as many callers as frames in flight in the pipeline, spread over the sessions like runGraph does
+    const int concurrency = static_cast<int>(std::max<size_t>(1, m_inFlightFrames));
+    std::vector<std::vector<double> > latenciesMs(concurrency);
+    std::vector<Status> callerStatuses(concurrency);
+    std::vector<std::thread> callers;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < concurrency; ++c) {
+        callers.emplace_back([this, c, &sessions, &t_input, &latenciesMs, &callerStatuses] {
+            tensorflow::Session &session = *sessions[c % sessions.size()];
+            std::vector<Tensor> callerOutputs;
+            for (int r = 0; r < m_tuningRuns; ++r) {
+                const auto runStart = std::chrono::steady_clock::now();
+                callerStatuses[c] = session.Run({{m_input_layer, t_input}}, {m_output_layer}, {}, &callerOutputs);
+                if (!callerStatuses[c].ok()) {
+                    return;
+                }
+                latenciesMs[c].push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - runStart).count());
             }
+        });
+    }
+    for (std::thread &caller : callers) {
+        caller.join();
+    }
+    const double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // a failed run returns at once, it would be timed as a fast one
+    for (const Status &caller_status : callerStatuses) {
+        if (!caller_status.ok()) {
+            return caller_status;
+        }
+    }
+
+    std::vector<double> allLatenciesMs;
+    for (const auto &callerLatenciesMs : latenciesMs) {
+        allLatenciesMs.insert(allLatenciesMs.end(), callerLatenciesMs.begin(), callerLatenciesMs.end());
+    }
+    std::nth_element(allLatenciesMs.begin(), allLatenciesMs.begin() + allLatenciesMs.size() / 2,
+                     allLatenciesMs.end());
+
+    t_result->config = t_config;
+    t_result->p50LatencyMs = allLatenciesMs[allLatenciesMs.size() / 2];
+    t_result->framesPerSecond = allLatenciesMs.size() / elapsedS;
+
+    return Status::OK();
+}
+
+tensorflow::TensorShape tensorflowObjectDetection::getExpectedInputShape() const {
+    if (m_targetInputWidth > 0 && m_targetInputHeight > 0) {
+        return TensorShape({m_expectedBatchSize, m_targetInputHeight, m_targetInputWidth, 3});
+    }
+    if (m_expectedInputWidth > 0 && m_expectedInputHeight > 0) {
+        return TensorShape({m_expectedBatchSize, m_expectedInputHeight, m_expectedInputWidth, 3});
+    }
+
+    return TensorShape();
+}
+
+size_t tensorflowObjectDetection::acquireSession() {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+
+    size_t sessionIndex = 0;
+    for (size_t i = 1; i < m_sessionRuns.size(); ++i) {
+        if (m_sessionRuns[i] < m_sessionRuns[sessionIndex]) {
+            sessionIndex = i;
+        }
+    }
 
-            m_objectsDetected.insert(std::pair<string, Box>( labelName, boxCoordinates ));
+    ++m_sessionRuns[sessionIndex];
+    return sessionIndex;
+}
 
+void tensorflowObjectDetection::releaseSession(size_t t_sessionIndex) {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    --m_sessionRuns[t_sessionIndex];
+}
 
-            LOG(INFO) << i << ",score:" << scores(i)<< ",classID:" << classes(i) << ", "<< ",class:" << m_labels[classes(i)] << ",box:" << "," << boxRectangleX1 << "," << boxRectangleY1 << "," << boxRectangleX2 << "," << boxRectangleY2;
+tensorflow::Status tensorflowObjectDetection::PrintTopLabels(std::vector<tensorflow::Tensor> &outputs,
+                                                             int t_batchIndex, const ResizeGeometry &t_geometry,
+                                                             DetectionBuffer *t_objectsDetected) {
+
+    // objects already found per class id in the image, zeroed after each image
+    thread_local std::vector<int32_t> instanceCounts;
+    thread_local std::vector<int32_t> candidates;
+    thread_local std::vector<int32_t> selected;
+
+    // outputs are batched : boxes [batch, detection, 4], scores and classes [batch, detection], num [batch],
+    // the kernels work on the buffers of the image
+    const int b = t_batchIndex;
+    const size_t candidateCount = static_cast<size_t>(outputs[1].dim_size(1));
+    const float *boxes = outputs[0].flat<float>().data() + b * candidateCount * 4;
+    const float *scores = outputs[1].flat<float>().data() + b * candidateCount;
+    const float *classes = outputs[2].flat<float>().data() + b * candidateCount;
+    tensorflow::TTypes<float>::Flat num_detections = outputs[3].flat<float>();
+
+    VLOG(1) << "number of detection:" << num_detections(b);
 
+    const std::shared_ptr<const ClassFilter> classFilter = std::atomic_load(&m_classFilter);
+    const size_t detectionCount = std::min(static_cast<size_t>(std::max(0.0f, num_detections(b))), candidateCount);
+    candidates.resize(detectionCount);
+    const size_t keptCount = compactCandidates(scores, classes, detectionCount, *classFilter, candidates.data());
+    selectDetections(boxes, scores, classes, candidates.data(), keptCount, m_nmsIoU, m_maxDetections, &selected);
+
+    t_objectsDetected->reset(m_maxDetections);
+    for (const int32_t i : selected)
+    {
+        const float *box = boxes + 4 * i;
+        const ResizeGeometry &g = t_geometry;
+        int boxRectangleX1 = toSourceCoordinate(box[1], g.targetWidth, g.offsetX, g.contentWidth, g.sourceWidth);
+        int boxRectangleY1 = toSourceCoordinate(box[0], g.targetHeight, g.offsetY, g.contentHeight, g.sourceHeight);
+
+        int boxRectangleX2 = toSourceCoordinate(box[3], g.targetWidth, g.offsetX, g.contentWidth, g.sourceWidth);
+        int boxRectangleY2 = toSourceCoordinate(box[2], g.targetHeight, g.offsetY, g.contentHeight, g.sourceHeight);
+
+        const int classId = std::max(0, static_cast<int>(classes[i]));
+        if (classId >= static_cast<int>(instanceCounts.size())) {
+            instanceCounts.resize(classId + 1, 0);
         }
+
+        const Detection detection = {classId, instanceCounts[classId]++, scores[i],
+                                     {boxRectangleX1, boxRectangleY1, boxRectangleX2, boxRectangleY2}};
+        t_objectsDetected->push(detection);
+
+
+        VLOG(1) << i << ",score:" << scores[i]<< ",classID:" << classId << ",box:" << "," << boxRectangleX1 << "," << boxRectangleY1 << "," << boxRectangleX2 << "," << boxRectangleY2;
     }
 
+    for (const Detection &detection : *t_objectsDetected) {
+        instanceCounts[detection.classId] = 0;
+    }
 
     return Status::OK();
 }
@@ -198,13 +595,47 @@ tensorflow::Status tensorflowObjectDetection::PrintTopLabels(std::vector<tensorf
 
 
 std::string  tensorflowObjectDetection::getDetectedObjectToString() {
+    return detectionsToString(m_objectsDetected, m_labels);
+}
+
+
+std::string tensorflowObjectDetection::detectionName(const LabelTable &t_labels, const Detection &t_detection) {
+    if (t_detection.instance == 0) {
+        return t_labels.name(t_detection.classId);
+    }
+
+    return t_labels.name(t_detection.classId) + std::to_string(t_detection.instance);
+}
+
+
+std::string tensorflowObjectDetection::detectionsToString(const DetectionBuffer &t_objectsDetected,
+                                                          const LabelTable &t_labels) {
 
     string objectsDetected;
-    for (auto &it : m_objectsDetected) {
-        objectsDetected.append(it.first + " : " + boxToString(it.second) +" ; ");
+    for (const Detection &detection : t_objectsDetected) {
+        objectsDetected.append(t_labels.name(detection.classId));
+        if (detection.instance > 0) {
+            objectsDetected.append(std::to_string(detection.instance));
+        }
+        objectsDetected.append(" : ");
+        for (const int32_t coordinate : detection.box) {
+            objectsDetected.append(std::to_string(coordinate));
+            objectsDetected.append(" ");
+        }
+        objectsDetected.append(std::to_string(static_cast<double>(detection.score)));
+        objectsDetected.append(" ; ");
     }
 
-        return objectsDetected;
+    return objectsDetected;
+}
+
+
+const LabelTable &tensorflowObjectDetection::getLabels() const {
+    return m_labels;
+}
+
+void tensorflowObjectDetection::setLabelsCache(std::string t_cachePath) {
+    m_labelsCachePath = std::move(t_cachePath);
 }
 
 
@@ -214,27 +645,177 @@ std::string tensorflowObjectDetection::inferObject(cv::Mat t_inputImage) {
 
     this->m_widthInputImage = t_inputImage.cols;
     this->m_heightInputImage = t_inputImage.rows;
+    this->m_objectsDetected.clear();
+
+    return inferObject(t_inputImage, &m_objectsDetected);
+}
+
 
+std::string tensorflowObjectDetection::inferObject(cv::Mat t_inputImage, DetectionBuffer *t_objectsDetected) {
+
+    if (m_tileCache.getConfig().enabled()) {
+        Tensor tiles_tensor;
+        std::vector<TiledFrame> tiledFrames;
+        const Status tile_status = tilesToTensor({t_inputImage}, {0}, &tiles_tensor, &tiledFrames);
+        if (!tile_status.ok()) {
+            LOG(ERROR) << "Converting the tiles failed: " << tile_status.error_message();
+            return "";
+        }
+
+        std::vector<Tensor> outputs;
+        if (tiles_tensor.IsInitialized()) {
+            Status run_status = runGraph(tiles_tensor, &outputs);
+            if (!run_status.ok()) {
+                LOG(ERROR) << "Running model failed: " << run_status.error_message();
+                return "";
+            }
+        }
+
+        extractTiledDetections(outputs, tiledFrames[0], t_objectsDetected);
+        return detectionsToString(*t_objectsDetected, m_labels);
+    }
+
+    Tensor resized_tensor;
+    std::vector<ResizeGeometry> geometries;
+    const Status convert_status = MatToTensor({t_inputImage}, &resized_tensor, &geometries);
+    if (!convert_status.ok()) {
+        LOG(ERROR) << "Converting image failed: " << convert_status.error_message();
+        return "";
+    }
 
-    const Tensor resized_tensor = MatToTensor(t_inputImage);
     std::vector<Tensor> outputs;
 
 
-    Status run_status = m_session->Run({{m_input_layer, resized_tensor}},
-                                     {m_output_layer}, {}, &outputs);
+    Status run_status = runGraph(resized_tensor, &outputs);
 
     if (!run_status.ok()) {
         LOG(ERROR) << "Running model failed: " << run_status.error_message();
         return "";
     } else {
-        PrintTopLabels(outputs, this->m_pathToLabels);
+        PrintTopLabels(outputs, 0, geometries[0], t_objectsDetected);
+
+        return detectionsToString(*t_objectsDetected, m_labels);
+
+    }
+
+}
+
+
+tensorflow::Tensor tensorflowObjectDetection::imageToTensor(cv::Mat t_inputImage, ResizeGeometry *t_geometry) {
+    Tensor inputTensor;
+    std::vector<ResizeGeometry> geometries;
+    const Status convert_status = MatToTensor({t_inputImage}, &inputTensor, &geometries);
+    if (!convert_status.ok()) {
+        LOG(ERROR) << "Converting image failed: " << convert_status.error_message();
+        return inputTensor;
+    }
+
+    *t_geometry = geometries[0];
+    return inputTensor;
+}
 
-        return getDetectedObjectToString();
 
+tensorflow::Status tensorflowObjectDetection::imagesToTensor(const std::vector<cv::Mat> &t_inputImages,
+                                                             tensorflow::Tensor *t_inputTensor,
+                                                             std::vector<ResizeGeometry> *t_geometries) {
+    return MatToTensor(t_inputImages, t_inputTensor, t_geometries);
+}
+
+
+tensorflow::Status tensorflowObjectDetection::runGraph(tensorflow::Tensor &t_inputTensor,
+                                                       std::vector<tensorflow::Tensor> *t_outputs) {
+    const Status run_status = runGraphOnSharedInput(t_inputTensor, t_outputs);
+
+    m_inputTensorPool.release(t_inputTensor);
+
+    return run_status;
+}
+
+
+tensorflow::Status tensorflowObjectDetection::runGraphOnSharedInput(const tensorflow::Tensor &t_inputTensor,
+                                                                    std::vector<tensorflow::Tensor> *t_outputs) {
+    // Session::Run is thread safe, the concurrent runs are spread over the sessions
+    const size_t sessionIndex = acquireSession();
+    Status run_status;
+    {
+        ScopedStageTimer sessionRunTimer(m_stageStatistics, Stage::SessionRun);
+        run_status = m_sessions[sessionIndex]->Run({{m_input_layer, t_inputTensor}}, {m_output_layer}, {}, t_outputs);
     }
+    releaseSession(sessionIndex);
 
+    return run_status;
+}
 
 
+void tensorflowObjectDetection::extractDetections(std::vector<tensorflow::Tensor> &t_outputs, int t_batchIndex,
+                                                  const ResizeGeometry &t_geometry,
+                                                  DetectionBuffer *t_objectsDetected) {
+    PrintTopLabels(t_outputs, t_batchIndex, t_geometry, t_objectsDetected);
+}
+
+
+tensorflow::Status tensorflowObjectDetection::tilesToTensor(const std::vector<cv::Mat> &t_inputImages,
+                                                            const std::vector<size_t> &t_sources,
+                                                            tensorflow::Tensor *t_inputTensor,
+                                                            std::vector<TiledFrame> *t_tiledFrames) {
+    // the tiles are views of the images, converted by the same kernels as whole images
+    std::vector<cv::Mat> tileImages;
+    t_tiledFrames->resize(t_inputImages.size());
+    for (size_t b = 0; b < t_inputImages.size(); ++b) {
+        const cv::Mat &image = t_inputImages[b];
+        TiledFrame &tiledFrame = (*t_tiledFrames)[b];
+        m_tileCache.selectTiles(t_sources[b], image.data, image.step, image.cols, image.rows, &tiledFrame);
+
+        tiledFrame.firstBatchIndex = static_cast<int>(tileImages.size());
+        for (const int t : tiledFrame.inferredTiles) {
+            const ImageTile &tile = tiledFrame.tiles[t];
+            tileImages.push_back(image(cv::Rect(tile.x, tile.y, tile.width, tile.height)));
+        }
+    }
+
+    if (tileImages.empty()) {
+        *t_inputTensor = Tensor();
+        return Status::OK();
+    }
+
+    std::vector<ResizeGeometry> geometries;
+    TF_RETURN_IF_ERROR(MatToTensor(tileImages, t_inputTensor, &geometries));
+    for (TiledFrame &tiledFrame : *t_tiledFrames) {
+        if (!tiledFrame.inferredTiles.empty()) {
+            tiledFrame.geometry = geometries[tiledFrame.firstBatchIndex];
+        }
+    }
+
+    return Status::OK();
+}
+
+
+void tensorflowObjectDetection::extractTiledDetections(std::vector<tensorflow::Tensor> &t_outputs,
+                                                       const TiledFrame &t_tiledFrame,
+                                                       DetectionBuffer *t_objectsDetected) {
+    static thread_local DetectionBuffer tileBuffer;
+    static thread_local std::vector<std::vector<Detection> > tileDetections;
+
+    tileDetections.clear();
+    if (!t_outputs.empty()) {
+        tileDetections.resize(t_tiledFrame.inferredTiles.size());
+        for (size_t k = 0; k < t_tiledFrame.inferredTiles.size(); ++k) {
+            const ImageTile &tile = t_tiledFrame.tiles[t_tiledFrame.inferredTiles[k]];
+            PrintTopLabels(t_outputs, t_tiledFrame.firstBatchIndex + static_cast<int>(k), t_tiledFrame.geometry,
+                           &tileBuffer);
+
+            // from the tile to the frame coordinates
+            for (Detection detection : tileBuffer) {
+                detection.box[0] += tile.x;
+                detection.box[1] += tile.y;
+                detection.box[2] += tile.x;
+                detection.box[3] += tile.y;
+                tileDetections[k].push_back(detection);
+            }
+        }
+    }
+
+    m_tileCache.mergeTiles(t_tiledFrame, tileDetections, m_maxDetections, t_objectsDetected);
 }
 
 tensorflow::Status tensorflowObjectDetection::initGraph() {
@@ -244,13 +825,65 @@ tensorflow::Status tensorflowObjectDetection::initGraph() {
 
     }
 
-    Status load_graph_status = LoadGraph(this->m_pathToGraph, &m_session);
+    tensorflow::GraphDef graph_def;
+    uint64_t graphHash = 0;
+    const auto loadStart = std::chrono::steady_clock::now();
+    Status load_graph_status = LoadGraph(precisionGraphPath(this->m_pathToGraph, m_precision), &graph_def,
+                                         &graphHash);
+    m_graphLoadStats.loadTimeMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
 
     if (!load_graph_status.ok()) {
         LOG(ERROR) << load_graph_status;
         return Status(tensorflow::error::FAILED_PRECONDITION,"Unable to initialize the graph, check the graph and labels path");
     }
 
+    const TensorShape inputShape = getExpectedInputShape();
+
+    if (m_tuningObjective != TuningObjective::None && inputShape.dims() > 0) {
+        const std::string tuningKey = threadingCacheKey(graphHash, inputShape, m_sessionCount,
+                                                        static_cast<int>(m_inFlightFrames), m_tuningObjective);
+
+        if (readThreadingCache(m_tuningCachePath, tuningKey, &m_threadingConfig)) {
+            LOG(INFO) << "Threading configuration read from " << m_tuningCachePath;
+        }
+        else {
+            Status tune_status = TuneThreading(graph_def, inputShape, &m_threadingConfig);
+            if (!tune_status.ok()) {
+                LOG(ERROR) << tune_status;
+                return Status(tensorflow::error::FAILED_PRECONDITION, "Unable to tune the threading of the graph");
+            }
+
+            if (!writeThreadingCache(m_tuningCachePath, tuningKey, m_threadingConfig)) {
+                LOG(ERROR) << "Unable to write the threading cache " << m_tuningCachePath;
+            }
+        }
+
+        LOG(INFO) << "Threading configuration : intra " << m_threadingConfig.intraOpThreads << " inter "
+                  << m_threadingConfig.interOpThreads
+                  << (m_threadingConfig.perSessionThreads ? " per session pools" : " shared pools");
+    }
+
+    const auto sessionStart = std::chrono::steady_clock::now();
+    Status create_status = CreateSessions(graph_def, m_sessionCount, m_threadingConfig, &m_sessions);
+    if (!create_status.ok()) {
+        LOG(ERROR) << create_status;
+        return Status(tensorflow::error::FAILED_PRECONDITION, "Unable to create the sessions of the graph");
+    }
+    m_sessionRuns.assign(m_sessions.size(), 0);
+    m_graphLoadStats.sessionTimeMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sessionStart).count();
+
+    readResidentMemory(&m_graphLoadStats.residentAnonymousKb, &m_graphLoadStats.residentFileKb);
+    LOG(INFO) << (m_graphFormat == GraphFormat::Memmapped ? "Memmapped" : "Frozen") << " graph loaded in "
+              << m_graphLoadStats.loadTimeMs << " ms, sessions created in " << m_graphLoadStats.sessionTimeMs
+              << " ms, resident " << m_graphLoadStats.residentAnonymousKb << " kB anonymous "
+              << m_graphLoadStats.residentFileKb << " kB file backed";
+
+    if (inputShape.dims() > 0) {
+        m_inputTensorPool.reserve(inputShape, m_inFlightFrames);
+    }
+
 
 
 
@@ -259,12 +892,87 @@ tensorflow::Status tensorflowObjectDetection::initGraph() {
 
 }
 
+Status tensorflowObjectDetection::warmUp(int t_runs) {
+    const TensorShape inputShape = getExpectedInputShape();
+    if (inputShape.dims() == 0) {
+        return Status::OK();
+    }
+
+    Tensor input(tensorflow::DT_UINT8, inputShape);
+    fillSyntheticPixels(&input);
+
+    std::vector<Tensor> outputs;
+    for (auto &session : m_sessions) {
+        for (int r = 0; r < t_runs; ++r) {
+            TF_RETURN_IF_ERROR(session->Run({{m_input_layer, input}}, {m_output_layer}, {}, &outputs));
+        }
+    }
+    return Status::OK();
+}
+
+std::unique_ptr<tensorflowObjectDetection> tensorflowObjectDetection::createForModel(std::string t_pathGraph,
+                                                                                     std::string t_pathLabels,
+                                                                                     std::string t_modelName) const {
+    std::unique_ptr<tensorflowObjectDetection> detector(
+            new tensorflowObjectDetection(std::move(t_pathGraph), std::move(t_pathLabels), std::move(t_modelName)));
+
+    // the class ids of another label file mean other classes, only the detection threshold carries over
+    detector->m_classFilter = std::make_shared<const ClassFilter>(std::atomic_load(&m_classFilter)->getThreshold());
+    detector->m_nmsIoU = m_nmsIoU;
+    detector->m_maxDetections = m_maxDetections;
+    detector->m_expectedInputWidth = m_expectedInputWidth;
+    detector->m_expectedInputHeight = m_expectedInputHeight;
+    detector->m_expectedBatchSize = m_expectedBatchSize;
+    detector->m_inFlightFrames = m_inFlightFrames;
+    detector->m_sessionCount = m_sessionCount;
+    detector->m_threadingConfig = m_threadingConfig;
+    detector->m_tuningObjective = m_tuningObjective;
+    detector->m_tuningCachePath = m_tuningCachePath;
+    detector->m_tuningRuns = m_tuningRuns;
+    detector->m_graphFormat = m_graphFormat;
+    detector->m_precision = m_precision;
+    detector->m_optimizeGraph = m_optimizeGraph;
+    detector->m_graphTransforms = m_graphTransforms;
+    detector->m_stageStatistics = m_stageStatistics;
+    detector->m_tileCache.configure(m_tileCache.getConfig());
+    {
+        std::lock_guard<std::mutex> lock(m_resizePlanMutex);
+        detector->m_targetInputWidth = m_targetInputWidth;
+        detector->m_targetInputHeight = m_targetInputHeight;
+        detector->m_letterbox = m_letterbox;
+    }
+
+    return detector;
+}
+
+Status tensorflowObjectDetection::LoadLabels(bool t_openImagesFormat) {
+    string labelsContent;
+    TF_RETURN_IF_ERROR(tensorflow::ReadFileToString(tensorflow::Env::Default(), m_pathToLabels, &labelsContent));
+    const uint64_t labelsHash = tensorflow::Hash64(labelsContent);
+
+    if (!m_labelsCachePath.empty() && m_labels.mapCache(m_labelsCachePath, labelsHash)) {
+        LOG(INFO) << m_labels.size() << " labels mapped from " << m_labelsCachePath;
+        return Status::OK();
+    }
+
+    std::map<int, std::string> labels;
+    size_t label_count = 0;
+    TF_RETURN_IF_ERROR(t_openImagesFormat ? ReadOpenLabelsFile(m_pathToLabels, &labels, &label_count)
+                                          : ReadCocoLabelsFile(m_pathToLabels, &labels, &label_count));
+    m_labels.assign(labels);
+
+    if (!m_labelsCachePath.empty() && !m_labels.writeCache(m_labelsCachePath, labelsHash)) {
+        LOG(ERROR) << "Unable to write the labels cache " << m_labelsCachePath;
+    }
+
+    return Status::OK();
+}
+
 bool tensorflowObjectDetection::initPreprocessParameters(std::string modelName) {
     Status read_labels_status;
-    size_t label_count;
 
     if(modelName.find("coco") != string::npos){
-        read_labels_status = ReadCocoLabelsFile(m_pathToLabels, &m_labels, &label_count);
+        read_labels_status = LoadLabels(false);
         if (!read_labels_status.ok()) {
             LOG(ERROR) << read_labels_status.error_message();
 
@@ -276,7 +984,7 @@ bool tensorflowObjectDetection::initPreprocessParameters(std::string modelName)
     }
 
     else if(modelName.find("open") != string::npos){
-        read_labels_status = ReadOpenLabelsFile(m_pathToLabels, &m_labels, &label_count);
+        read_labels_status = LoadLabels(true);
         if (!read_labels_status.ok()) {
             LOG(ERROR) << read_labels_status;
         }
@@ -295,13 +1003,126 @@ void tensorflowObjectDetection::clearSetOfObject(){
 }
 
 double tensorflowObjectDetection::getM_detecttionThreshold() const {
-    return m_detectionThreshold;
+    return std::atomic_load(&m_classFilter)->getThreshold();
 }
 
 void tensorflowObjectDetection::setM_detectionThreshold(double m_inferencethreshold) {
-    tensorflowObjectDetection::m_detectionThreshold = m_inferencethreshold;
+    std::lock_guard<std::mutex> lock(m_classFilterMutex);
+    std::shared_ptr<ClassFilter> classFilter = std::make_shared<ClassFilter>(*std::atomic_load(&m_classFilter));
+    classFilter->setThreshold(static_cast<float>(m_inferencethreshold));
+    std::atomic_store(&m_classFilter, std::shared_ptr<const ClassFilter>(std::move(classFilter)));
+}
+
+void tensorflowObjectDetection::setClassFilter(const ClassFilter &t_filter) {
+    std::lock_guard<std::mutex> lock(m_classFilterMutex);
+    std::atomic_store(&m_classFilter, std::make_shared<const ClassFilter>(t_filter));
+}
+
+ClassFilter tensorflowObjectDetection::getClassFilter() const {
+    return *std::atomic_load(&m_classFilter);
+}
+
+void tensorflowObjectDetection::setNmsIoU(float t_iouThreshold) {
+    m_nmsIoU = t_iouThreshold;
+}
+
+float tensorflowObjectDetection::getNmsIoU() const {
+    return m_nmsIoU;
+}
+
+void tensorflowObjectDetection::setMaxDetections(size_t t_maxDetections) {
+    m_maxDetections = t_maxDetections;
+}
+
+size_t tensorflowObjectDetection::getMaxDetections() const {
+    return m_maxDetections;
+}
+
+void tensorflowObjectDetection::setTiling(const TilingConfig &t_config) {
+    m_tileCache.configure(t_config);
 }
 
+TilingConfig tensorflowObjectDetection::getTiling() const {
+    return m_tileCache.getConfig();
+}
 
+TileStats tensorflowObjectDetection::getTileStats() const {
+    return m_tileCache.getStats();
+}
 
+void tensorflowObjectDetection::setExpectedInputSize(int t_width, int t_height, int t_batchSize,
+                                                     size_t t_inFlightFrames) {
+    this->m_expectedInputWidth = t_width;
+    this->m_expectedInputHeight = t_height;
+    this->m_expectedBatchSize = t_batchSize;
+    this->m_inFlightFrames = t_inFlightFrames;
+}
+
+void tensorflowObjectDetection::setSessionCount(int t_sessionCount) {
+    this->m_sessionCount = std::max(1, t_sessionCount);
+}
+
+int tensorflowObjectDetection::getSessionCount() const {
+    return m_sessionCount;
+}
+
+void tensorflowObjectDetection::setThreadingConfig(const ThreadingConfig &t_threadingConfig) {
+    this->m_threadingConfig = t_threadingConfig;
+}
+
+void tensorflowObjectDetection::setThreadingTuning(TuningObjective t_objective, std::string t_cachePath, int t_runs) {
+    this->m_tuningObjective = t_objective;
+    this->m_tuningCachePath = std::move(t_cachePath);
+    this->m_tuningRuns = std::max(1, t_runs);
+}
+
+ThreadingConfig tensorflowObjectDetection::getThreadingConfig() const {
+    return m_threadingConfig;
+}
+
+void tensorflowObjectDetection::setStageStatistics(StageStatistics *t_stageStatistics) {
+    this->m_stageStatistics = t_stageStatistics;
+}
+
+TensorPoolStats tensorflowObjectDetection::getInputTensorPoolStats() const {
+    return m_inputTensorPool.getStats();
+}
 
+void tensorflowObjectDetection::setInputResize(int t_width, int t_height, bool t_letterbox) {
+    std::lock_guard<std::mutex> lock(m_resizePlanMutex);
+
+    this->m_targetInputWidth = t_width;
+    this->m_targetInputHeight = t_height;
+    this->m_letterbox = t_letterbox;
+    this->m_resizePlans.clear();
+}
+
+PreprocessStats tensorflowObjectDetection::getPreprocessStats() const {
+    std::lock_guard<std::mutex> lock(m_preprocessStatsMutex);
+    return m_preprocessStats;
+}
+
+void tensorflowObjectDetection::setGraphFormat(GraphFormat t_graphFormat) {
+    this->m_graphFormat = t_graphFormat;
+}
+
+GraphLoadStats tensorflowObjectDetection::getGraphLoadStats() const {
+    return m_graphLoadStats;
+}
+
+void tensorflowObjectDetection::setGraphOptimization(bool t_enabled, std::string t_transforms) {
+    this->m_optimizeGraph = t_enabled;
+    this->m_graphTransforms = t_transforms.empty() ? std::string(DefaultGraphTransforms) : std::move(t_transforms);
+}
+
+GraphOptimizationStats tensorflowObjectDetection::getGraphOptimizationStats() const {
+    return m_graphOptimizationStats;
+}
+
+void tensorflowObjectDetection::setPrecision(Precision t_precision) {
+    this->m_precision = t_precision;
+}
+
+Precision tensorflowObjectDetection::getPrecision() const {
+    return m_precision;
+}
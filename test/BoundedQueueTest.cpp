@@ -0,0 +1,93 @@
+//
+// Unit tests of the bounded queue between the pipeline stages : order of the items, dropping of the oldest item
+// for the live streams, blocking on the capacity and closing.
+//
+
+#include <atomic>
+#include <thread>
+
+#include "iCub/BoundedQueue.h"
+#include "TestCheck.h"
+
+
+static void testFirstInFirstOut() {
+    BoundedQueue<int> queue(3);
+    CHECK(queue.push(1));
+    CHECK(queue.push(2));
+    CHECK(queue.push(3));
+    CHECK_EQUAL(3u, queue.size());
+
+    for (int expected = 1; expected <= 3; ++expected) {
+        int item = 0;
+        CHECK(queue.pop(item));
+        CHECK_EQUAL(expected, item);
+    }
+    CHECK_EQUAL(0u, queue.size());
+}
+
+static void testDropOldest() {
+    BoundedQueue<int> queue(2);
+    for (int i = 1; i <= 5; ++i) {
+        CHECK(queue.pushDropOldest(i));
+    }
+    CHECK_EQUAL(2u, queue.size());
+    CHECK_EQUAL(3u, queue.dropped());
+
+    // the most recent items are kept
+    int item = 0;
+    CHECK(queue.pop(item));
+    CHECK_EQUAL(4, item);
+    CHECK(queue.pop(item));
+    CHECK_EQUAL(5, item);
+}
+
+static void testBlockingProducer() {
+    const int itemCount = 1000;
+    BoundedQueue<int> queue(4);
+
+    std::thread producer([&queue] {
+        for (int i = 0; i < itemCount; ++i) {
+            queue.push(i);
+        }
+    });
+
+    bool ordered = true;
+    for (int expected = 0; expected < itemCount; ++expected) {
+        int item = -1;
+        CHECK(queue.pop(item));
+        ordered = ordered && item == expected;
+        CHECK(queue.size() <= queue.capacity());
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK_EQUAL(0u, queue.dropped());
+}
+
+static void testCloseWakesUp() {
+    BoundedQueue<int> queue(1);
+
+    std::atomic<bool> popped(true);
+    std::thread consumer([&queue, &popped] {
+        int item = 0;
+        popped = queue.pop(item);
+    });
+
+    queue.close();
+    consumer.join();
+    CHECK(!popped);
+
+    // the waiting items are dropped, the following calls fail
+    CHECK(!queue.push(1));
+    CHECK(!queue.pushDropOldest(1));
+    CHECK_EQUAL(0u, queue.size());
+}
+
+
+int main() {
+    RUN_TEST(testFirstInFirstOut);
+    RUN_TEST(testDropOldest);
+    RUN_TEST(testBlockingProducer);
+    RUN_TEST(testCloseWakesUp);
+
+    return testResult();
+}
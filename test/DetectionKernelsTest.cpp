@@ -0,0 +1,163 @@
+//
+// Unit tests of the detection kernels : non maximum suppression, selection of the best scored candidates and
+// filtering by class, each instruction set supported by the CPU giving the same result as the scalar kernels.
+//
+
+#include <vector>
+
+#include "iCub/DetectionKernels.h"
+#include "TestCheck.h"
+
+
+// Instruction sets of the kernels runnable on this CPU
+static std::vector<KernelIsa> supportedIsas() {
+    const KernelIsa cpuIsa = detectKernelIsa();
+    std::vector<KernelIsa> isas;
+    for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::SSSE3, KernelIsa::AVX2}) {
+        if (static_cast<int>(isa) <= static_cast<int>(cpuIsa)) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+// Boxes spread over a grid with overlapping neighbours and a few classes, by decreasing score
+static std::vector<Detection> gridDetections(size_t t_count) {
+    std::vector<Detection> detections;
+    uint32_t random = 12345;
+    for (size_t i = 0; i < t_count; ++i) {
+        random = random * 1103515245u + 12345u;
+        const int32_t x = static_cast<int32_t>((i % 8) * 30 + (random >> 16) % 20);
+        const int32_t y = static_cast<int32_t>((i / 8) * 30 + (random >> 8) % 20);
+        detections.push_back({static_cast<int32_t>(i / 16), 0, 1.0f - i / float(t_count + 1),
+                              {x, y, x + 50, y + 50}});
+    }
+    return detections;
+}
+
+
+static void testNonMaxSuppression() {
+    std::vector<Detection> candidates = {
+            {1, 0, 0.6f, {200, 200, 300, 300}},
+            {1, 0, 0.8f, {5, 5, 105, 105}},         // same object as the best one
+            {2, 0, 0.7f, {0, 0, 100, 100}},         // same box, another class
+            {1, 0, 0.9f, {0, 0, 100, 100}},
+    };
+
+    DetectionBuffer objectsDetected;
+    nonMaxSuppression(&candidates, 0.5f, 10, &objectsDetected);
+
+    CHECK_EQUAL(3u, objectsDetected.size());
+    CHECK_EQUAL(0.9f, objectsDetected[0].score);
+    CHECK_EQUAL(0.7f, objectsDetected[1].score);
+    CHECK_EQUAL(0.6f, objectsDetected[2].score);
+
+    // the instances are numbered per class by decreasing score
+    CHECK_EQUAL(0, objectsDetected[0].instance);
+    CHECK_EQUAL(0, objectsDetected[1].instance);
+    CHECK_EQUAL(1, objectsDetected[2].instance);
+
+    // the numbering starts again on the next call
+    nonMaxSuppression(&candidates, 0.5f, 2, &objectsDetected);
+    CHECK_EQUAL(2u, objectsDetected.size());
+    CHECK_EQUAL(0, objectsDetected[0].instance);
+    CHECK_EQUAL(0, objectsDetected[1].instance);
+}
+
+static void testSuppressOverlapsIsas() {
+    const std::vector<Detection> detections = gridDetections(61);
+    DetectionBoxes boxes;
+    boxes.assign(detections.data(), detections.size());
+
+    std::vector<int32_t> expected;
+    const size_t expectedKept = suppressOverlaps(KernelIsa::Scalar, boxes, 0.3f, 1000, &expected);
+    CHECK(expectedKept > 0 && expectedKept < detections.size());
+
+    for (KernelIsa isa : supportedIsas()) {
+        std::vector<int32_t> keep;
+        CHECK_EQUAL(expectedKept, suppressOverlaps(isa, boxes, 0.3f, 1000, &keep));
+        CHECK(keep == expected);
+
+        // the boxes after the last kept one are all dropped
+        CHECK_EQUAL(5u, suppressOverlaps(isa, boxes, 0.3f, 5, &keep));
+        size_t kept = 0;
+        for (int32_t k : keep) {
+            kept += k != 0;
+        }
+        CHECK_EQUAL(5u, kept);
+    }
+}
+
+static void testSelectDetections() {
+    // ymin xmin ymax xmax, as output by the graphs
+    const float boxes[] = {
+            0.0f, 0.0f, 0.5f, 0.5f,
+            0.6f, 0.6f, 0.9f, 0.9f,
+            0.0f, 0.0f, 0.5f, 0.5f,         // duplicate of the first one
+            0.0f, 0.0f, 0.5f, 0.5f,         // same box, another class
+            0.2f, 0.6f, 0.4f, 0.8f,
+    };
+    const float scores[] = {0.7f, 0.9f, 0.6f, 0.5f, 0.7f};
+    const float classes[] = {1.0f, 1.0f, 1.0f, 2.0f, 3.0f};
+
+    for (KernelIsa isa : supportedIsas()) {
+        int32_t candidates[] = {0, 1, 2, 3, 4};
+        std::vector<int32_t> selected;
+        selectDetections(isa, boxes, scores, classes, candidates, 5, 0.5f, 10, &selected);
+
+        // by decreasing score, the first output first on a tie
+        CHECK(selected == std::vector<int32_t>({1, 0, 4, 3}));
+
+        int32_t sortedCandidates[] = {1, 0, 4, 2, 3};
+        selectDetections(isa, boxes, scores, classes, sortedCandidates, 5, 0.5f, 2, &selected);
+        CHECK(selected == std::vector<int32_t>({1, 0}));
+
+        // without suppression the duplicate is kept
+        int32_t allCandidates[] = {4, 3, 2, 1, 0};
+        selectDetections(isa, boxes, scores, classes, allCandidates, 5, 0.0f, 10, &selected);
+        CHECK(selected == std::vector<int32_t>({1, 0, 4, 2, 3}));
+    }
+}
+
+static void testCompactCandidates() {
+    const size_t count = 37;
+    std::vector<float> scores(count);
+    std::vector<float> classes(count);
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] = static_cast<float>(i % 10) / 10.0f;
+        classes[i] = static_cast<float>(i % 4);
+    }
+
+    ClassFilter filter(0.45f);
+    filter.setClassThreshold(2, 0.75f);
+    filter.denyClasses({3});
+
+    std::vector<int32_t> expected;
+    for (size_t i = 0; i < count; ++i) {
+        const int32_t classId = static_cast<int32_t>(classes[i]);
+        if (classId != 3 && scores[i] > filter.threshold(classId)) {
+            expected.push_back(static_cast<int32_t>(i));
+        }
+    }
+    CHECK(!expected.empty());
+
+    for (KernelIsa isa : supportedIsas()) {
+        std::vector<int32_t> indices(count);
+        indices.resize(compactCandidates(isa, scores.data(), classes.data(), count, filter, indices.data()));
+        CHECK(indices == expected);
+    }
+
+    CHECK(!filter.allowed(3));
+    filter.allowClasses({});
+    CHECK(filter.allowed(3));
+}
+
+
+int main() {
+    RUN_TEST(testNonMaxSuppression);
+    RUN_TEST(testSuppressOverlapsIsas);
+    RUN_TEST(testSelectDetections);
+    RUN_TEST(testCompactCandidates);
+
+    return testResult();
+}
@@ -0,0 +1,126 @@
+//
+// Unit tests of the label table : lookup of the interned names, and binary cache mapped only when it was built
+// from the same label file and is intact.
+//
+// Usage : LabelTableTest [cache path], in the working directory by default
+//
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "iCub/LabelTable.h"
+#include "TestCheck.h"
+
+
+static std::string g_cachePath = "LabelTableTest.cache";
+
+static const std::map<int, std::string> &testLabels() {
+    static const std::map<int, std::string> labels = {
+            {1, "person"},
+            {2, "bicycle"},
+            {5, "person"},
+            {7, "cup"},
+    };
+    return labels;
+}
+
+// Flip a byte of the cache file at an offset from its end
+static bool corruptCache(long t_offsetFromEnd) {
+    FILE *file = fopen(g_cachePath.c_str(), "r+b");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool corrupted = fseek(file, -t_offsetFromEnd, SEEK_END) == 0;
+    int byte = corrupted ? fgetc(file) : EOF;
+    corrupted = corrupted && byte != EOF && fseek(file, -t_offsetFromEnd, SEEK_END) == 0 &&
+                fputc(byte ^ 0x5a, file) != EOF;
+    return fclose(file) == 0 && corrupted;
+}
+
+
+static void testLookup() {
+    LabelTable table;
+    table.assign(testLabels());
+
+    CHECK_EQUAL(8u, table.size());
+    CHECK_EQUAL(3u, table.uniqueNames());
+    CHECK(strcmp(table.name(1), "person") == 0);
+    CHECK(strcmp(table.name(5), "person") == 0);
+    CHECK(table.name(1) == table.name(5));
+    CHECK(strcmp(table.name(7), "cup") == 0);
+
+    // unknown ids have an empty name
+    CHECK(strcmp(table.name(0), "") == 0);
+    CHECK(strcmp(table.name(3), "") == 0);
+    CHECK(strcmp(table.name(-1), "") == 0);
+    CHECK(strcmp(table.name(8), "") == 0);
+}
+
+static void testCacheRoundTrip() {
+    const uint64_t sourceHash = 0x1234567890abcdefULL;
+
+    LabelTable table;
+    table.assign(testLabels());
+    CHECK(table.writeCache(g_cachePath, sourceHash));
+
+    LabelTable mapped;
+    CHECK(mapped.mapCache(g_cachePath, sourceHash));
+    CHECK_EQUAL(table.size(), mapped.size());
+    CHECK_EQUAL(table.uniqueNames(), mapped.uniqueNames());
+    for (int classId = -1; classId <= 8; ++classId) {
+        CHECK(strcmp(table.name(classId), mapped.name(classId)) == 0);
+    }
+
+    // assigning after mapping drops the mapping
+    mapped.assign({{0, "background"}});
+    CHECK_EQUAL(1u, mapped.size());
+    CHECK(strcmp(mapped.name(0), "background") == 0);
+}
+
+static void testCacheInvalidation() {
+    const uint64_t sourceHash = 42;
+
+    LabelTable table;
+    table.assign(testLabels());
+    CHECK(table.writeCache(g_cachePath, sourceHash));
+
+    // built from another label file
+    LabelTable mapped;
+    CHECK(!mapped.mapCache(g_cachePath, sourceHash + 1));
+    CHECK_EQUAL(0u, mapped.size());
+
+    // a failed mapping keeps the current table
+    mapped.assign({{0, "background"}});
+    CHECK(!mapped.mapCache(g_cachePath, sourceHash + 1));
+    CHECK(strcmp(mapped.name(0), "background") == 0);
+
+    // corrupted names
+    CHECK(corruptCache(3));
+    CHECK(!mapped.mapCache(g_cachePath, sourceHash));
+
+    // valid again once rewritten
+    CHECK(table.writeCache(g_cachePath, sourceHash));
+    CHECK(mapped.mapCache(g_cachePath, sourceHash));
+
+    // missing
+    remove(g_cachePath.c_str());
+    LabelTable missing;
+    CHECK(!missing.mapCache(g_cachePath, sourceHash));
+}
+
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        g_cachePath = argv[1];
+    }
+
+    RUN_TEST(testLookup);
+    RUN_TEST(testCacheRoundTrip);
+    RUN_TEST(testCacheInvalidation);
+
+    remove(g_cachePath.c_str());
+    return testResult();
+}
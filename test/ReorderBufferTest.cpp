@@ -0,0 +1,115 @@
+//
+// Unit tests of the reorder buffer : items pushed out of order by the workers are popped in sequence order, the
+// capacity bounds the items in flight and closing the buffer wakes up the blocked callers.
+//
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "iCub/ReorderBuffer.h"
+#include "TestCheck.h"
+
+
+static void testPopInSequenceOrder() {
+    ReorderBuffer<int> buffer(4);
+
+    uint64_t sequences[4];
+    for (uint64_t &sequence : sequences) {
+        CHECK(buffer.reserve(sequence));
+    }
+    CHECK_EQUAL(0u, sequences[0]);
+    CHECK_EQUAL(3u, sequences[3]);
+    CHECK_EQUAL(4u, buffer.inFlight());
+
+    buffer.push(sequences[2], 2);
+    buffer.push(sequences[0], 0);
+    buffer.push(sequences[3], 3);
+    buffer.push(sequences[1], 1);
+
+    // pushed while the item of sequence 0 was not popped yet
+    CHECK_EQUAL(3u, buffer.reordered());
+
+    for (int expected = 0; expected < 4; ++expected) {
+        int item = -1;
+        CHECK(buffer.pop(item));
+        CHECK_EQUAL(expected, item);
+    }
+    CHECK_EQUAL(0u, buffer.inFlight());
+}
+
+static void testConcurrentWorkers() {
+    const int itemCount = 1000;
+    ReorderBuffer<int> buffer(8);
+
+    // each worker pushes the items it reserved after a delay depending on the item, completing out of order
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 4; ++w) {
+        workers.emplace_back([&buffer] {
+            uint64_t sequence = 0;
+            while (buffer.reserve(sequence)) {
+                if (sequence >= itemCount) {
+                    buffer.push(sequence, -1);
+                    continue;
+                }
+                if (sequence % 3 == 0) {
+                    std::this_thread::yield();
+                }
+                buffer.push(sequence, static_cast<int>(sequence));
+            }
+        });
+    }
+
+    bool ordered = true;
+    for (int expected = 0; expected < itemCount; ++expected) {
+        int item = -1;
+        CHECK(buffer.pop(item));
+        ordered = ordered && item == expected;
+        CHECK(buffer.inFlight() <= buffer.capacity());
+    }
+    CHECK(ordered);
+
+    buffer.close();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+static void testCloseWakesUp() {
+    ReorderBuffer<int> buffer(1);
+
+    uint64_t sequence = 0;
+    CHECK(buffer.reserve(sequence));
+
+    // blocked on the capacity, then on the missing item
+    std::atomic<bool> reserved(true);
+    std::thread reserver([&buffer, &reserved] {
+        uint64_t next = 0;
+        reserved = buffer.reserve(next);
+    });
+    std::atomic<bool> popped(true);
+    std::thread popper([&buffer, &popped] {
+        int item = 0;
+        popped = buffer.pop(item);
+    });
+
+    buffer.close();
+    reserver.join();
+    popper.join();
+    CHECK(!reserved);
+    CHECK(!popped);
+
+    // an item pushed after the close is dropped
+    buffer.push(sequence, 1);
+    int item = 0;
+    CHECK(!buffer.pop(item));
+}
+
+
+int main() {
+    RUN_TEST(testPopInSequenceOrder);
+    RUN_TEST(testConcurrentWorkers);
+    RUN_TEST(testCloseWakesUp);
+
+    return testResult();
+}
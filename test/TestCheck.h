@@ -0,0 +1,44 @@
+//
+// Checks of the unit tests of the inference core : unlike assert they stay enabled in release builds, a failed
+// check is reported with its location and fails the test without stopping it.
+//
+
+#ifndef OBJECTRECOGNITIONINFER_TestCheck_H
+#define OBJECTRECOGNITIONINFER_TestCheck_H
+
+#include <cstdio>
+
+static int g_failedChecks = 0;
+
+#define CHECK(t_condition) \
+    do { \
+        if (!(t_condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #t_condition); \
+            ++g_failedChecks; \
+        } \
+    } while (false)
+
+#define CHECK_EQUAL(t_expected, t_actual) CHECK((t_expected) == (t_actual))
+
+/**
+ * Run a test function, named in the output
+ */
+#define RUN_TEST(t_test) \
+    do { \
+        const int failedBefore = g_failedChecks; \
+        t_test(); \
+        printf("%s %s\n", g_failedChecks == failedBefore ? "[ OK ]" : "[FAIL]", #t_test); \
+    } while (false)
+
+/**
+ * @return exit status of the test executable
+ */
+inline int testResult() {
+    if (g_failedChecks > 0) {
+        fprintf(stderr, "%d checks failed\n", g_failedChecks);
+        return 1;
+    }
+    return 0;
+}
+
+#endif //OBJECTRECOGNITIONINFER_TestCheck_H
@@ -0,0 +1,161 @@
+//
+// Unit tests of the tiled detection : layout of the tiles over a frame, skipping of the unchanged tiles and
+// merge of their detections, also when the frames complete out of order.
+//
+
+#include <vector>
+
+#include "iCub/TiledDetection.h"
+#include "TestCheck.h"
+
+
+static void testComputeTiles() {
+    const std::vector<ImageTile> tiles = computeTiles(640, 480, 3, 2, 0.25);
+    CHECK_EQUAL(6u, tiles.size());
+
+    // 3 tiles overlapping by a quarter cover 2.5 tiles, 2 of them 1.75 tiles
+    for (const ImageTile &tile : tiles) {
+        CHECK_EQUAL(256, tile.width);
+        CHECK_EQUAL(275, tile.height);
+    }
+
+    // row by row, the first and last ones on the borders
+    CHECK_EQUAL(0, tiles[0].x);
+    CHECK_EQUAL(0, tiles[0].y);
+    CHECK_EQUAL(192, tiles[1].x);
+    CHECK_EQUAL(640, tiles[2].x + tiles[2].width);
+    CHECK_EQUAL(0, tiles[3].x);
+    CHECK_EQUAL(480, tiles[3].y + tiles[3].height);
+
+    // neighbours overlap by at least the requested fraction
+    CHECK(tiles[0].x + tiles[0].width - tiles[1].x >= tiles[0].width / 4);
+    CHECK(tiles[0].y + tiles[0].height - tiles[3].y >= tiles[0].height / 4);
+
+    // a single tile is the whole image, a tile is never larger than the image
+    const std::vector<ImageTile> single = computeTiles(640, 480, 1, 1, 0.5);
+    CHECK_EQUAL(1u, single.size());
+    CHECK_EQUAL(640, single[0].width);
+    CHECK_EQUAL(480, single[0].height);
+
+    const std::vector<ImageTile> clamped = computeTiles(100, 50, 2, 2, 2.0);
+    CHECK_EQUAL(4u, clamped.size());
+    for (const ImageTile &tile : clamped) {
+        CHECK(tile.x >= 0 && tile.x + tile.width <= 100);
+        CHECK(tile.y >= 0 && tile.y + tile.height <= 50);
+    }
+}
+
+static void testSkipUnchangedTiles() {
+    const int width = 128;
+    const int height = 64;
+    std::vector<uint8_t> image(width * height * 3, 50);
+
+    TileCache cache;
+    cache.configure({2, 1, 0.0, 0.5f, 10.0, 3});
+
+    TiledFrame frame;
+    cache.selectTiles(0, image.data(), width * 3, width, height, &frame);
+    CHECK_EQUAL(2u, frame.inferredTiles.size());
+
+    // the tiles without detections yet are inferred again
+    cache.selectTiles(0, image.data(), width * 3, width, height, &frame);
+    CHECK_EQUAL(2u, frame.inferredTiles.size());
+
+    DetectionBuffer objectsDetected;
+    cache.mergeTiles(frame, {{}, {}}, 10, &objectsDetected);
+
+    cache.selectTiles(0, image.data(), width * 3, width, height, &frame);
+    CHECK_EQUAL(0u, frame.inferredTiles.size());
+
+    // only the changed tile is inferred
+    for (int y = 0; y < height; ++y) {
+        for (int x = width / 2; x < width; ++x) {
+            image[(y * width + x) * 3] = 250;
+            image[(y * width + x) * 3 + 1] = 250;
+        }
+    }
+    cache.selectTiles(0, image.data(), width * 3, width, height, &frame);
+    CHECK(frame.inferredTiles == std::vector<int>({1}));
+
+    // another source has its own state
+    cache.selectTiles(1, image.data(), width * 3, width, height, &frame);
+    CHECK_EQUAL(2u, frame.inferredTiles.size());
+
+    const TileStats stats = cache.getStats();
+    CHECK_EQUAL(5u, stats.frames);
+    CHECK_EQUAL(3u, stats.tilesSkipped);
+}
+
+static void testMergeTiles() {
+    std::vector<uint8_t> image(200 * 100 * 3, 0);
+
+    TileCache cache;
+    cache.configure({2, 1, 0.2, 0.5f, 0.0, 0});
+
+    TiledFrame frame;
+    cache.selectTiles(0, image.data(), 200 * 3, 200, 100, &frame);
+    CHECK_EQUAL(2u, frame.inferredTiles.size());
+
+    // an object on the border of both tiles is merged, the instances are numbered in the frame
+    const Detection left = {1, 0, 0.9f, {90, 10, 120, 40}};
+    const Detection right = {1, 0, 0.8f, {92, 10, 120, 42}};
+    const Detection other = {1, 0, 0.7f, {150, 50, 190, 90}};
+    DetectionBuffer objectsDetected;
+    cache.mergeTiles(frame, {{left}, {right, other}}, 10, &objectsDetected);
+
+    CHECK_EQUAL(2u, objectsDetected.size());
+    CHECK_EQUAL(0.9f, objectsDetected[0].score);
+    CHECK_EQUAL(0, objectsDetected[0].instance);
+    CHECK_EQUAL(0.7f, objectsDetected[1].score);
+    CHECK_EQUAL(1, objectsDetected[1].instance);
+
+    // a failed inference reuses the cached detections
+    cache.selectTiles(0, image.data(), 200 * 3, 200, 100, &frame);
+    cache.mergeTiles(frame, {}, 10, &objectsDetected);
+    CHECK_EQUAL(2u, objectsDetected.size());
+
+    // capped to the maximum number of detections
+    cache.mergeTiles(frame, {}, 1, &objectsDetected);
+    CHECK_EQUAL(1u, objectsDetected.size());
+}
+
+static void testMergeOutOfOrder() {
+    std::vector<uint8_t> image(200 * 100 * 3, 0);
+
+    TileCache cache;
+    cache.configure({2, 1, 0.1, 0.5f, 0.0, 0});
+
+    TiledFrame older;
+    TiledFrame newer;
+    cache.selectTiles(0, image.data(), 200 * 3, 200, 100, &older);
+    cache.selectTiles(0, image.data(), 200 * 3, 200, 100, &newer);
+    CHECK(newer.sequence > older.sequence);
+
+    const Detection newObject = {1, 0, 0.9f, {0, 0, 10, 10}};
+    const Detection oldObject = {2, 0, 0.8f, {20, 20, 40, 40}};
+    DetectionBuffer objectsDetected;
+    cache.mergeTiles(newer, {{newObject}, {}}, 10, &objectsDetected);
+    CHECK_EQUAL(1u, objectsDetected.size());
+
+    // the older frame completing last uses its own detections without replacing the cached ones
+    cache.mergeTiles(older, {{oldObject}, {}}, 10, &objectsDetected);
+    CHECK_EQUAL(1u, objectsDetected.size());
+    CHECK_EQUAL(2, objectsDetected[0].classId);
+
+    // the next frame sees the detections of the newer one
+    TiledFrame failed;
+    cache.selectTiles(0, image.data(), 200 * 3, 200, 100, &failed);
+    cache.mergeTiles(failed, {}, 10, &objectsDetected);
+    CHECK_EQUAL(1u, objectsDetected.size());
+    CHECK_EQUAL(1, objectsDetected[0].classId);
+}
+
+
+int main() {
+    RUN_TEST(testComputeTiles);
+    RUN_TEST(testSkipUnchangedTiles);
+    RUN_TEST(testMergeTiles);
+    RUN_TEST(testMergeOutOfOrder);
+
+    return testResult();
+}
@@ -0,0 +1,140 @@
+//
+// Offline conversion of a frozen graph to the memmapped package loaded with graph_format memmapped : the large
+// constants are stored as aligned regions of the package and their nodes become ImmutableConst ops reading them
+// in place, the graph itself is stored in the package without its weights.
+//
+// Usage : objectDetectionConvertGraph --in frozen_inference_graph.pb --out frozen_inference_graph.mmapped
+//                                     [--min_bytes 10000]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <tensorflow/core/framework/graph.pb.h>
+#include <tensorflow/core/framework/node_def.pb.h>
+#include <tensorflow/core/framework/attr_value.pb.h>
+#include <tensorflow/core/framework/tensor.h>
+#include <tensorflow/core/lib/core/errors.h>
+#include <tensorflow/core/platform/env.h>
+#include <tensorflow/core/util/memmapped_file_system.h>
+#include <tensorflow/core/util/memmapped_file_system_writer.h>
+
+
+/**
+ * Move the constants of the graph into the package
+ * @param t_graphDef converted in place, the weights are replaced by references to the regions of the package
+ * @param t_minBytes smaller constants are left in the graph, each region is padded for its alignment
+ * @param t_writer
+ * @param t_convertedBytes size of the tensors moved into the package
+ * @param t_status error of the conversion
+ * @return number of converted constants
+ */
+static int convertConstants(tensorflow::GraphDef *t_graphDef, size_t t_minBytes,
+                            tensorflow::MemmappedFileSystemWriter *t_writer, size_t *t_convertedBytes,
+                            tensorflow::Status *t_status) {
+    int converted = 0;
+    *t_convertedBytes = 0;
+
+    for (int i = 0; i < t_graphDef->node_size(); ++i) {
+        tensorflow::NodeDef *node = t_graphDef->mutable_node(i);
+        if (node->op() != "Const") {
+            continue;
+        }
+
+        // ImmutableConst can not hold strings nor resources
+        const tensorflow::DataType dtype = node->attr().at("dtype").type();
+        if (dtype == tensorflow::DT_STRING || dtype == tensorflow::DT_RESOURCE) {
+            continue;
+        }
+
+        tensorflow::Tensor value;
+        if (!value.FromProto(node->attr().at("value").tensor())) {
+            *t_status = tensorflow::errors::InvalidArgument("Unable to read the value of the constant ", node->name());
+            return converted;
+        }
+        if (value.TotalBytes() < t_minBytes) {
+            continue;
+        }
+
+        const std::string regionName = "const" + std::to_string(converted);
+        *t_status = t_writer->SaveTensor(value, regionName);
+        if (!t_status->ok()) {
+            return converted;
+        }
+
+        node->set_op("ImmutableConst");
+        auto *attributes = node->mutable_attr();
+        attributes->erase("value");
+        value.shape().AsProto((*attributes)["shape"].mutable_shape());
+        (*attributes)["memory_region_name"].set_s(
+                std::string(tensorflow::MemmappedFileSystem::kMemmappedPackagePrefix) + regionName);
+
+        *t_convertedBytes += value.TotalBytes();
+        ++converted;
+    }
+
+    *t_status = tensorflow::Status::OK();
+    return converted;
+}
+
+
+int main(int argc, char *argv[]) {
+    std::string inputPath;
+    std::string outputPath;
+    size_t minBytes = 10000;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--in")) {
+            inputPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--out")) {
+            outputPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--min_bytes")) {
+            minBytes = static_cast<size_t>(atol(argv[i + 1]));
+        }
+    }
+
+    if (inputPath.empty() || outputPath.empty()) {
+        fprintf(stderr, "Usage : %s --in frozen_graph.pb --out graph.mmapped [--min_bytes 10000]\n", argv[0]);
+        return 1;
+    }
+
+    tensorflow::Env *env = tensorflow::Env::Default();
+    tensorflow::GraphDef graphDef;
+    tensorflow::Status status = tensorflow::ReadBinaryProto(env, inputPath, &graphDef);
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to read %s : %s\n", inputPath.c_str(), status.ToString().c_str());
+        return 1;
+    }
+
+    tensorflow::MemmappedFileSystemWriter writer;
+    status = writer.InitializeToFile(env, outputPath);
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to create %s : %s\n", outputPath.c_str(), status.ToString().c_str());
+        return 1;
+    }
+
+    size_t convertedBytes = 0;
+    const int converted = convertConstants(&graphDef, minBytes, &writer, &convertedBytes, &status);
+    if (status.ok()) {
+        // the graph is the last region, it is found by its name when the package is loaded
+        status = writer.SaveProtobuf(graphDef, tensorflow::MemmappedFileSystem::kMemmappedPackageDefaultGraphDef);
+    }
+    if (status.ok()) {
+        status = writer.FlushAndClose();
+    }
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to convert %s : %s\n", inputPath.c_str(), status.ToString().c_str());
+        remove(outputPath.c_str());
+        return 1;
+    }
+
+    printf("%s : %d of %d nodes converted to ImmutableConst, %.1f MB of weights mapped from %s\n",
+           inputPath.c_str(), converted, graphDef.node_size(), convertedBytes / (1024.0 * 1024.0),
+           outputPath.c_str());
+
+    return 0;
+}
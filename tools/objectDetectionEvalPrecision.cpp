@@ -0,0 +1,331 @@
+//
+// Comparison of the float graph and the graph quantised by objectDetectionQuantizeGraph on the same images : speedup
+// of the inference, and agreement of the detections per class. A detection of the quantised graph agrees with a
+// detection of the float graph when both have the same class and their boxes overlap by at least --iou.
+//
+// Usage : objectDetectionEvalPrecision --graph_path graph.pb --labels_path labels.pbtxt --images dir
+//                                      [--model_name coco] [--max_frames 0] [--warmup 5] [--iou 0.5]
+//                                      [--threshold 0.5] [--input_width 0] [--input_height 0] [--letterbox 0]
+//                                      [--json result.json | --json -]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "iCub/tensorflowObjectDetection.h"
+
+
+struct EvalOptions {
+    std::string graphPath;
+    std::string labelsPath;
+    std::string modelName;
+    std::string imagesPath;
+    std::string jsonPath;       // "-" for the standard output, empty to disable
+    int maxFrames;              // images loaded, 0 for all of them
+    int warmup;
+    double iouThreshold;
+    double threshold;
+    int inputWidth;
+    int inputHeight;
+    bool letterbox;
+};
+
+// Detections and run times of one graph over the image set
+struct PrecisionRun {
+    std::vector<std::vector<Detection> > detections;    // per image, in decreasing score
+    double meanLatencyMs;
+    double p50LatencyMs;
+};
+
+// Agreement of the two graphs for one class
+struct ClassAgreement {
+    int floatDetections;
+    int quantizedDetections;
+    int matched;
+    double iouSum;              // over the matched pairs
+    double scoreDeltaSum;       // absolute difference of the scores over the matched pairs
+};
+
+/**
+ * Decode the images once, so that the decoding is not measured
+ * @param t_options
+ * @param t_frames
+ * @return false if no image can be read
+ */
+static bool loadFrames(const EvalOptions &t_options, std::vector<cv::Mat> &t_frames) {
+    const size_t maxFrames = t_options.maxFrames > 0 ? static_cast<size_t>(t_options.maxFrames) : SIZE_MAX;
+
+    std::vector<std::string> files;
+    cv::glob(t_options.imagesPath + "/*", files, false);
+    for (size_t i = 0; i < files.size() && t_frames.size() < maxFrames; ++i) {
+        cv::Mat frame = cv::imread(files[i]);
+        if (!frame.empty()) {
+            t_frames.push_back(frame);
+        }
+    }
+
+    return !t_frames.empty();
+}
+
+/**
+ * Infer every image with one graph, one caller so that the run times are comparable
+ * @param t_detector initialized detector
+ * @param t_frames
+ * @param t_warmup runs not measured before the image set
+ * @param t_run
+ */
+static void runPrecision(tensorflowObjectDetection &t_detector, const std::vector<cv::Mat> &t_frames, int t_warmup,
+                         PrecisionRun &t_run) {
+    DetectionBuffer objectsDetected;
+    for (int i = 0; i < t_warmup; ++i) {
+        t_detector.inferObject(t_frames[i % t_frames.size()], &objectsDetected);
+    }
+
+    std::vector<double> latenciesMs;
+    t_run.detections.clear();
+    for (const cv::Mat &frame : t_frames) {
+        const auto start = std::chrono::steady_clock::now();
+        t_detector.inferObject(frame, &objectsDetected);
+        latenciesMs.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+
+        t_run.detections.emplace_back(objectsDetected.begin(), objectsDetected.end());
+    }
+
+    double latencySum = 0.0;
+    for (const double latency : latenciesMs) {
+        latencySum += latency;
+    }
+    std::sort(latenciesMs.begin(), latenciesMs.end());
+    t_run.meanLatencyMs = latencySum / latenciesMs.size();
+    t_run.p50LatencyMs = latenciesMs[latenciesMs.size() / 2];
+}
+
+/**
+ * Match the detections of the quantised graph to the ones of the float graph, image per image and class per class.
+ * The float detections are taken by decreasing score and each one keeps the unmatched quantised detection of its
+ * class overlapping it the most
+ * @param t_float reference detections
+ * @param t_quantized
+ * @param t_iouThreshold minimum overlap of a match
+ * @param t_agreements per class id
+ */
+static void matchDetections(const PrecisionRun &t_float, const PrecisionRun &t_quantized, double t_iouThreshold,
+                            std::map<int, ClassAgreement> &t_agreements) {
+    for (size_t frame = 0; frame < t_float.detections.size(); ++frame) {
+        const std::vector<Detection> &reference = t_float.detections[frame];
+        const std::vector<Detection> &candidates = t_quantized.detections[frame];
+        std::vector<bool> taken(candidates.size(), false);
+
+        for (const Detection &detection : reference) {
+            ClassAgreement &agreement = t_agreements[detection.classId];
+            ++agreement.floatDetections;
+
+            int best = -1;
+            float bestIoU = static_cast<float>(t_iouThreshold);
+            for (size_t c = 0; c < candidates.size(); ++c) {
+                if (taken[c] || candidates[c].classId != detection.classId) {
+                    continue;
+                }
+                const float iou = detectionIoU(detection, candidates[c]);
+                if (iou >= bestIoU) {
+                    best = static_cast<int>(c);
+                    bestIoU = iou;
+                }
+            }
+
+            if (best >= 0) {
+                taken[best] = true;
+                ++agreement.matched;
+                agreement.iouSum += bestIoU;
+                agreement.scoreDeltaSum += std::fabs(detection.score - candidates[best].score);
+            }
+        }
+
+        for (const Detection &candidate : candidates) {
+            ++t_agreements[candidate.classId].quantizedDetections;
+        }
+    }
+}
+
+static std::string jsonString(const std::string &t_value) {
+    std::string escaped = "\"";
+    for (const char c : t_value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+/**
+ * @param t_agreement
+ * @return matched detections over the detections of either graph, 1 when both graphs agree completely
+ */
+static double agreementRatio(const ClassAgreement &t_agreement) {
+    const int detections = t_agreement.floatDetections + t_agreement.quantizedDetections - t_agreement.matched;
+    return detections > 0 ? static_cast<double>(t_agreement.matched) / detections : 1.0;
+}
+
+
+int main(int argc, char *argv[]) {
+    EvalOptions options = {"", "", "coco", "", "", 0, 5, 0.5, 0.5, 0, 0, false};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--graph_path")) {
+            options.graphPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--labels_path")) {
+            options.labelsPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--model_name")) {
+            options.modelName = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--images")) {
+            options.imagesPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--json")) {
+            options.jsonPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--max_frames")) {
+            options.maxFrames = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--warmup")) {
+            options.warmup = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--iou")) {
+            options.iouThreshold = atof(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--threshold")) {
+            options.threshold = atof(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--input_width")) {
+            options.inputWidth = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--input_height")) {
+            options.inputHeight = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "--letterbox")) {
+            options.letterbox = atoi(argv[i + 1]) != 0;
+        }
+    }
+
+    if (options.graphPath.empty() || options.labelsPath.empty() || options.imagesPath.empty()) {
+        fprintf(stderr, "Usage : %s --graph_path graph.pb --labels_path labels.pbtxt --images dir "
+                        "[--model_name coco] [--max_frames 0] [--warmup 5] [--iou 0.5] [--threshold 0.5] "
+                        "[--input_width 0] [--input_height 0] [--letterbox 0] [--json file|-]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<cv::Mat> frames;
+    if (!loadFrames(options, frames)) {
+        fprintf(stderr, "No image in %s\n", options.imagesPath.c_str());
+        return 1;
+    }
+
+    // the summary leaves the standard output to the JSON when it is written there
+    FILE *report = options.jsonPath == "-" ? stderr : stdout;
+
+    const Precision precisions[] = {Precision::Float, Precision::Int8};
+    std::unique_ptr<tensorflowObjectDetection> detectors[2];
+    PrecisionRun runs[2];
+    for (int p = 0; p < 2; ++p) {
+        detectors[p].reset(new tensorflowObjectDetection(options.graphPath, options.labelsPath, options.modelName));
+        detectors[p]->setM_detectionThreshold(options.threshold);
+        detectors[p]->setExpectedInputSize(frames[0].cols, frames[0].rows, 1, 1);
+        detectors[p]->setInputResize(options.inputWidth, options.inputHeight, options.letterbox);
+        detectors[p]->setPrecision(precisions[p]);
+
+        const tensorflow::Status initStatus = detectors[p]->initGraph();
+        if (!initStatus.ok()) {
+            fprintf(stderr, "Unable to initialize %s : %s\n",
+                    precisionGraphPath(options.graphPath, precisions[p]).c_str(), initStatus.error_message().c_str());
+            return 1;
+        }
+
+        fprintf(report, "Inferring %zu images with %s\n", frames.size(),
+                precisionGraphPath(options.graphPath, precisions[p]).c_str());
+        runPrecision(*detectors[p], frames, options.warmup, runs[p]);
+    }
+
+    std::map<int, ClassAgreement> agreements;
+    matchDetections(runs[0], runs[1], options.iouThreshold, agreements);
+
+    ClassAgreement total = {0, 0, 0, 0.0, 0.0};
+    const LabelTable &labels = detectors[0]->getLabels();
+    const double speedup = runs[0].meanLatencyMs / runs[1].meanLatencyMs;
+
+    fprintf(report, "%-8s %10.2f ms mean %10.2f ms p50\n", "float", runs[0].meanLatencyMs, runs[0].p50LatencyMs);
+    fprintf(report, "%-8s %10.2f ms mean %10.2f ms p50\n", "int8", runs[1].meanLatencyMs, runs[1].p50LatencyMs);
+    fprintf(report, "%-8s %10.2fx\n\n", "speedup", speedup);
+    fprintf(report, "%-24s %8s %8s %8s %10s %10s %10s\n", "class", "float", "int8", "matched", "agreement",
+            "mean IoU", "score diff");
+    for (const auto &agreement : agreements) {
+        const ClassAgreement &classAgreement = agreement.second;
+        fprintf(report, "%-24s %8d %8d %8d %10.3f %10.3f %10.3f\n", labels.name(agreement.first),
+                classAgreement.floatDetections, classAgreement.quantizedDetections, classAgreement.matched,
+                agreementRatio(classAgreement),
+                classAgreement.matched > 0 ? classAgreement.iouSum / classAgreement.matched : 0.0,
+                classAgreement.matched > 0 ? classAgreement.scoreDeltaSum / classAgreement.matched : 0.0);
+
+        total.floatDetections += classAgreement.floatDetections;
+        total.quantizedDetections += classAgreement.quantizedDetections;
+        total.matched += classAgreement.matched;
+        total.iouSum += classAgreement.iouSum;
+        total.scoreDeltaSum += classAgreement.scoreDeltaSum;
+    }
+    fprintf(report, "%-24s %8d %8d %8d %10.3f\n", "all classes", total.floatDetections, total.quantizedDetections,
+            total.matched, agreementRatio(total));
+
+    if (!options.jsonPath.empty()) {
+        FILE *jsonFile = options.jsonPath == "-" ? stdout : fopen(options.jsonPath.c_str(), "w");
+        if (jsonFile == nullptr) {
+            fprintf(stderr, "Unable to write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+
+        fprintf(jsonFile, "{\n");
+        fprintf(jsonFile, "  \"graph\": %s,\n", jsonString(options.graphPath).c_str());
+        fprintf(jsonFile, "  \"images\": %zu,\n", frames.size());
+        fprintf(jsonFile, "  \"iou_threshold\": %.3f,\n", options.iouThreshold);
+        fprintf(jsonFile, "  \"score_threshold\": %.3f,\n", options.threshold);
+        fprintf(jsonFile, "  \"float_latency_ms\": {\"mean\": %.3f, \"p50\": %.3f},\n", runs[0].meanLatencyMs,
+                runs[0].p50LatencyMs);
+        fprintf(jsonFile, "  \"int8_latency_ms\": {\"mean\": %.3f, \"p50\": %.3f},\n", runs[1].meanLatencyMs,
+                runs[1].p50LatencyMs);
+        fprintf(jsonFile, "  \"speedup\": %.3f,\n", speedup);
+        fprintf(jsonFile, "  \"agreement\": %.4f,\n", agreementRatio(total));
+        fprintf(jsonFile, "  \"classes\": [");
+        bool first = true;
+        for (const auto &agreement : agreements) {
+            const ClassAgreement &classAgreement = agreement.second;
+            fprintf(jsonFile, "%s\n    {\"class_id\": %d, \"label\": %s, \"float\": %d, \"int8\": %d, "
+                              "\"matched\": %d, \"agreement\": %.4f, \"mean_iou\": %.4f, \"mean_score_delta\": %.4f}",
+                    first ? "" : ",", agreement.first, jsonString(labels.name(agreement.first)).c_str(),
+                    classAgreement.floatDetections, classAgreement.quantizedDetections, classAgreement.matched,
+                    agreementRatio(classAgreement),
+                    classAgreement.matched > 0 ? classAgreement.iouSum / classAgreement.matched : 0.0,
+                    classAgreement.matched > 0 ? classAgreement.scoreDeltaSum / classAgreement.matched : 0.0);
+            first = false;
+        }
+        fprintf(jsonFile, "\n  ]\n}\n");
+
+        if (jsonFile != stdout) {
+            fclose(jsonFile);
+        }
+    }
+
+    return 0;
+}
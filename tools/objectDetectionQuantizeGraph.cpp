@@ -0,0 +1,121 @@
+//
+// Offline quantisation of a frozen graph for precision int8 : the graph is optimised for the fetched outputs, its
+// weights are stored in eight bits and its float ops are replaced by the eight bits kernels of TensorFlow, the
+// ranges of the activations being computed at run time. The result is written next to the exported graph,
+// where the module looks for it.
+//
+// Usage : objectDetectionQuantizeGraph --in frozen_inference_graph.pb [--out frozen_inference_graph.int8.pb]
+//                                      [--input image_tensor:0]
+//                                      [--outputs detection_boxes:0,detection_scores:0,...]
+//                                      [--transforms "..."]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tensorflow/core/platform/env.h>
+
+#include "iCub/GraphOptimization.h"
+
+
+/**
+ * @param t_graphDef
+ * @return number of nodes per op type
+ */
+static std::map<std::string, int> countOps(const tensorflow::GraphDef &t_graphDef) {
+    std::map<std::string, int> ops;
+    for (int i = 0; i < t_graphDef.node_size(); ++i) {
+        ++ops[t_graphDef.node(i).op()];
+    }
+    return ops;
+}
+
+
+int main(int argc, char *argv[]) {
+    std::string inputPath;
+    std::string outputPath;
+    std::string inputTensor = "image_tensor:0";
+    std::string outputTensors = "detection_boxes:0,detection_scores:0,detection_classes:0,num_detections:0";
+    std::string transforms = QuantizeGraphTransforms;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--in")) {
+            inputPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--out")) {
+            outputPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--input")) {
+            inputTensor = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--outputs")) {
+            outputTensors = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "--transforms")) {
+            transforms = argv[i + 1];
+        }
+    }
+
+    if (inputPath.empty()) {
+        fprintf(stderr, "Usage : %s --in frozen_graph.pb [--out frozen_graph.int8.pb] [--input image_tensor:0] "
+                        "[--outputs tensor,tensor...] [--transforms \"...\"]\n", argv[0]);
+        return 1;
+    }
+    if (outputPath.empty()) {
+        outputPath = precisionGraphPath(inputPath, Precision::Int8);
+    }
+
+    std::vector<std::string> outputs;
+    std::istringstream outputList(outputTensors);
+    std::string output;
+    while (std::getline(outputList, output, ',')) {
+        if (!output.empty()) {
+            outputs.push_back(output);
+        }
+    }
+
+    tensorflow::Env *env = tensorflow::Env::Default();
+    tensorflow::GraphDef graphDef;
+    tensorflow::Status status = tensorflow::ReadBinaryProto(env, inputPath, &graphDef);
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to read %s : %s\n", inputPath.c_str(), status.ToString().c_str());
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    tensorflow::GraphDef quantizedGraph;
+    status = optimizeGraph(graphDef, inputTensor, outputs, transforms, &quantizedGraph);
+    const double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to quantise %s : %s\n", inputPath.c_str(), status.ToString().c_str());
+        return 1;
+    }
+
+    status = writeGraphAtomically(outputPath, quantizedGraph);
+    if (!status.ok()) {
+        fprintf(stderr, "Unable to write %s : %s\n", outputPath.c_str(), status.ToString().c_str());
+        return 1;
+    }
+
+    // the eight bits ops show which part of the graph actually runs quantised
+    int quantizedNodes = 0;
+    for (const auto &op : countOps(quantizedGraph)) {
+        if (op.first.find("Quantiz") != std::string::npos || op.first.find("quantiz") != std::string::npos) {
+            quantizedNodes += op.second;
+            printf("  %-32s %6d\n", op.first.c_str(), op.second);
+        }
+    }
+
+    printf("%s quantised in %.1f s : %d nodes (%.1f MB) to %d nodes (%.1f MB), %d quantisation nodes, "
+           "written to %s\n",
+           inputPath.c_str(), elapsedS, graphDef.node_size(), graphDef.ByteSizeLong() / (1024.0 * 1024.0),
+           quantizedGraph.node_size(), quantizedGraph.ByteSizeLong() / (1024.0 * 1024.0), quantizedNodes,
+           outputPath.c_str());
+
+    return 0;
+}